@@ -0,0 +1,47 @@
+#include "FrameQuality.h"
+
+FrameQuality scoreFrame(const uint8_t *luma, uint16_t width, uint16_t height)
+{
+  FrameQuality quality = {0, 0, 0};
+  if (width < 3 || height < 3)
+    return quality;
+
+  int64_t sum = 0;
+  uint64_t squares = 0;
+  uint32_t clipped = 0;
+  const uint16_t inner = width - 2;
+
+  for (uint16_t y = 1; y < height - 1; y++)
+  {
+    const uint8_t *__restrict up = luma + (uint32_t)(y - 1) * width + 1;
+    const uint8_t *__restrict mid = up + width;
+    const uint8_t *__restrict down = mid + width;
+
+    // One row: |Laplacian| <= 1020, so 1020^2 * inner stays in 32 bits for widths up to 4000
+    int32_t rowSum = 0;
+    uint32_t rowSquares = 0;
+    uint32_t rowClipped = 0;
+    for (uint16_t x = 0; x < inner; x++)
+    {
+      int32_t centre = mid[x];
+      int32_t laplacian = up[x] + down[x] + mid[x - 1] + mid[x + 1] - 4 * centre;
+      rowSum += laplacian;
+      rowSquares += (uint32_t)(laplacian * laplacian);
+      // Branch-free range test: true outside [CLIP_LOW + 1, CLIP_HIGH - 1]
+      rowClipped += (uint32_t)(centre - (FRAME_CLIP_LOW + 1)) > (uint32_t)(FRAME_CLIP_HIGH - FRAME_CLIP_LOW - 2);
+    }
+
+    sum += rowSum;
+    squares += rowSquares;
+    clipped += rowClipped;
+  }
+
+  const uint32_t pixels = (uint32_t)inner * (height - 2);
+  const int64_t mean = sum / (int64_t)pixels;
+  const uint64_t variance = squares / pixels - (uint64_t)(mean * mean);
+
+  quality.sharpness = variance > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)variance;
+  quality.clipped = (uint64_t)clipped * 1000 / pixels;
+  quality.score = (uint64_t)quality.sharpness * (pixels - clipped) / pixels;
+  return quality;
+}
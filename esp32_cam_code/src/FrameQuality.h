@@ -0,0 +1,32 @@
+/*
+ * Sharpness / exposure score of a grayscale thumbnail
+ *
+ * Sharpness is the variance of the 4-neighbour Laplacian: blurred frames
+ * (motion, focus, condensation) have little high-frequency energy left.
+ * Pixels at either end of the range are counted as clipped, and the score is
+ * scaled down by the clipped fraction so a washed-out frame under the flash
+ * LED loses against a slightly softer but properly exposed one.
+ *
+ * Integer-only single pass: the ESP32's Xtensa LX6 has no SIMD and its FPU
+ * is single precision, so squares are accumulated per row in 32 bits and
+ * folded into 64 bits once per row.
+ *
+ * Pure logic, no Arduino dependencies (benchmarked in env:quality_bench).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define FRAME_CLIP_LOW 5    // Grey levels at or below count as crushed shadows
+#define FRAME_CLIP_HIGH 250 // ... at or above as blown highlights
+
+struct FrameQuality
+{
+  uint32_t sharpness;   // Laplacian variance
+  uint16_t clipped;     // Clipped pixels (per mille)
+  uint32_t score;       // Sharpness weighted by the unclipped fraction
+};
+
+// Score a width x height grayscale image (row stride = width, at least 3x3)
+FrameQuality scoreFrame(const uint8_t *luma, uint16_t width, uint16_t height);
@@ -0,0 +1,138 @@
+#include "MotionDetector.h"
+
+#include <stdlib.h>
+
+MotionDetector::MotionDetector(const MotionConfig &config)
+    : config(config)
+{
+  eventCount = 0;
+  reset();
+}
+
+void MotionDetector::reset()
+{
+  blockCount = 0;
+  frameWidth = 0;
+  frameHeight = 0;
+  primed = false;
+  moving = false;
+  stillFrames = 0;
+  lastActive = 0;
+}
+
+MotionDetector::Event MotionDetector::process(const uint8_t *luma, uint16_t width, uint16_t height)
+{
+  const uint16_t size = config.blockSize;
+  const uint16_t columns = width / size;
+  const uint16_t rows = height / size;
+  if (columns == 0 || rows == 0 || columns * rows > MOTION_MAX_BLOCKS)
+    return NONE;
+
+  if (width != frameWidth || height != frameHeight)
+  {
+    reset();
+    frameWidth = width;
+    frameHeight = height;
+    blockCount = columns * rows;
+  }
+
+  // Block means (partial blocks at the right and bottom edge are ignored)
+  const uint16_t pixels = size * size;
+  for (uint16_t row = 0; row < rows; row++)
+  {
+    for (uint16_t column = 0; column < columns; column++)
+    {
+      const uint8_t *block = luma + (uint32_t)row * size * width + column * size;
+      uint32_t sum = 0;
+      for (uint16_t y = 0; y < size; y++, block += width)
+        for (uint16_t x = 0; x < size; x++)
+          sum += block[x];
+      current[row * columns + column] = sum / pixels;
+    }
+  }
+
+  if (!primed)
+  {
+    for (uint16_t i = 0; i < blockCount; i++)
+    {
+      background[i] = current[i] << 8;
+      previous[i] = current[i];
+    }
+    primed = true;
+    return NONE;
+  }
+
+  // Idle: look for change against the background. Moving: wait until frames
+  // stop changing from one to the next - the scene may stay different for good.
+  Event event = NONE;
+  if (!moving)
+  {
+    lastActive = countChanged(background, 8);
+    if (lastActive >= config.minBlocks)
+    {
+      moving = true;
+      stillFrames = 0;
+      eventCount++;
+      event = MOTION_STARTED;
+    }
+    else
+    {
+      // Follow slow changes (light, condensation) on still frames
+      for (uint16_t i = 0; i < blockCount; i++)
+      {
+        int32_t difference = ((int32_t)current[i] << 8) - background[i];
+        background[i] += difference / (1 << config.backgroundShift);
+      }
+    }
+  }
+  else
+  {
+    lastActive = countChanged(previous, 0);
+    if (lastActive >= config.minBlocks)
+      stillFrames = 0;
+    else if (++stillFrames >= config.settleFrames)
+    {
+      // The scene after the event becomes the new background
+      moving = false;
+      event = MOTION_SETTLED;
+      for (uint16_t i = 0; i < blockCount; i++)
+        background[i] = current[i] << 8;
+    }
+  }
+
+  for (uint16_t i = 0; i < blockCount; i++)
+    previous[i] = current[i];
+  return event;
+}
+
+// Blocks whose mean moved by more than the threshold once the global
+// brightness shift is taken out (reference holds values << shift)
+template <typename T>
+static uint16_t countChangedBlocks(const uint8_t *current, const T *reference, uint8_t shift,
+                                   uint16_t count, uint8_t blockThreshold)
+{
+  int32_t totalShift = 0;
+  for (uint16_t i = 0; i < count; i++)
+    totalShift += ((int32_t)current[i] << shift) - reference[i];
+  const int32_t globalShift = totalShift / count;
+
+  const int32_t threshold = (int32_t)blockThreshold << shift;
+  uint16_t changed = 0;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    int32_t difference = ((int32_t)current[i] << shift) - reference[i] - globalShift;
+    if (abs(difference) > threshold)
+      changed++;
+  }
+  return changed;
+}
+
+uint16_t MotionDetector::countChanged(const uint16_t *reference, uint8_t shift) const
+{
+  return countChangedBlocks(current, reference, shift, blockCount, config.blockThreshold);
+}
+
+uint16_t MotionDetector::countChanged(const uint8_t *reference, uint8_t shift) const
+{
+  return countChangedBlocks(current, reference, shift, blockCount, config.blockThreshold);
+}
@@ -0,0 +1,76 @@
+/*
+ * Block-based motion detector for the sentinel mode
+ *
+ * Each grayscale frame is split into blockSize x blockSize blocks and the
+ * block means are compared with a reference. The global brightness shift
+ * (auto exposure, a light switched on) is removed first, so only local
+ * changes count. A frame has changed when at least minBlocks blocks moved by
+ * more than blockThreshold grey levels.
+ *
+ * While idle the reference is a slowly adapting background: the first
+ * changed frame reports MOTION_STARTED. During an event the reference is the
+ * previous frame: after settleFrames frames without change MOTION_SETTLED is
+ * reported - that's when a full capture shows the scene after the event
+ * (door closed, crate put down) - and that scene becomes the background.
+ *
+ * Pure logic, no Arduino dependencies, so the kernel can be built and
+ * benchmarked on the host (env:motion_bench).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define MOTION_MAX_BLOCKS 1200 // 40x30 blocks, e.g. QVGA with 8x8 blocks
+
+struct MotionConfig
+{
+  uint8_t blockSize;       // Block edge length (pixels)
+  uint8_t blockThreshold;  // Block mean change (grey levels) that counts as moving
+  uint16_t minBlocks;      // Moving blocks needed for a motion frame
+  uint16_t settleFrames;   // Still frames in a row that end an event
+  uint8_t backgroundShift; // Background adapts by 1/2^shift of the difference per still frame
+};
+
+class MotionDetector
+{
+public:
+  enum Event
+  {
+    NONE,
+    MOTION_STARTED,
+    MOTION_SETTLED,
+  };
+
+  explicit MotionDetector(const MotionConfig &config);
+
+  // Feed one grayscale frame (row stride = width); the first frame only primes the background
+  Event process(const uint8_t *luma, uint16_t width, uint16_t height);
+
+  // Forget the background, e.g. after the frame size changed
+  void reset();
+
+  bool inMotion() const { return moving; }
+  uint16_t activeBlocks() const { return lastActive; } // Changed blocks in the last frame
+  uint16_t blocks() const { return blockCount; }
+  uint32_t events() const { return eventCount; }
+
+private:
+  uint16_t countChanged(const uint16_t *reference, uint8_t shift) const;
+  uint16_t countChanged(const uint8_t *reference, uint8_t shift) const;
+
+  MotionConfig config;
+
+  uint16_t background[MOTION_MAX_BLOCKS]; // Block means, Q8.8
+  uint8_t current[MOTION_MAX_BLOCKS];
+  uint8_t previous[MOTION_MAX_BLOCKS];
+  uint16_t blockCount;
+  uint16_t frameWidth;
+  uint16_t frameHeight;
+  bool primed;
+
+  bool moving;
+  uint16_t stillFrames;
+  uint16_t lastActive;
+  uint32_t eventCount;
+};
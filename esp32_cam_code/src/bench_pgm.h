@@ -0,0 +1,43 @@
+/*
+ * Recorded-frame loader shared by the host benchmarks (*_bench.cpp)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+struct Frame
+{
+  const char *name;
+  uint16_t width;
+  uint16_t height;
+  std::vector<uint8_t> luma;
+};
+
+// Load an 8-bit binary PGM ("P5")
+static inline bool loadPgm(const char *path, Frame &frame)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return false;
+
+  char magic[3] = {0};
+  unsigned width = 0, height = 0, maxValue = 0;
+  bool ok = fscanf(file, "%2s %u %u %u", magic, &width, &height, &maxValue) == 4 &&
+            strcmp(magic, "P5") == 0 && maxValue == 255 && width > 0 && height > 0 &&
+            width <= 0xFFFF && height <= 0xFFFF;
+  if (ok)
+  {
+    fgetc(file); // Single whitespace after the header
+    frame.name = path;
+    frame.width = width;
+    frame.height = height;
+    frame.luma.resize((size_t)width * height);
+    ok = fread(frame.luma.data(), 1, frame.luma.size(), file) == frame.luma.size();
+  }
+  fclose(file);
+  return ok;
+}
@@ -5,16 +5,40 @@
  */
 
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include "esp_camera.h"
 #include "esp_http_client.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+#include "img_converters.h"
+#include "MotionDetector.h"
+#include "FrameQuality.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 
 // WiFi credentials
 const char *ssid = "Talent";
 const char *password = "talent401";
 
 // Server endpoint
-const char *serverUrl = "http://172.20.10.2:3000/api/upload-image";
+const char *serverHost = "172.20.10.2";
+const uint16_t serverPort = 3000;
+const char *uploadPath = "/api/upload-image";
+const char *heartbeatPath = "/api/camera/heartbeat";
+
+// Image upload, streamed straight from the camera frame buffer. Raw mode sends
+// the JPEG as the request body (Content-Type: image/jpeg) with the metadata in
+// X-* headers, which the server hands to inference without temporary files;
+// multipart/form-data is kept for older servers.
+#define UPLOAD_RAW_JPEG true
+#define UPLOAD_BOUNDARY "ESP32CAMBoundary"
+#define UPLOAD_CHUNK_SIZE 4096    // Bytes handed to the socket per write
+#define UPLOAD_TIMEOUT_MS 10000   // Connect / response timeout
 
 // Camera pins for AI-Thinker ESP32-CAM
 #define PWDN_GPIO_NUM 32
@@ -38,17 +62,241 @@ const char *serverUrl = "http://172.20.10.2:3000/api/upload-image";
 #define FLASH_LED_PIN 4
 
 // Timing
-unsigned long lastCaptureTime = 0;
 const unsigned long captureInterval = 1800000; // Capture every 30 minutes
 
+// Deep-sleep mode for battery-backed units: instead of idling between
+// captures the camera sleeps, wakes on a timer (or the trigger pin), captures
+// and uploads one routine frame and goes back to sleep. The access point's
+// channel and BSSID and the IP lease are cached in RTC memory, so a wake
+// skips the scan and DHCP, and the camera starts while WiFi associates.
+// Sentinel mode and the trigger endpoint need the camera awake and are not
+// used in this mode.
+#define DEEP_SLEEP_ENABLED false
+#define WAKE_PIN GPIO_NUM_13           // Trigger input (RTC GPIO) for an immediate capture
+#define WAKE_PIN_LEVEL 1               // ... wakes while high
+// Wiring: the trigger drives GPIO13 high. It has no pull of its own in deep
+// sleep, so the RTC pull-down is enabled before sleeping; an unconnected or
+// floating input would otherwise keep waking the unit. Long trigger cables
+// want an external 10K pull-down to GND as well.
+#define FAST_CONNECT_TIMEOUT_MS 2500   // Cached association, from WiFi.begin()
+#define WIFI_CONNECT_TIMEOUT_MS 10000  // Scan + DHCP
+#define WAKE_BUDGET_MS 3000            // Target wake -> upload complete
+
+struct WiFiCache
+{
+  bool valid;
+  uint8_t bssid[6];
+  int32_t channel;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+// Survive deep sleep
+RTC_DATA_ATTR WiFiCache wifiCache = {};
+RTC_DATA_ATTR uint32_t wakeCycles = 0;
+RTC_DATA_ATTR uint32_t wakeOverBudget = 0;
+RTC_DATA_ATTR uint64_t wakeTotalMs = 0;
+RTC_DATA_ATTR uint32_t wakeMaxMs = 0;
+
+// Routine frames are sized for the YOLO model input (it downscales anything larger);
+// a full-resolution inspection frame is only taken when the server asks for one
+#define ROUTINE_FRAME_SIZE FRAMESIZE_VGA // 640x480
+#define ROUTINE_JPEG_QUALITY 12
+framesize_t inspectFrameSize = FRAMESIZE_UXGA; // Frame buffers are allocated for this size
+int inspectJpegQuality = 8;
+
+// Sentinel mode: between scheduled captures the camera keeps grabbing tiny
+// frames without flash and runs block-based motion detection on them. Once
+// motion has settled (door closed, crate put down) a routine capture is taken
+// and the periodic schedule restarts from there. The driver can't switch from
+// JPEG to raw output without a re-init, so sentinel frames are QQVGA JPEGs
+// decoded at half scale to 80x60 grayscale.
+#define SENTINEL_ENABLED true
+#define SENTINEL_FRAME_SIZE FRAMESIZE_QQVGA // 160x120
+#define SENTINEL_JPEG_QUALITY 20
+#define SENTINEL_INTERVAL_MS 250            // 4 fps
+#define SENTINEL_BLOCK_SIZE 4               // 20x15 blocks on the 80x60 frame
+#define SENTINEL_BLOCK_THRESHOLD 12         // Grey levels
+#define SENTINEL_MIN_BLOCKS 3
+#define SENTINEL_SETTLE_FRAMES 4            // 1 s without change ends an event
+#define SENTINEL_BACKGROUND_SHIFT 4         // Background follows 1/16 of slow changes per frame
+
+enum CaptureMode
+{
+  CAPTURE_ROUTINE,
+  CAPTURE_INSPECT,
+  CAPTURE_SENTINEL,
+  CAPTURE_TRIGGER,
+};
+
+// Capture trigger endpoint: GET http://<camera>/capture[?size=vga&quality=10&flash=0]
+// queues an immediate capture. Requests arriving while a triggered capture is
+// still on its way to the server are coalesced into it.
+#define TRIGGER_PORT 80
+#define NOTIFY_INSPECT 0x01 // Capture task notification bits
+#define NOTIFY_TRIGGER 0x02
+
+struct TriggerRequest
+{
+  framesize_t frameSize;
+  int quality;
+  bool flash;
+  int64_t receivedAt; // esp_timer_get_time()
+};
+
+TriggerRequest pendingTrigger;  // Written by the HTTP handler, read by the capture task
+TriggerRequest activeTrigger;   // Settings of the capture in progress (capture task only)
+bool triggerBusy = false;       // From an accepted request until its upload has finished
+uint32_t triggerCoalesced = 0;
+portMUX_TYPE triggerLock = portMUX_INITIALIZER_UNLOCKED;
+httpd_handle_t triggerServer = NULL;
+
+const MotionConfig motionConfig = {
+    SENTINEL_BLOCK_SIZE,
+    SENTINEL_BLOCK_THRESHOLD,
+    SENTINEL_MIN_BLOCKS,
+    SENTINEL_SETTLE_FRAMES,
+    SENTINEL_BACKGROUND_SHIFT,
+};
+MotionDetector motion(motionConfig);
+
+// Sentinel statistics since boot (capture task only)
+uint32_t sentinelFrames = 0;
+uint32_t motionCaptures = 0;
+uint64_t sentinelTime = 0; // µs for grab + decode + detection
+
+// Capture pipeline: the capture task fills one frame buffer while the upload
+// task sends the other, so bursts run at WiFi speed instead of capture + upload
+#define CAPTURE_BURST_FRAMES 1      // Frames per capture (more than 1 = burst mode)
+#define CAPTURE_BEST_OF 3           // Candidates scored per uploaded frame (sharpness + exposure)
+#define SCORE_MAX_WIDTH 200         // Candidates are scored on a thumbnail at most this wide
+#define FLASH_SETTLE_MS 300         // Flash + auto-exposure settling before a burst
+#define PIPELINE_REPORT_INTERVAL 60000
+
+#define CAPTURE_TASK_PRIORITY 2
+#define UPLOAD_TASK_PRIORITY 1
+#define CAPTURE_TASK_STACK 6144 // Stack sizes in bytes (capture includes the signature decode)
+#define UPLOAD_TASK_STACK 8192
+#define MAX_FRAME_BUFFERS 2
+
+// Scene-change detection: each routine frame is reduced to a 16x12 grayscale
+// thumbnail (1/8-scale JPEG decode, then block averages). If it barely differs
+// from the last uploaded frame, only a heartbeat is sent instead of the image.
+#define SIGNATURE_WIDTH 16
+#define SIGNATURE_HEIGHT 12
+#define SIGNATURE_DECODE_MAX (1600 / 8) * (1200 / 8) // Pixels of a 1/8-scale decode (UXGA)
+#define SCENE_MEAN_THRESHOLD 4   // Mean cell change (grey levels) below which the scene is unchanged
+#define SCENE_CELL_THRESHOLD 24  // ... as long as no single cell changed more than this
+#define SCENE_MAX_SKIPPED 7      // Upload every 8th routine frame regardless
+
+struct SceneSignature
+{
+  uint8_t cells[SIGNATURE_WIDTH * SIGNATURE_HEIGHT];
+};
+
+// Signature of the last uploaded frame; kept in RTC memory so it survives deep sleep
+RTC_DATA_ATTR SceneSignature lastSignature;
+RTC_DATA_ATTR bool haveLastSignature = false;
+RTC_DATA_ATTR uint8_t skippedInRow = 0;
+
+// 1/8-scale RGB565 decode buffer for the signature (capture task only)
+uint8_t *signatureDecodeBuffer = NULL;
+
+// A captured frame on its way from the capture task to the upload task
+// (times from esp_timer_get_time(), the clock the driver stamps frames with)
+struct CapturedFrame
+{
+  camera_fb_t *fb;
+  uint32_t number;
+  bool inspection;   // Full-resolution frame requested by the server
+  int64_t triggered; // Trigger request received (0 = not triggered)
+  int64_t requested; // esp_camera_fb_get() called
+  int64_t started;   // Sensor started the frame (fb->timestamp)
+  int64_t captured;  // Frame readout and on-sensor JPEG encoding done
+  int64_t queued;    // Handed to the upload task
+  uint8_t candidates;     // Frames scored to pick this one
+  FrameQuality quality;
+  uint32_t scoreTime;     // µs spent scoring all candidates
+  bool hasSignature;
+  uint32_t signatureTime; // µs spent computing it
+  SceneSignature signature;
+};
+
+// Per-stage latency totals since boot (written by the upload task only)
+struct PipelineStats
+{
+  uint32_t frames;
+  uint32_t failures; // Frames that could not be uploaded
+  uint64_t bytes;
+  uint64_t exposure; // Request -> frame start (µs)
+  uint64_t jpeg;     // Frame start -> buffer ready (µs)
+  uint64_t queue;    // Waiting for the upload task (µs)
+  uint64_t upload;   // Upload incl. server response (µs)
+  uint32_t skipped;  // Unchanged frames sent as a heartbeat only
+  uint32_t signatures;
+  uint64_t signatureTime; // µs
+  uint32_t triggers;       // Triggered captures delivered
+  uint64_t triggerLatency; // Request -> upload complete (µs)
+  uint64_t maxTriggerLatency;
+  uint32_t scored;         // Burst candidates scored
+  uint64_t scoreTime;      // µs
+  uint32_t sentinelFrames; // Copied from the capture task's counters when reporting
+  uint32_t motionCaptures;
+  uint64_t sentinelTime;
+};
+
+PipelineStats pipelineStats = {};
+size_t frameBufferCount = 1;
+
+// Frame buffers not held by the pipeline; the capture task waits here instead
+// of inside esp_camera_fb_get() when every buffer is still queued or uploading
+StaticSemaphore_t freeBuffersBuffer;
+SemaphoreHandle_t freeBuffers = NULL;
+
+StaticQueue_t frameQueueBuffer;
+uint8_t frameQueueStorage[MAX_FRAME_BUFFERS * sizeof(CapturedFrame)];
+QueueHandle_t frameQueue = NULL;
+
+// Statically allocated task stacks and control blocks
+StaticTask_t captureTaskBuffer;
+StaticTask_t uploadTaskBuffer;
+StackType_t captureTaskStack[CAPTURE_TASK_STACK];
+StackType_t uploadTaskStack[UPLOAD_TASK_STACK];
+TaskHandle_t captureTaskHandle = NULL;
+TaskHandle_t uploadTaskHandle = NULL;
+
 // Function declarations
 void connectWiFi();
+void runWakeCycle();
+bool beginWiFi();
+bool waitForWiFi(bool &fast, unsigned long begun);
+void enterDeepSleep();
 bool initCamera();
-void captureAndSendImage();
+void captureTask(void *parameter);
+void uploadTask(void *parameter);
+bool sendFrame(const CapturedFrame &frame, int64_t dequeued);
+void captureBurst(uint8_t frames, CaptureMode mode, bool flash = true, int64_t triggered = 0);
+void startTriggerServer();
+void finishTrigger();
+void setCaptureMode(CaptureMode mode);
+bool sentinelStep();
+void reportPipeline();
+bool computeSignature(camera_fb_t *fb, SceneSignature &signature);
+bool scoreCandidate(camera_fb_t *fb, FrameQuality &quality);
+bool sceneUnchanged(const CapturedFrame &frame, uint8_t &meanChange);
+int uploadJpeg(const camera_fb_t *fb, int64_t captured, const char *mode, String &response);
+int sendHeartbeat(uint32_t frameNumber, uint8_t meanChange, String &response);
 
 void setup()
 {
   Serial.begin(115200);
+
+  // Battery mode: one capture per wake, no time to lose on the banner
+  if (DEEP_SLEEP_ENABLED)
+    runWakeCycle(); // Ends in deep sleep
+
   delay(1000);
 
   Serial.println("\n╔═══════════════════════════════════════╗");
@@ -75,24 +323,27 @@ void setup()
     ESP.restart();
   }
 
-  Serial.println("🚀 ESP32-CAM ready for produce detection\n");
+  // One frame can be queued or uploading per frame buffer
+  frameQueue = xQueueCreateStatic(frameBufferCount, sizeof(CapturedFrame), frameQueueStorage, &frameQueueBuffer);
+  freeBuffers = xSemaphoreCreateCountingStatic(frameBufferCount, frameBufferCount, &freeBuffersBuffer);
+
+  // Upload task on core 0 next to the WiFi stack, capture task on core 1
+  uploadTaskHandle = xTaskCreateStaticPinnedToCore(uploadTask, "upload", UPLOAD_TASK_STACK, NULL,
+                                                   UPLOAD_TASK_PRIORITY, uploadTaskStack, &uploadTaskBuffer, PRO_CPU_NUM);
+  captureTaskHandle = xTaskCreateStaticPinnedToCore(captureTask, "capture", CAPTURE_TASK_STACK, NULL,
+                                                    CAPTURE_TASK_PRIORITY, captureTaskStack, &captureTaskBuffer, APP_CPU_NUM);
 
-  // Capture first image immediately on startup
-  Serial.println("📸 Taking initial capture...");
-  captureAndSendImage();
-  lastCaptureTime = millis();
+  startTriggerServer();
+
+  Serial.printf("🚀 ESP32-CAM ready for produce detection (%u frame buffers, %u frames per capture, best of %u)\n\n",
+                frameBufferCount, CAPTURE_BURST_FRAMES, frameBufferCount > 1 ? CAPTURE_BEST_OF : 1);
 }
 
 void loop()
 {
-  // Capture and send image at regular intervals
-  if (millis() - lastCaptureTime >= captureInterval)
-  {
-    captureAndSendImage();
-    lastCaptureTime = millis();
-  }
-
-  delay(100);
+  // Capturing and uploading happen in the FreeRTOS tasks; loop() only reports
+  vTaskDelay(pdMS_TO_TICKS(PIPELINE_REPORT_INTERVAL));
+  reportPipeline();
 }
 
 void connectWiFi()
@@ -128,6 +379,170 @@ void connectWiFi()
   }
 }
 
+// Deep-sleep cycle: start WiFi, bring the camera up while it associates,
+// capture and upload one frame (plus an inspection frame if the server asks),
+// then sleep until the next capture is due. Wake-to-upload time is measured
+// from esp_timer, which starts with the app - the ROM and bootloader before
+// it add roughly 0.2 s.
+void runWakeCycle()
+{
+  bool triggeredWake = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0;
+
+  // Pins were held through the sleep
+  gpio_hold_dis((gpio_num_t)PWDN_GPIO_NUM);
+  gpio_hold_dis((gpio_num_t)FLASH_LED_PIN);
+  pinMode(FLASH_LED_PIN, OUTPUT);
+  digitalWrite(FLASH_LED_PIN, LOW);
+
+  Serial.printf("\n⏰ Wake %u (%s)\n", wakeCycles + 1, triggeredWake ? "trigger pin" : "timer");
+
+  unsigned long begun = millis();
+  bool fast = beginWiFi();
+  bool cameraReady = initCamera();
+  int64_t cameraTime = esp_timer_get_time();
+  bool connected = waitForWiFi(fast, begun);
+  int64_t wifiTime = esp_timer_get_time();
+
+  if (!cameraReady || !connected)
+  {
+    Serial.println(cameraReady ? "✗ WiFi connection failed" : "✗ Camera initialization failed!");
+    enterDeepSleep();
+  }
+
+  frameQueue = xQueueCreateStatic(frameBufferCount, sizeof(CapturedFrame), frameQueueStorage, &frameQueueBuffer);
+  freeBuffers = xSemaphoreCreateCountingStatic(frameBufferCount, frameBufferCount, &freeBuffersBuffer);
+
+  // A trigger-pin wake is uploaded as a triggered frame, timed from the wake (esp_timer 0)
+  int64_t triggered = 0;
+  if (triggeredWake)
+  {
+    activeTrigger = {ROUTINE_FRAME_SIZE, ROUTINE_JPEG_QUALITY, true, 1};
+    triggerBusy = true;
+    triggered = activeTrigger.receivedAt;
+  }
+  captureBurst(1, triggeredWake ? CAPTURE_TRIGGER : CAPTURE_ROUTINE, true, triggered);
+
+  CapturedFrame frame;
+  bool inspect = xQueueReceive(frameQueue, &frame, 0) == pdTRUE && sendFrame(frame, esp_timer_get_time());
+  int64_t uploadTime = esp_timer_get_time();
+
+  uint32_t cycleMs = uploadTime / 1000;
+  wakeCycles++;
+  wakeTotalMs += cycleMs;
+  wakeMaxMs = max(wakeMaxMs, cycleMs);
+  if (cycleMs > WAKE_BUDGET_MS)
+    wakeOverBudget++;
+  Serial.printf("⏱  Wake to upload complete: %lu ms (camera %lu ms, WiFi %lu ms %s, capture + upload %lu ms)\n",
+                (unsigned long)cycleMs, (unsigned long)(cameraTime / 1000), (unsigned long)(wifiTime / 1000),
+                fast ? "cached" : "scan + DHCP", (unsigned long)((uploadTime - wifiTime) / 1000));
+  Serial.printf("⏱  %u wakes: average %lu ms, worst %lu ms, %u over %u ms\n", wakeCycles,
+                (unsigned long)(wakeTotalMs / wakeCycles), (unsigned long)wakeMaxMs, wakeOverBudget, WAKE_BUDGET_MS);
+
+  // The next wake may be 30 minutes off: take a requested inspection frame now
+  if (inspect)
+  {
+    Serial.println("🔍 Server asked for an inspection frame");
+    captureBurst(1, CAPTURE_INSPECT);
+    if (xQueueReceive(frameQueue, &frame, 0) == pdTRUE)
+      sendFrame(frame, esp_timer_get_time());
+  }
+
+  enterDeepSleep();
+}
+
+// Start associating; with a cached access point and lease there is no scan
+// and no DHCP. Returns true when the cached settings are used.
+bool beginWiFi()
+{
+  WiFi.persistent(false); // Don't rewrite the credentials to flash on every wake
+  WiFi.mode(WIFI_STA);
+
+  if (wifiCache.valid)
+  {
+    WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway), IPAddress(wifiCache.subnet),
+                IPAddress(wifiCache.dns));
+    WiFi.begin(ssid, password, wifiCache.channel, wifiCache.bssid);
+    return true;
+  }
+
+  WiFi.begin(ssid, password);
+  return false;
+}
+
+// Wait for the association started at "begun". A stale cache (access point on
+// another channel, lease given away) falls back to a scan + DHCP once and
+// clears "fast".
+bool waitForWiFi(bool &fast, unsigned long begun)
+{
+  unsigned long timeout = fast ? FAST_CONNECT_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS;
+  while (WiFi.status() != WL_CONNECTED && millis() - begun < timeout)
+    delay(10);
+
+  if (WiFi.status() != WL_CONNECTED && fast)
+  {
+    Serial.println("⚠️  Cached WiFi settings failed, scanning");
+    wifiCache.valid = false;
+    fast = false;
+    WiFi.disconnect();
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0)); // Back to DHCP
+    WiFi.begin(ssid, password);
+    begun = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - begun < WIFI_CONNECT_TIMEOUT_MS)
+      delay(10);
+  }
+
+  if (WiFi.status() != WL_CONNECTED)
+    return false;
+
+  if (!wifiCache.valid)
+  {
+    memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+    wifiCache.channel = WiFi.channel();
+    wifiCache.ip = WiFi.localIP();
+    wifiCache.gateway = WiFi.gatewayIP();
+    wifiCache.subnet = WiFi.subnetMask();
+    wifiCache.dns = WiFi.dnsIP();
+    wifiCache.valid = true;
+    Serial.printf("📶 WiFi settings cached (channel %d, IP %s)\n", wifiCache.channel, WiFi.localIP().toString().c_str());
+  }
+  return true;
+}
+
+// Power the sensor down, keep the flash LED off and sleep until the next
+// capture is due (the period counts from the last wake) or the trigger pin
+void enterDeepSleep()
+{
+  uint64_t period = (uint64_t)captureInterval * 1000;
+  uint64_t elapsed = esp_timer_get_time();
+  uint64_t sleepTime = period > elapsed + 1000000 ? period - elapsed : 1000000;
+
+  esp_camera_deinit();
+  pinMode(PWDN_GPIO_NUM, OUTPUT);
+  digitalWrite(PWDN_GPIO_NUM, HIGH);
+  digitalWrite(FLASH_LED_PIN, LOW);
+  gpio_hold_en((gpio_num_t)PWDN_GPIO_NUM);
+  gpio_hold_en((gpio_num_t)FLASH_LED_PIN);
+  gpio_deep_sleep_hold_en();
+
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+
+  // Hold the trigger input at its idle level (ext0 keeps the RTC pulls powered)
+#if WAKE_PIN_LEVEL
+  rtc_gpio_pullup_dis(WAKE_PIN);
+  rtc_gpio_pulldown_en(WAKE_PIN);
+#else
+  rtc_gpio_pulldown_dis(WAKE_PIN);
+  rtc_gpio_pullup_en(WAKE_PIN);
+#endif
+
+  esp_sleep_enable_timer_wakeup(sleepTime);
+  esp_sleep_enable_ext0_wakeup(WAKE_PIN, WAKE_PIN_LEVEL);
+  Serial.printf("💤 Deep sleep for %lu s\n\n", (unsigned long)(sleepTime / 1000000));
+  Serial.flush();
+  esp_deep_sleep_start();
+}
+
 bool initCamera()
 {
   Serial.println("📷 Initializing camera...");
@@ -168,6 +583,10 @@ bool initCamera()
     config.jpeg_quality = 10;
     config.fb_count = 1;
   }
+  frameBufferCount = config.fb_count; // With one buffer the pipeline runs capture and upload in turn
+  signatureDecodeBuffer = (uint8_t *)heap_caps_malloc(SIGNATURE_DECODE_MAX * 2, psramFound() ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT);
+  inspectFrameSize = config.frame_size;
+  inspectJpegQuality = config.jpeg_quality;
 
   // Initialize camera
   esp_err_t err = esp_camera_init(&config);
@@ -204,102 +623,744 @@ bool initCamera()
     s->set_colorbar(s, 0);                   // No test pattern
   }
 
+  // Routine captures use the smaller size; buffers stay large enough for inspection frames
+  setCaptureMode(CAPTURE_ROUTINE);
+
   return true;
 }
 
-void captureAndSendImage()
+// Grey level of an RGB565 pixel (high byte first, as jpg2rgb565 writes it)
+static inline uint8_t rgb565Luma(const uint8_t *pixel)
 {
-  Serial.println("📸 Capturing image...");
+  uint8_t r = pixel[0] & 0xF8;
+  uint8_t g = ((pixel[0] & 0x07) << 5) | ((pixel[1] & 0xE0) >> 3);
+  uint8_t b = (pixel[1] & 0x1F) << 3;
+  return (r * 77 + g * 150 + b * 29) >> 8;
+}
 
-  // Turn on flash for better lighting
-  digitalWrite(FLASH_LED_PIN, HIGH);
-  delay(300); // Let flash stabilize and allow auto-exposure to adjust
+// Switch the sensor between the routine, inspection and sentinel frame size
+void setCaptureMode(CaptureMode mode)
+{
+  static int current = -1;
+  if (current == mode && mode != CAPTURE_TRIGGER)
+    return;
+
+  sensor_t *s = esp_camera_sensor_get();
+  if (s == NULL)
+    return;
+
+  switch (mode)
+  {
+  case CAPTURE_ROUTINE:
+    s->set_framesize(s, ROUTINE_FRAME_SIZE);
+    s->set_quality(s, ROUTINE_JPEG_QUALITY);
+    break;
+  case CAPTURE_INSPECT:
+    s->set_framesize(s, inspectFrameSize);
+    s->set_quality(s, inspectJpegQuality);
+    break;
+  case CAPTURE_SENTINEL:
+    s->set_framesize(s, SENTINEL_FRAME_SIZE);
+    s->set_quality(s, SENTINEL_JPEG_QUALITY);
+    motion.reset(); // Frames from before the capture are stale
+    break;
+  case CAPTURE_TRIGGER:
+    s->set_framesize(s, activeTrigger.frameSize);
+    s->set_quality(s, activeTrigger.quality);
+    break;
+  }
+  current = mode;
+}
+
+// Capture task: a routine burst every captureInterval (the first one right
+// after boot), plus an inspection frame whenever the upload task asks for one
+// and a frame for every accepted trigger request. In sentinel mode a settled
+// motion event triggers a routine burst early.
+void captureTask(void *parameter)
+{
+  const TickType_t interval = pdMS_TO_TICKS(captureInterval);
+  TickType_t lastRoutine = xTaskGetTickCount();
+  captureBurst(CAPTURE_BURST_FRAMES, CAPTURE_ROUTINE);
+  uint32_t notified = 0;
+
+  for (;;)
+  {
+    TickType_t elapsed = xTaskGetTickCount() - lastRoutine;
+    TickType_t wait = interval - elapsed;
+    if (SENTINEL_ENABLED)
+      wait = min(wait, pdMS_TO_TICKS(SENTINEL_INTERVAL_MS));
+
+    if (elapsed >= interval)
+    {
+      lastRoutine += interval;
+      captureBurst(CAPTURE_BURST_FRAMES, CAPTURE_ROUTINE);
+    }
+    else if (xTaskNotifyWait(0, NOTIFY_INSPECT | NOTIFY_TRIGGER, &notified, wait) == pdTRUE)
+    {
+      if (notified & NOTIFY_TRIGGER)
+      {
+        portENTER_CRITICAL(&triggerLock);
+        activeTrigger = pendingTrigger;
+        portEXIT_CRITICAL(&triggerLock);
+        captureBurst(1, CAPTURE_TRIGGER, activeTrigger.flash, activeTrigger.receivedAt);
+      }
+      if (notified & NOTIFY_INSPECT)
+        captureBurst(1, CAPTURE_INSPECT);
+    }
+    else if (SENTINEL_ENABLED && sentinelStep())
+    {
+      Serial.println("🚪 Motion settled, capturing the scene");
+      motionCaptures++;
+      lastRoutine = xTaskGetTickCount(); // The periodic schedule is only the fallback
+      captureBurst(CAPTURE_BURST_FRAMES, CAPTURE_ROUTINE);
+    }
+  }
+}
+
+// Grab one small frame and run motion detection on it; returns true when a
+// motion event has just settled
+bool sentinelStep()
+{
+  int64_t start = esp_timer_get_time();
+  setCaptureMode(CAPTURE_SENTINEL);
+
+  // Don't wait for a buffer: if both are busy uploading, skip this frame
+  if (xSemaphoreTake(freeBuffers, 0) != pdTRUE)
+    return false;
 
-  // Discard first frame (often cached/old)
   camera_fb_t *fb = esp_camera_fb_get();
+  bool decoded = false;
+  uint16_t width = 0, height = 0;
   if (fb)
   {
+    width = fb->width / 2;
+    height = fb->height / 2;
+    decoded = signatureDecodeBuffer != NULL && (size_t)width * height <= SIGNATURE_DECODE_MAX &&
+              jpg2rgb565(fb->buf, fb->len, signatureDecodeBuffer, JPG_SCALE_2X);
     esp_camera_fb_return(fb);
-    delay(100); // Wait a bit
   }
+  xSemaphoreGive(freeBuffers);
+  if (!decoded)
+    return false;
+
+  // RGB565 -> grayscale in place (pixel i is read from byte 2i before byte i is written)
+  for (size_t i = 0; i < (size_t)width * height; i++)
+    signatureDecodeBuffer[i] = rgb565Luma(signatureDecodeBuffer + 2 * i);
+
+  MotionDetector::Event event = motion.process(signatureDecodeBuffer, width, height);
+  sentinelFrames++;
+  sentinelTime += esp_timer_get_time() - start;
+
+  if (event == MotionDetector::MOTION_STARTED)
+    Serial.printf("🚪 Motion detected (%u of %u blocks changed)\n", motion.activeBlocks(), motion.blocks());
+  return event == MotionDetector::MOTION_SETTLED;
+}
+
+// Capture frames back to back and hand each to the upload task; only waits
+// when every frame buffer is still queued or uploading. Each uploaded frame is
+// the best of CAPTURE_BEST_OF candidates, which avoids blurred or washed-out
+// frames under the flash LED.
+void captureBurst(uint8_t frames, CaptureMode mode, bool flash, int64_t triggered)
+{
+  static uint32_t frameNumber = 0;
+  const bool inspection = mode == CAPTURE_INSPECT;
+
+  Serial.printf("📸 Capturing %u %s frame(s)...\n", frames,
+                inspection ? "inspection" : triggered != 0 ? "triggered" : "routine");
+  setCaptureMode(mode);
+
+  // Turn on flash for better lighting
+  if (flash)
+  {
+    digitalWrite(FLASH_LED_PIN, HIGH);
+    vTaskDelay(pdMS_TO_TICKS(FLASH_SETTLE_MS)); // Let flash stabilize and allow auto-exposure to adjust
+  }
+
+  // Discard the first frame: it may have been exposed before the flash came on
+  // or at the previous frame size
+  xSemaphoreTake(freeBuffers, portMAX_DELAY);
+  camera_fb_t *stale = esp_camera_fb_get();
+  if (stale)
+    esp_camera_fb_return(stale);
+  xSemaphoreGive(freeBuffers);
+
+  // Keeping the best candidate while grabbing the next one needs a second buffer
+  const uint8_t candidates = frameBufferCount > 1 ? CAPTURE_BEST_OF : 1;
+
+  for (uint8_t i = 0; i < frames; i++)
+  {
+    CapturedFrame frame;
+    frame.fb = NULL;
+    frame.candidates = 0;
+    frame.scoreTime = 0;
+
+    // Grab the candidates and keep the sharpest, properly exposed one
+    for (uint8_t c = 0; c < candidates; c++)
+    {
+      xSemaphoreTake(freeBuffers, portMAX_DELAY);
+
+      int64_t requested = esp_timer_get_time();
+      camera_fb_t *fb = esp_camera_fb_get();
+      int64_t captured = esp_timer_get_time();
+      if (!fb)
+      {
+        xSemaphoreGive(freeBuffers);
+        continue;
+      }
+
+      FrameQuality quality = {0, 0, 0};
+      if (candidates > 1)
+      {
+        int64_t scoreStart = esp_timer_get_time();
+        scoreCandidate(fb, quality);
+        frame.scoreTime += esp_timer_get_time() - scoreStart;
+      }
+      frame.candidates++;
+
+      if (frame.fb != NULL && quality.score <= frame.quality.score)
+      {
+        esp_camera_fb_return(fb);
+        xSemaphoreGive(freeBuffers);
+        continue;
+      }
+
+      if (frame.fb != NULL)
+      {
+        esp_camera_fb_return(frame.fb);
+        xSemaphoreGive(freeBuffers);
+      }
+      frame.fb = fb;
+      frame.quality = quality;
+      frame.requested = requested;
+      frame.captured = captured;
+    }
+
+    if (!frame.fb)
+    {
+      Serial.println("✗ Camera capture failed");
+      if (triggered != 0)
+        finishTrigger();
+      continue;
+    }
+
+    if (candidates > 1)
+      Serial.printf("🎯 Best of %u: sharpness %u, clipped %u‰ (scoring %lu µs)\n", frame.candidates,
+                    frame.quality.sharpness, frame.quality.clipped, (unsigned long)frame.scoreTime);
 
-  // Capture fresh image
-  fb = esp_camera_fb_get();
+    // With CAMERA_GRAB_LATEST the frame may have started before we asked for it
+    frame.started = (int64_t)frame.fb->timestamp.tv_sec * 1000000 + frame.fb->timestamp.tv_usec;
+    frame.started = constrain(frame.started, frame.requested, frame.captured);
+    frame.number = ++frameNumber;
+    frame.inspection = inspection;
+    frame.triggered = triggered;
+
+    // Signature on this core, so the upload task only has to compare
+    frame.hasSignature = false;
+    frame.signatureTime = 0;
+    if (!inspection)
+    {
+      int64_t signatureStart = esp_timer_get_time();
+      frame.hasSignature = computeSignature(frame.fb, frame.signature);
+      frame.signatureTime = esp_timer_get_time() - signatureStart;
+    }
+
+    frame.queued = esp_timer_get_time();
+    xQueueSend(frameQueue, &frame, portMAX_DELAY); // Never blocks: the queue holds one entry per buffer
+  }
 
   // Turn off flash
   digitalWrite(FLASH_LED_PIN, LOW);
+}
 
-  if (!fb)
+// Upload task: sends queued frames and gives their buffers back to the camera
+void uploadTask(void *parameter)
+{
+  CapturedFrame frame;
+  for (;;)
   {
-    Serial.println("✗ Camera capture failed");
-    return;
+    xQueueReceive(frameQueue, &frame, portMAX_DELAY);
+
+    // Borderline detection or a request from the dashboard: follow up with a full-resolution frame
+    if (sendFrame(frame, esp_timer_get_time()))
+    {
+      Serial.println("🔍 Server asked for an inspection frame");
+      xTaskNotify(captureTaskHandle, NOTIFY_INSPECT, eSetBits);
+    }
   }
+}
 
-  Serial.printf("✓ Image captured: %d bytes, %dx%d pixels\n",
-                fb->len, fb->width, fb->height);
+// Upload one captured frame (or a heartbeat for an unchanged scene), give its
+// buffer back and account for it; returns true when the server asked for an
+// inspection frame
+bool sendFrame(const CapturedFrame &frame, int64_t dequeued)
+{
+  Serial.printf("✓ Image %u captured: %d bytes, %dx%d pixels\n",
+                frame.number, frame.fb->len, frame.fb->width, frame.fb->height);
 
-  // Send image to server
-  if (WiFi.status() == WL_CONNECTED)
+  if (frame.candidates > 1)
   {
-    HTTPClient http;
+    pipelineStats.scored += frame.candidates;
+    pipelineStats.scoreTime += frame.scoreTime;
+  }
+  if (frame.hasSignature)
+  {
+    pipelineStats.signatures++;
+    pipelineStats.signatureTime += frame.signatureTime;
+  }
+
+  uint8_t meanChange = 0;
+  bool unchanged = sceneUnchanged(frame, meanChange);
+  size_t length = frame.fb->len;
 
+  // An unchanged frame isn't needed for the heartbeat: give it back right away
+  if (unchanged)
+  {
+    esp_camera_fb_return(frame.fb);
+    xSemaphoreGive(freeBuffers);
+  }
+
+  int httpResponseCode = -1;
+  String response;
+  if (WiFi.status() != WL_CONNECTED)
+  {
+    Serial.println("✗ WiFi disconnected, cannot send image");
+  }
+  else if (unchanged)
+  {
+    Serial.printf("💤 Scene unchanged (mean change %u), sending heartbeat... ", meanChange);
+    httpResponseCode = sendHeartbeat(frame.number, meanChange, response);
+  }
+  else
+  {
     Serial.print("📤 Uploading to server... ");
+    const char *mode = frame.inspection ? "inspect" : frame.triggered != 0 ? "trigger" : "routine";
+    httpResponseCode = uploadJpeg(frame.fb, frame.captured, mode, response);
+  }
+  int64_t uploaded = esp_timer_get_time();
+
+  // Return frame buffer before anything slow, so the capture task can refill it
+  if (!unchanged)
+  {
+    esp_camera_fb_return(frame.fb);
+    xSemaphoreGive(freeBuffers);
+  }
 
-    http.begin(serverUrl);
-    http.addHeader("Content-Type", "multipart/form-data; boundary=ESP32CAMBoundary");
+  // Only a 2xx means the server has the frame (200, or 202 with inference still to run);
+  // an error answer must not become the signature later frames are compared with
+  bool delivered = httpResponseCode >= 200 && httpResponseCode < 300;
+  if (delivered && unchanged)
+  {
+    Serial.printf("OK (HTTP %d)\n", httpResponseCode);
+    skippedInRow++;
+    pipelineStats.skipped++;
+  }
+  else if (delivered)
+  {
+    // Later frames are compared with the last one the server actually has
+    if (frame.hasSignature)
+    {
+      lastSignature = frame.signature;
+      haveLastSignature = true;
+      skippedInRow = 0;
+    }
 
-    // Build multipart form data
-    String boundary = "ESP32CAMBoundary";
-    String header = "--" + boundary + "\r\n";
-    header += "Content-Disposition: form-data; name=\"image\"; filename=\"produce.jpg\"\r\n";
-    header += "Content-Type: image/jpeg\r\n\r\n";
+    Serial.printf("Success! (HTTP %d)\n", httpResponseCode);
+    Serial.println("📥 Server response:");
+    Serial.println(response);
 
-    String footer = "\r\n--" + boundary + "--\r\n";
+    pipelineStats.frames++;
+    pipelineStats.bytes += length;
+    pipelineStats.exposure += frame.started - frame.requested;
+    pipelineStats.jpeg += frame.captured - frame.started;
+    pipelineStats.queue += dequeued - frame.queued;
+    pipelineStats.upload += uploaded - dequeued;
+  }
+  else
+  {
+    pipelineStats.failures++;
+    if (httpResponseCode > 0)
+      Serial.printf("Failed! (HTTP %d)\n", httpResponseCode);
+    else if (WiFi.status() == WL_CONNECTED)
+      Serial.println("Failed! Could not reach server");
+    else if (!DEEP_SLEEP_ENABLED)
+      connectWiFi(); // Try to reconnect
+  }
 
-    uint32_t totalLen = header.length() + fb->len + footer.length();
+  // The server answers uploads before running YOLO (202 + job id), so a borderline result
+  // comes back with the next upload or heartbeat instead of blocking this one
+  bool inspect = delivered && !frame.inspection && response.indexOf("\"inspect\":true") >= 0;
 
-    // Allocate buffer for complete request
-    uint8_t *requestBuffer = (uint8_t *)malloc(totalLen);
-    if (requestBuffer == NULL)
+  // Triggered capture delivered (or given up): later requests start a new one
+  if (frame.triggered != 0)
+  {
+    uint64_t latency = uploaded - frame.triggered;
+    if (delivered)
     {
-      Serial.println("✗ Failed to allocate memory");
-      esp_camera_fb_return(fb);
-      return;
+      pipelineStats.triggers++;
+      pipelineStats.triggerLatency += latency;
+      pipelineStats.maxTriggerLatency = max(pipelineStats.maxTriggerLatency, latency);
     }
+    Serial.printf("⚡ Trigger to upload complete: %lu ms\n", (unsigned long)(latency / 1000));
+    finishTrigger();
+  }
 
-    // Build complete request
-    memcpy(requestBuffer, header.c_str(), header.length());
-    memcpy(requestBuffer + header.length(), fb->buf, fb->len);
-    memcpy(requestBuffer + header.length() + fb->len, footer.c_str(), footer.length());
+  Serial.printf("📊 Frame %u: exposure %lu ms, JPEG %lu ms, queue wait %lu ms, upload %lu ms\n\n",
+                frame.number, (unsigned long)((frame.started - frame.requested) / 1000),
+                (unsigned long)((frame.captured - frame.started) / 1000),
+                (unsigned long)((dequeued - frame.queued) / 1000), (unsigned long)((uploaded - dequeued) / 1000));
+  return inspect;
+}
 
-    // Send POST request
-    int httpResponseCode = http.POST(requestBuffer, totalLen);
+// Throughput and average per-stage latency since the last report
+void reportPipeline()
+{
+  static PipelineStats reported = {};
+  PipelineStats total = pipelineStats;
+  PipelineStats stats;
+  stats.frames = total.frames - reported.frames;
+  stats.failures = total.failures - reported.failures;
+  stats.bytes = total.bytes - reported.bytes;
+  stats.exposure = total.exposure - reported.exposure;
+  stats.jpeg = total.jpeg - reported.jpeg;
+  stats.queue = total.queue - reported.queue;
+  stats.upload = total.upload - reported.upload;
+  stats.skipped = total.skipped - reported.skipped;
+  stats.signatures = total.signatures - reported.signatures;
+  stats.signatureTime = total.signatureTime - reported.signatureTime;
+  stats.scored = total.scored - reported.scored;
+  stats.triggers = total.triggers - reported.triggers;
+  stats.triggerLatency = total.triggerLatency - reported.triggerLatency;
+  stats.scoreTime = total.scoreTime - reported.scoreTime;
+  total.sentinelFrames = sentinelFrames;
+  total.motionCaptures = motionCaptures;
+  total.sentinelTime = sentinelTime;
+  stats.sentinelFrames = total.sentinelFrames - reported.sentinelFrames;
+  stats.motionCaptures = total.motionCaptures - reported.motionCaptures;
+  stats.sentinelTime = total.sentinelTime - reported.sentinelTime;
+  reported = total;
 
-    free(requestBuffer);
+  if (stats.sentinelFrames > 0)
+    Serial.printf("\n📊 Sentinel: %.1f fps, %lu µs per frame, %u motion capture(s)\n",
+                  stats.sentinelFrames * 1000.0 / PIPELINE_REPORT_INTERVAL,
+                  (unsigned long)(stats.sentinelTime / stats.sentinelFrames), stats.motionCaptures);
 
-    if (httpResponseCode > 0)
+  if (stats.frames == 0 && stats.failures == 0 && stats.skipped == 0)
+    return;
+
+  uint32_t n = max(stats.frames, (uint32_t)1);
+  Serial.println("\n📊 Capture pipeline:");
+  Serial.printf("   %.1f frames/min, %lu KB uploaded, %u failed\n",
+                stats.frames * 60000.0 / PIPELINE_REPORT_INTERVAL, (unsigned long)(stats.bytes / 1024), stats.failures);
+  Serial.printf("   Avg exposure %lu ms, JPEG %lu ms, queue wait %lu ms, upload %lu ms\n\n",
+                (unsigned long)(stats.exposure / n / 1000), (unsigned long)(stats.jpeg / n / 1000),
+                (unsigned long)(stats.queue / n / 1000), (unsigned long)(stats.upload / n / 1000));
+  Serial.printf("   Scene unchanged: %u skipped (%.0f%% of routine frames), signature avg %lu µs\n\n",
+                stats.skipped, stats.signatures > 0 ? stats.skipped * 100.0 / stats.signatures : 0.0,
+                stats.signatures > 0 ? (unsigned long)(stats.signatureTime / stats.signatures) : 0UL);
+  if (stats.triggers > 0)
+    Serial.printf("   Triggers: %u delivered, avg %lu ms, worst %lu ms since boot (%u coalesced since boot)\n\n",
+                  stats.triggers, (unsigned long)(stats.triggerLatency / stats.triggers / 1000),
+                  (unsigned long)(total.maxTriggerLatency / 1000), triggerCoalesced);
+  if (stats.scored > 0)
+    Serial.printf("   Burst scoring: %u candidates, %lu µs each\n\n", stats.scored,
+                  (unsigned long)(stats.scoreTime / stats.scored));
+}
+
+// Reduce a frame to a grayscale thumbnail: decode the JPEG at 1/8 scale and
+// average the pixels into SIGNATURE_WIDTH x SIGNATURE_HEIGHT cells
+bool computeSignature(camera_fb_t *fb, SceneSignature &signature)
+{
+  size_t width = fb->width / 8;
+  size_t height = fb->height / 8;
+  if (signatureDecodeBuffer == NULL || width * height > SIGNATURE_DECODE_MAX ||
+      width < SIGNATURE_WIDTH || height < SIGNATURE_HEIGHT)
+    return false;
+
+  if (!jpg2rgb565(fb->buf, fb->len, signatureDecodeBuffer, JPG_SCALE_8X))
+    return false;
+
+  uint32_t sums[SIGNATURE_WIDTH * SIGNATURE_HEIGHT] = {0};
+  uint16_t counts[SIGNATURE_WIDTH * SIGNATURE_HEIGHT] = {0};
+  const uint8_t *pixel = signatureDecodeBuffer;
+  for (size_t y = 0; y < height; y++)
+  {
+    size_t row = (y * SIGNATURE_HEIGHT / height) * SIGNATURE_WIDTH;
+    for (size_t x = 0; x < width; x++, pixel += 2)
     {
-      Serial.printf("Success! (HTTP %d)\n", httpResponseCode);
+      size_t cell = row + x * SIGNATURE_WIDTH / width;
+      sums[cell] += rgb565Luma(pixel);
+      counts[cell]++;
+    }
+  }
+
+  for (size_t i = 0; i < SIGNATURE_WIDTH * SIGNATURE_HEIGHT; i++)
+    signature.cells[i] = sums[i] / counts[i];
+  return true;
+}
+
+// Sharpness / exposure score of a burst candidate, on a thumbnail decoded at
+// 1/4 or 1/8 scale (whichever fits SCORE_MAX_WIDTH)
+bool scoreCandidate(camera_fb_t *fb, FrameQuality &quality)
+{
+  bool quarter = fb->width / 4 <= SCORE_MAX_WIDTH;
+  uint16_t width = fb->width / (quarter ? 4 : 8);
+  uint16_t height = fb->height / (quarter ? 4 : 8);
+  if (signatureDecodeBuffer == NULL || (size_t)width * height > SIGNATURE_DECODE_MAX)
+    return false;
+
+  if (!jpg2rgb565(fb->buf, fb->len, signatureDecodeBuffer, quarter ? JPG_SCALE_4X : JPG_SCALE_8X))
+    return false;
 
-      String response = http.getString();
-      Serial.println("📥 Server response:");
-      Serial.println(response);
+  for (size_t i = 0; i < (size_t)width * height; i++)
+    signatureDecodeBuffer[i] = rgb565Luma(signatureDecodeBuffer + 2 * i);
+
+  quality = scoreFrame(signatureDecodeBuffer, width, height);
+  return true;
+}
+
+// Compare a routine frame with the last uploaded one; inspection and triggered
+// frames and every (SCENE_MAX_SKIPPED + 1)th frame always count as changed
+bool sceneUnchanged(const CapturedFrame &frame, uint8_t &meanChange)
+{
+  meanChange = 0;
+  if (frame.inspection || frame.triggered != 0 || !frame.hasSignature || !haveLastSignature || skippedInRow >= SCENE_MAX_SKIPPED)
+    return false;
+
+  uint32_t total = 0;
+  uint8_t largest = 0;
+  for (size_t i = 0; i < SIGNATURE_WIDTH * SIGNATURE_HEIGHT; i++)
+  {
+    uint8_t change = abs((int)frame.signature.cells[i] - (int)lastSignature.cells[i]);
+    total += change;
+    largest = max(largest, change);
+  }
+  meanChange = total / (SIGNATURE_WIDTH * SIGNATURE_HEIGHT);
+
+  return meanChange < SCENE_MEAN_THRESHOLD && largest < SCENE_CELL_THRESHOLD;
+}
+
+// Free heap right now, and the lowest value seen during the current upload
+static size_t uploadMinInternal = 0;
+static size_t uploadMinPsram = 0;
+
+static void trackUploadHeap()
+{
+  uploadMinInternal = min(uploadMinInternal, heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+  uploadMinPsram = min(uploadMinPsram, heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+}
+
+// Read an HTTP/1.1 response on a "Connection: close" request and close the socket;
+// returns the HTTP status, or -1 without a valid status line
+static int readResponse(WiFiClient &client, String &response)
+{
+  // Status line: "HTTP/1.1 200 OK"
+  unsigned long waitStart = millis();
+  while (!client.available() && client.connected() && millis() - waitStart < UPLOAD_TIMEOUT_MS)
+    delay(10);
+
+  String statusLine = client.readStringUntil('\n');
+  int httpResponseCode = statusLine.startsWith("HTTP/") ? statusLine.substring(9, 12).toInt() : -1;
+
+  // Skip the response headers; the body runs until the server closes the connection
+  while (client.connected() || client.available())
+  {
+    String line = client.readStringUntil('\n');
+    if (line.length() <= 1)
+      break;
+  }
+  response = client.readString();
+  client.stop();
+  return httpResponseCode;
+}
+
+// Stream a JPEG to the server without copying it: request headers (plus the
+// multipart header), then the frame buffer in chunks (then the multipart
+// footer). Returns the HTTP status, or -1 if the upload failed.
+int uploadJpeg(const camera_fb_t *fb, int64_t captured, const char *mode, String &response)
+{
+  static const char multipartHeader[] =
+      "--" UPLOAD_BOUNDARY "\r\n"
+      "Content-Disposition: form-data; name=\"image\"; filename=\"produce.jpg\"\r\n"
+      "Content-Type: image/jpeg\r\n\r\n";
+  static const char multipartFooter[] = "\r\n--" UPLOAD_BOUNDARY "--\r\n";
+  static String deviceId = WiFi.macAddress();
+
+  const uint8_t *jpeg = fb->buf;
+  size_t length = fb->len;
+  size_t contentLength = length;
+  if (!UPLOAD_RAW_JPEG)
+    contentLength += (sizeof(multipartHeader) - 1) + (sizeof(multipartFooter) - 1);
+
+  size_t startInternal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  size_t startPsram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  uploadMinInternal = startInternal;
+  uploadMinPsram = startPsram;
+  unsigned long startTime = millis();
+
+  WiFiClient client;
+  if (!client.connect(serverHost, serverPort, UPLOAD_TIMEOUT_MS))
+  {
+    Serial.printf("✗ Connection to %s:%u failed\n", serverHost, serverPort);
+    return -1;
+  }
+  trackUploadHeap();
+
+  // The device has no wall clock: the server dates the frame by its age on arrival
+  client.printf("POST %s?mode=%s HTTP/1.1\r\n"
+                "Host: %s:%u\r\n"
+                "Content-Type: %s\r\n"
+                "Content-Length: %u\r\n"
+                "X-Device-Id: %s\r\n"
+                "X-Capture-Age-Ms: %lu\r\n"
+                "X-Frame-Size: %ux%u\r\n"
+                "Connection: close\r\n\r\n",
+                uploadPath, mode, serverHost, serverPort,
+                UPLOAD_RAW_JPEG ? "image/jpeg" : "multipart/form-data; boundary=" UPLOAD_BOUNDARY, contentLength,
+                deviceId.c_str(), (unsigned long)((esp_timer_get_time() - captured) / 1000), fb->width, fb->height);
+  if (!UPLOAD_RAW_JPEG)
+    client.write((const uint8_t *)multipartHeader, sizeof(multipartHeader) - 1);
+
+  // The JPEG goes out directly from the camera frame buffer
+  size_t sent = 0;
+  while (sent < length)
+  {
+    size_t written = client.write(jpeg + sent, min((size_t)UPLOAD_CHUNK_SIZE, length - sent));
+    if (written == 0)
+    {
+      Serial.printf("✗ Upload stalled after %u of %u bytes\n", sent, length);
+      client.stop();
+      return -1;
     }
-    else
+    sent += written;
+    trackUploadHeap();
+  }
+
+  if (!UPLOAD_RAW_JPEG)
+    client.write((const uint8_t *)multipartFooter, sizeof(multipartFooter) - 1);
+  unsigned long uploadTime = millis() - startTime;
+
+  int httpResponseCode = readResponse(client, response);
+  trackUploadHeap();
+
+  Serial.printf("\n📊 Upload: %u bytes in %lu ms (%.1f KB/s)\n",
+                contentLength, uploadTime, uploadTime > 0 ? contentLength / 1.024 / uploadTime : 0.0);
+  Serial.printf("📊 Peak heap use: %u bytes internal, %u bytes PSRAM (free now %u / %u)\n",
+                startInternal - uploadMinInternal, startPsram - uploadMinPsram,
+                heap_caps_get_free_size(MALLOC_CAP_INTERNAL), heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+
+  return httpResponseCode;
+}
+
+// Tell the server the scene hasn't changed, without sending the image.
+// Returns the HTTP status, or -1 if the request failed.
+int sendHeartbeat(uint32_t frameNumber, uint8_t meanChange, String &response)
+{
+  char body[96];
+  int length = snprintf(body, sizeof(body), "{\"frame\":%u,\"change\":%u,\"skipped\":%u}",
+                        frameNumber, meanChange, skippedInRow + 1);
+
+  WiFiClient client;
+  if (!client.connect(serverHost, serverPort, UPLOAD_TIMEOUT_MS))
+  {
+    Serial.printf("✗ Connection to %s:%u failed\n", serverHost, serverPort);
+    return -1;
+  }
+
+  client.printf("POST %s HTTP/1.1\r\n"
+                "Host: %s:%u\r\n"
+                "Content-Type: application/json\r\n"
+                "Content-Length: %d\r\n"
+                "Connection: close\r\n\r\n",
+                heartbeatPath, serverHost, serverPort, length);
+  client.write((const uint8_t *)body, length);
+
+  return readResponse(client, response);
+}
+
+void finishTrigger()
+{
+  portENTER_CRITICAL(&triggerLock);
+  triggerBusy = false;
+  portEXIT_CRITICAL(&triggerLock);
+}
+
+// GET /capture[?size=vga&quality=10&flash=0]: queue an immediate capture and
+// answer 202 right away; the frame goes to the server like any other upload
+static esp_err_t triggerHandler(httpd_req_t *req)
+{
+  static const struct
+  {
+    const char *name;
+    framesize_t size;
+  } frameSizes[] = {
+      {"qvga", FRAMESIZE_QVGA}, {"vga", FRAMESIZE_VGA}, {"svga", FRAMESIZE_SVGA},
+      {"xga", FRAMESIZE_XGA}, {"sxga", FRAMESIZE_SXGA}, {"uxga", FRAMESIZE_UXGA},
+  };
+
+  TriggerRequest request;
+  request.receivedAt = esp_timer_get_time();
+  request.frameSize = ROUTINE_FRAME_SIZE;
+  request.quality = ROUTINE_JPEG_QUALITY;
+  request.flash = true;
+
+  char query[96];
+  char value[16];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+  {
+    if (httpd_query_key_value(query, "size", value, sizeof(value)) == ESP_OK)
     {
-      Serial.printf("Failed! Error: %s\n", http.errorToString(httpResponseCode).c_str());
+      for (size_t i = 0; i < sizeof(frameSizes) / sizeof(frameSizes[0]); i++)
+        if (strcmp(value, frameSizes[i].name) == 0)
+          request.frameSize = frameSizes[i].size;
     }
+    if (httpd_query_key_value(query, "quality", value, sizeof(value)) == ESP_OK)
+      request.quality = constrain(atoi(value), 4, 63);
+    if (httpd_query_key_value(query, "flash", value, sizeof(value)) == ESP_OK)
+      request.flash = strcmp(value, "0") != 0 && strcmp(value, "off") != 0;
+  }
 
-    http.end();
+  // Frame buffers are only allocated for the inspection size
+  if (request.frameSize > inspectFrameSize)
+    request.frameSize = inspectFrameSize;
+
+  bool accepted = false;
+  portENTER_CRITICAL(&triggerLock);
+  if (!triggerBusy)
+  {
+    pendingTrigger = request;
+    triggerBusy = true;
+    accepted = true;
   }
   else
   {
-    Serial.println("✗ WiFi disconnected, cannot send image");
-    connectWiFi(); // Try to reconnect
+    triggerCoalesced++;
   }
+  portEXIT_CRITICAL(&triggerLock);
 
-  // Return frame buffer
-  esp_camera_fb_return(fb);
+  if (accepted)
+    xTaskNotify(captureTaskHandle, NOTIFY_TRIGGER, eSetBits);
+  Serial.printf("⚡ Capture trigger %s\n", accepted ? "accepted" : "coalesced into the capture in progress");
 
-  Serial.println();
+  char body[64];
+  snprintf(body, sizeof(body), "{\"accepted\":true,\"coalesced\":%s}", accepted ? "false" : "true");
+  httpd_resp_set_status(req, "202 Accepted");
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, body, HTTPD_RESP_USE_STRLEN);
+}
+
+void startTriggerServer()
+{
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.server_port = TRIGGER_PORT;
+
+  httpd_uri_t captureUri = {"/capture", HTTP_GET, triggerHandler, NULL};
+  if (httpd_start(&triggerServer, &config) == ESP_OK &&
+      httpd_register_uri_handler(triggerServer, &captureUri) == ESP_OK)
+  {
+    Serial.printf("✓ Capture trigger: http://%s/capture\n", WiFi.localIP().toString().c_str());
+  }
+  else
+  {
+    Serial.println("✗ Capture trigger endpoint could not be started");
+  }
 }
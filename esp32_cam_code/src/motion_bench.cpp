@@ -0,0 +1,91 @@
+/*
+ * Host benchmark for the sentinel motion kernel (env:motion_bench)
+ *
+ * Feeds recorded grayscale frames (binary PGM, "P5") through MotionDetector
+ * in order and reports the events and the per-frame cost:
+ *
+ *   pio run -e motion_bench
+ *   .pio/build/motion_bench/program [-b block] [-t threshold] [-m blocks] [-s frames] [-r repeat] frame*.pgm
+ *
+ * Defaults match the firmware's SENTINEL_* settings.
+ */
+
+#include "MotionDetector.h"
+#include "bench_pgm.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char **argv)
+{
+  MotionConfig config = {4, 12, 3, 4, 4};
+  int repeat = 100;
+
+  int arg = 1;
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+  {
+    int value = atoi(argv[arg + 1]);
+    switch (argv[arg][1])
+    {
+    case 'b': config.blockSize = value; break;
+    case 't': config.blockThreshold = value; break;
+    case 'm': config.minBlocks = value; break;
+    case 's': config.settleFrames = value; break;
+    case 'r': repeat = value > 0 ? value : 1; break;
+    default:
+      fprintf(stderr, "Unknown option %s\n", argv[arg]);
+      return 2;
+    }
+  }
+
+  std::vector<Frame> frames;
+  for (; arg < argc; arg++)
+  {
+    Frame frame;
+    if (!loadPgm(argv[arg], frame))
+    {
+      fprintf(stderr, "Can't read %s (binary 8-bit PGM expected)\n", argv[arg]);
+      return 1;
+    }
+    frames.push_back(frame);
+  }
+  if (frames.empty())
+  {
+    fprintf(stderr, "usage: %s [-b block] [-t threshold] [-m blocks] [-s frames] [-r repeat] frame*.pgm\n", argv[0]);
+    return 2;
+  }
+
+  // One pass for the events
+  MotionDetector detector(config);
+  for (const Frame &frame : frames)
+  {
+    MotionDetector::Event event = detector.process(frame.luma.data(), frame.width, frame.height);
+    if (event == MotionDetector::MOTION_STARTED)
+      printf("%s: motion started (%u of %u blocks)\n", frame.name, detector.activeBlocks(), detector.blocks());
+    else if (event == MotionDetector::MOTION_SETTLED)
+      printf("%s: motion settled -> capture\n", frame.name);
+  }
+
+  // Timed passes over the whole sequence
+  double total = 0, worst = 0;
+  for (int pass = 0; pass < repeat; pass++)
+  {
+    MotionDetector timed(config);
+    for (const Frame &frame : frames)
+    {
+      auto start = std::chrono::steady_clock::now();
+      timed.process(frame.luma.data(), frame.width, frame.height);
+      double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+      total += us;
+      if (us > worst)
+        worst = us;
+    }
+  }
+
+  printf("%zu frames (%ux%u, %u blocks), %u events\n", frames.size(), frames[0].width, frames[0].height,
+         detector.blocks(), detector.events());
+  printf("Per frame: %.2f us average, %.2f us worst (host, %d passes)\n",
+         total / (frames.size() * repeat), worst, repeat);
+  return 0;
+}
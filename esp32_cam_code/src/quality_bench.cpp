@@ -0,0 +1,75 @@
+/*
+ * Host benchmark for the burst frame scoring kernel (env:quality_bench)
+ *
+ * Scores recorded grayscale thumbnails (binary PGM, "P5") the way the
+ * firmware scores a burst, marks the one it would upload and reports the
+ * per-frame cost:
+ *
+ *   pio run -e quality_bench
+ *   .pio/build/quality_bench/program [-r repeat] frame*.pgm
+ */
+
+#include "FrameQuality.h"
+#include "bench_pgm.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char **argv)
+{
+  int repeat = 100;
+  int arg = 1;
+  if (arg + 1 < argc && strcmp(argv[arg], "-r") == 0)
+  {
+    repeat = atoi(argv[arg + 1]) > 0 ? atoi(argv[arg + 1]) : 1;
+    arg += 2;
+  }
+
+  std::vector<Frame> frames;
+  for (; arg < argc; arg++)
+  {
+    Frame frame;
+    if (!loadPgm(argv[arg], frame))
+    {
+      fprintf(stderr, "Can't read %s (binary 8-bit PGM expected)\n", argv[arg]);
+      return 1;
+    }
+    frames.push_back(frame);
+  }
+  if (frames.empty())
+  {
+    fprintf(stderr, "usage: %s [-r repeat] frame*.pgm\n", argv[0]);
+    return 2;
+  }
+
+  size_t best = 0;
+  uint32_t bestScore = 0;
+  double total = 0, worst = 0;
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    const Frame &frame = frames[i];
+    FrameQuality quality = {0, 0, 0};
+
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < repeat; pass++)
+      quality = scoreFrame(frame.luma.data(), frame.width, frame.height);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeat;
+    total += us;
+    if (us > worst)
+      worst = us;
+
+    printf("%s: %ux%u sharpness %u, clipped %u permille, score %u\n", frame.name, frame.width, frame.height,
+           quality.sharpness, quality.clipped, quality.score);
+    if (i == 0 || quality.score > bestScore)
+    {
+      best = i;
+      bestScore = quality.score;
+    }
+  }
+
+  printf("Best: %s (score %u)\n", frames[best].name, bestScore);
+  printf("Per frame: %.2f us average, %.2f us worst (host, %d passes)\n", total / frames.size(), worst, repeat);
+  return 0;
+}
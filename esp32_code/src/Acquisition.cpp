@@ -0,0 +1,415 @@
+#include "Acquisition.h"
+
+#include <math.h>
+
+Acquisition::Acquisition(const AcquisitionConfig &config, Clock &clock, GasSensor &gas,
+                         GasIndexAlgorithm &vocIndexAlgorithm, GasIndexAlgorithm &noxIndexAlgorithm)
+    : config(config), clock(clock), gas(gas), vocAlgorithm(vocIndexAlgorithm), noxAlgorithm(noxIndexAlgorithm)
+{
+  if (this->config.averaging < 1)
+    this->config.averaging = 1;
+  if (this->config.averaging > ACQUISITION_MAX_AVERAGING)
+    this->config.averaging = ACQUISITION_MAX_AVERAGING;
+
+  probes = 0;
+  pendingProbes = 0;
+  cycleEvents = 0;
+  cycleStart = 0;
+  temperature = 0;
+  humidity = 0;
+  temperatureMin = 0;
+  temperatureMax = 0;
+  temperatureGradient = 0;
+  humidityMin = 0;
+  humidityMax = 0;
+  valid = false;
+  fault = false;
+  lastClimateRead = 0;
+
+  gasEnabled = false;
+  gasState = GAS_WAITING;
+  lastGasStatus = GAS_IDLE;
+  gasSlot = 0;
+  conditioningStart = 0;
+  lastBaselineSave = 0;
+  vocRaw = 0;
+  noxRaw = 0;
+  vocIndex = 0;
+  noxIndex = 0;
+
+  lastUplinkSample = 0;
+  resetCost();
+}
+
+bool Acquisition::addProbe(ClimateSensor &sensor, float height)
+{
+  if (probes >= CLIMATE_PROBES_MAX)
+    return false;
+
+  Probe &probe = climateProbes[probes++];
+  probe.sensor = &sensor;
+  probe.height = height;
+  probe.windowIndex = 0;
+  probe.windowCount = 0;
+  probe.temperature = 0;
+  probe.humidity = 0;
+  probe.filtered = false;
+  probe.failures = 0;
+  probe.pending = false;
+  return true;
+}
+
+void Acquisition::begin(bool gasReady)
+{
+  unsigned long now = clock.millis();
+  gasEnabled = gasReady;
+  conditioningStart = now;
+  lastClimateRead = now - config.climateInterval; // First climate sample as soon as polling starts
+}
+
+void Acquisition::resetCost()
+{
+  costMax = 0;
+  costTotal = 0;
+  costCount = 0;
+  readCount = 0;
+  readLatencyMax = 0;
+  readLatencyTotal = 0;
+}
+
+int Acquisition::failedReadings() const
+{
+  int worst = 0;
+  for (uint8_t i = 0; i < probes; i++)
+  {
+    if (climateProbes[i].failures > worst)
+      worst = climateProbes[i].failures;
+  }
+  return worst;
+}
+
+uint8_t Acquisition::poll(SensorSample &sample)
+{
+  uint8_t events = 0;
+
+  // Climate probes: every probe starts a conversion at the slot, results are
+  // collected as they come in; a cycle still running by then is closed first
+  if (clock.millis() - lastClimateRead >= config.climateInterval)
+  {
+    lastClimateRead = clock.millis();
+    if (pendingProbes > 0)
+      events |= finishClimate();
+    events |= startClimate();
+  }
+  else if (pendingProbes > 0)
+  {
+    events |= pollClimate();
+  }
+
+  if (gasEnabled)
+    events |= pollGas();
+
+  if (events & ACQ_SAMPLE)
+  {
+    buildSample(sample);
+    if (clock.millis() - lastUplinkSample >= config.uplinkInterval)
+    {
+      lastUplinkSample = clock.millis();
+      events |= ACQ_UPLINK;
+    }
+  }
+  return events;
+}
+
+// Start a conversion on every probe at once
+uint8_t Acquisition::startClimate()
+{
+  cycleStart = clock.micros();
+  cycleEvents = 0;
+  pendingProbes = 0;
+
+  for (uint8_t i = 0; i < probes; i++)
+  {
+    Probe &probe = climateProbes[i];
+    probe.pending = probe.sensor->start();
+    if (probe.pending)
+      pendingProbes++;
+    else
+      cycleEvents |= addReading(probe, false, 0, 0);
+  }
+
+  // Results that are ready right away, or a cycle with nothing to wait for
+  return pollClimate();
+}
+
+// Collect the probes whose conversion is done; the cycle ends with the last one
+uint8_t Acquisition::pollClimate()
+{
+  for (uint8_t i = 0; i < probes; i++)
+  {
+    Probe &probe = climateProbes[i];
+    if (!probe.pending)
+      continue;
+
+    float t = NAN;
+    float h = NAN;
+    ClimateStatus status = probe.sensor->poll(t, h);
+    if (status == CLIMATE_BUSY)
+      continue;
+
+    probe.pending = false;
+    pendingProbes--;
+    cycleEvents |= addReading(probe, status == CLIMATE_OK, t, h);
+  }
+
+  return pendingProbes == 0 ? finishClimate() : 0;
+}
+
+// End the read cycle: probes that never answered count as failed, then refresh the room aggregate
+uint8_t Acquisition::finishClimate()
+{
+  for (uint8_t i = 0; i < probes; i++)
+  {
+    Probe &probe = climateProbes[i];
+    if (probe.pending)
+    {
+      probe.pending = false;
+      cycleEvents |= addReading(probe, false, 0, 0);
+    }
+  }
+  pendingProbes = 0;
+
+  uint32_t latency = clock.micros() - cycleStart;
+  readCount++;
+  readLatencyTotal += latency;
+  if (latency > readLatencyMax)
+    readLatencyMax = latency;
+
+  uint8_t events = cycleEvents & (ACQ_CLIMATE_FAILED | ACQ_PROBE_FAULT);
+  bool newReading = cycleEvents & ACQ_SAMPLE;
+  cycleEvents = 0;
+
+  // Every probe has failed `averaging` times in a row: nothing left to trust
+  bool allFaulty = probes > 0;
+  for (uint8_t i = 0; i < probes; i++)
+  {
+    if (!probeFaulty(i))
+      allFaulty = false;
+  }
+  if (allFaulty)
+  {
+    valid = false;
+    fault = true;
+    return events | ACQ_SENSOR_FAULT;
+  }
+
+  fault = false;
+  aggregate();
+  if (valid && newReading)
+    events |= ACQ_SAMPLE;
+  return events;
+}
+
+// Add a probe's reading to its averaging window and refresh its average; returns ACQ_* flags
+uint8_t Acquisition::addReading(Probe &probe, bool ok, float t, float h)
+{
+  // Check if reading is valid and in a reasonable range
+  if (!ok || isnan(t) || isnan(h) || t < -40 || t > 80 || h < 0 || h > 100)
+  {
+    probe.failures++;
+    if (probe.failures == config.averaging)
+      return ACQ_CLIMATE_FAILED | ACQ_PROBE_FAULT;
+    return ACQ_CLIMATE_FAILED;
+  }
+
+  probe.temperatureWindow[probe.windowIndex] = t;
+  probe.humidityWindow[probe.windowIndex] = h;
+  probe.windowIndex = (probe.windowIndex + 1) % config.averaging;
+  if (probe.windowCount < config.averaging)
+    probe.windowCount++;
+
+  // Average over the last `averaging` valid readings
+  float temperatureSum = 0.0;
+  float humiditySum = 0.0;
+  for (uint8_t i = 0; i < probe.windowCount; i++)
+  {
+    temperatureSum += probe.temperatureWindow[i];
+    humiditySum += probe.humidityWindow[i];
+  }
+
+  float averageTemperature = temperatureSum / probe.windowCount + config.temperatureOffset;
+  float averageHumidity = humiditySum / probe.windowCount + config.humidityOffset;
+
+  // Oversampled sensor: first-order low-pass on top of the moving average
+  if (config.filterTimeConstant > 0 && probe.filtered)
+  {
+    float alpha = (float)config.climateInterval / (config.filterTimeConstant + config.climateInterval);
+    probe.temperature += alpha * (averageTemperature - probe.temperature);
+    probe.humidity += alpha * (averageHumidity - probe.humidity);
+  }
+  else
+  {
+    probe.temperature = averageTemperature;
+    probe.humidity = averageHumidity;
+    probe.filtered = true;
+  }
+
+  // Ensure humidity stays within valid range (0-100%)
+  if (probe.humidity > 100.0)
+    probe.humidity = 100.0;
+  if (probe.humidity < 0.0)
+    probe.humidity = 0.0;
+
+  probe.failures = 0;
+  return ACQ_SAMPLE;
+}
+
+// Room values over the healthy probes: mean, extremes and the vertical temperature gradient
+void Acquisition::aggregate()
+{
+  uint8_t count = 0;
+  float temperatureSum = 0.0;
+  float humiditySum = 0.0;
+  float heightSum = 0.0;
+
+  for (uint8_t i = 0; i < probes; i++)
+  {
+    const Probe &probe = climateProbes[i];
+    if (!healthy(probe))
+      continue;
+
+    if (count == 0 || probe.temperature < temperatureMin)
+      temperatureMin = probe.temperature;
+    if (count == 0 || probe.temperature > temperatureMax)
+      temperatureMax = probe.temperature;
+    if (count == 0 || probe.humidity < humidityMin)
+      humidityMin = probe.humidity;
+    if (count == 0 || probe.humidity > humidityMax)
+      humidityMax = probe.humidity;
+
+    temperatureSum += probe.temperature;
+    humiditySum += probe.humidity;
+    heightSum += probe.height;
+    count++;
+  }
+
+  valid = count > 0;
+  if (!valid)
+    return;
+
+  temperature = temperatureSum / count;
+  humidity = humiditySum / count;
+
+  // Least-squares slope of temperature over height (0 unless the probes sit at different heights)
+  float heightMean = heightSum / count;
+  float covariance = 0.0;
+  float variance = 0.0;
+  for (uint8_t i = 0; i < probes; i++)
+  {
+    const Probe &probe = climateProbes[i];
+    if (!healthy(probe))
+      continue;
+
+    float dh = probe.height - heightMean;
+    covariance += dh * (probe.temperature - temperature);
+    variance += dh * dh;
+  }
+  temperatureGradient = variance > 1e-4 ? covariance / variance : 0.0;
+}
+
+// Gas sensor: start a conversion, then poll the driver until the result is ready
+uint8_t Acquisition::pollGas()
+{
+  unsigned long now = clock.millis();
+
+  if (gasState == GAS_WAITING)
+  {
+    if (now - gasSlot < config.gasInterval)
+      return 0;
+
+    // Keep an exact 1 Hz grid for the Gas Index; resync if we fell behind
+    gasSlot += config.gasInterval;
+    if (now - gasSlot >= config.gasInterval)
+      gasSlot = now;
+
+    // Compensate with the live climate values (datasheet defaults until the first reading)
+    float rh = valid ? humidity : 50.0;
+    float t = valid ? temperature : 25.0;
+    bool conditioning = now - conditioningStart < config.conditioningMs;
+
+    bool started = conditioning ? gas.startConditioning(rh, t) : gas.startMeasurement(rh, t);
+    if (!started)
+      return ACQ_GAS_COMMAND_FAILED;
+    gasState = GAS_MEASURING;
+    return 0;
+  }
+
+  uint16_t voc = 0;
+  uint16_t nox = 0;
+  GasStatus status = gas.readResult(voc, nox);
+  if (status == GAS_BUSY)
+    return 0;
+
+  gasState = GAS_WAITING;
+  lastGasStatus = status;
+
+  if (status != GAS_OK)
+    return ACQ_GAS_READ_FAILED;
+
+  // Conditioning results are discarded; real samples start afterwards
+  if (now - conditioningStart < config.conditioningMs)
+    return 0;
+
+  vocRaw = voc;
+  noxRaw = nox;
+
+  uint32_t costStart = clock.micros();
+  vocIndex = (float)vocAlgorithm.process(vocRaw);
+  noxIndex = (float)noxAlgorithm.process(noxRaw);
+  uint32_t cost = clock.micros() - costStart;
+
+  costTotal += cost;
+  costCount++;
+  if (cost > costMax)
+    costMax = cost;
+
+  uint8_t events = valid ? ACQ_SAMPLE : 0;
+  if (now - lastBaselineSave >= config.gasIndexSaveInterval)
+  {
+    lastBaselineSave = now;
+    events |= ACQ_SAVE_BASELINE;
+  }
+  return events;
+}
+
+void Acquisition::buildSample(SensorSample &sample)
+{
+  sample.seq = 0;
+  sample.time = clock.unixTime();
+  sample.timestamp = clock.millis();
+  sample.temperature = temperature;
+  sample.humidity = humidity;
+  sample.temperatureMin = temperatureMin;
+  sample.temperatureMax = temperatureMax;
+  sample.temperatureGradient = temperatureGradient;
+  sample.humidityMin = humidityMin;
+  sample.humidityMax = humidityMax;
+
+  // Per probe in tenths, the aggregate only covers the healthy ones
+  sample.probeCount = probes;
+  sample.probeValid = 0;
+  for (uint8_t i = 0; i < CLIMATE_PROBES_MAX; i++)
+  {
+    const Probe &probe = climateProbes[i];
+    bool used = i < probes && healthy(probe);
+    if (used)
+      sample.probeValid |= 1 << i;
+    sample.probeTemperature[i] = used ? (int16_t)lroundf(probe.temperature * 10) : 0;
+    sample.probeHumidity[i] = used ? (int16_t)lroundf(probe.humidity * 10) : 0;
+  }
+
+  sample.vocRaw = vocRaw;
+  sample.vocIndex = gasEnabled ? vocIndex : 0.0;
+  sample.noxRaw = gasEnabled ? noxRaw : 0;
+  sample.noxIndex = gasEnabled ? noxIndex : 0.0;
+}
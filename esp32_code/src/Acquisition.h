@@ -0,0 +1,166 @@
+/*
+ * Sensor acquisition schedule: climate probe averaging plus the SGP41 / Gas Index state machine
+ *
+ * poll() is called every SENSOR_TICK by the sensor task. Once per
+ * climateInterval every climate probe of the room starts a conversion, so
+ * they all measure at the same time; their results are collected over the
+ * following ticks. Each probe keeps its own average of the last `averaging`
+ * valid readings (calibration offsets applied), and the probes that are
+ * still healthy are aggregated into the room's mean, min/max and vertical
+ * temperature gradient. The gas sensor stays on an exact 1 Hz grid
+ * (conditioning for the first seconds after power-up, then T/RH-compensated
+ * measurements through the Gas Index algorithms). A sample is handed out
+ * whenever either produced a new value; every uplinkInterval one of those
+ * samples is also flagged for the server.
+ *
+ * A fast climate sensor (SHT4x/SHT3x, 10 Hz) is oversampled: the moving
+ * average is followed by a first-order low-pass (filterTimeConstant), so
+ * the published values are smoother than any single DHT22 reading.
+ *
+ * Pure logic, no Arduino dependencies: hardware and time come through Hal.h.
+ */
+
+#pragma once
+
+#include "GasIndexAlgorithm.h"
+#include "Hal.h"
+#include "Telemetry.h"
+
+#define ACQUISITION_MAX_AVERAGING 8
+
+struct AcquisitionConfig
+{
+  unsigned long climateInterval;      // Between climate sensor reads (ms)
+  unsigned long gasInterval;          // Gas sensor grid (ms), GAS_INDEX_SAMPLING_INTERVAL_MS
+  unsigned long conditioningMs;       // Gas sensor conditioning after power-up
+  unsigned long uplinkInterval;       // A sample for the server every ... (ms)
+  unsigned long gasIndexSaveInterval; // Gas Index baseline persistence period (ms)
+  uint8_t averaging;                  // Climate readings averaged (also: failures in a row = fault)
+  float temperatureOffset;            // Calibration (°C)
+  float humidityOffset;               // Calibration (%)
+  unsigned long filterTimeConstant;   // Low-pass after the average (ms), 0 = off
+};
+
+// poll() result flags
+#define ACQ_SAMPLE 0x01             // New sample for control and display
+#define ACQ_UPLINK 0x02             // ... also due for the server
+#define ACQ_CLIMATE_FAILED 0x04     // A probe's read failed (probeFailures() in a row)
+#define ACQ_SENSOR_FAULT 0x08       // Every probe failed `averaging` times in a row: no valid readings any more
+#define ACQ_GAS_COMMAND_FAILED 0x10 // Gas sensor didn't accept a command
+#define ACQ_GAS_READ_FAILED 0x20    // Gas sensor result lost (gasStatus())
+#define ACQ_SAVE_BASELINE 0x40      // Time to persist the Gas Index baselines
+#define ACQ_PROBE_FAULT 0x80        // A probe failed `averaging` times in a row and left the aggregate
+
+class Acquisition
+{
+public:
+  Acquisition(const AcquisitionConfig &config, Clock &clock, GasSensor &gas,
+              GasIndexAlgorithm &vocIndexAlgorithm, GasIndexAlgorithm &noxIndexAlgorithm);
+
+  // Add a climate probe mounted `height` m above the floor (before begin()); false when full
+  bool addProbe(ClimateSensor &sensor, float height);
+
+  // Start the schedule: first climate read right away, gas conditioning from now
+  void begin(bool gasReady);
+
+  // One scheduler step; returns ACQ_* flags, sample is valid with ACQ_SAMPLE
+  uint8_t poll(SensorSample &sample);
+
+  bool haveReading() const { return valid; }
+  bool sensorFault() const { return fault; }
+  bool gasReady() const { return gasEnabled; }
+  int failedReadings() const; // Longest run of failed reads among the probes
+  GasStatus gasStatus() const { return lastGasStatus; }
+
+  uint8_t probeCount() const { return probes; }
+  int probeFailures(uint8_t probe) const { return probe < probes ? climateProbes[probe].failures : 0; }
+  bool probeFaulty(uint8_t probe) const { return probe < probes && climateProbes[probe].failures >= config.averaging; }
+
+  // Gas Index CPU cost per sample (VOC + NOx, µs) since resetCost()
+  uint32_t gasIndexCostMax() const { return costMax; }
+  uint32_t gasIndexCostAverage() const { return costCount > 0 ? costTotal / costCount : 0; }
+  void resetCost();
+
+  // Climate read cycles (all probes, incl. failed ones) and their latency (µs, start
+  // to the last probe's result) since resetCost()
+  uint32_t climateReads() const { return readCount; }
+  uint32_t climateReadLatencyMax() const { return readLatencyMax; }
+  uint32_t climateReadLatencyAverage() const { return readCount > 0 ? readLatencyTotal / readCount : 0; }
+
+private:
+  enum GasState
+  {
+    GAS_WAITING,   // Waiting for the next measurement slot
+    GAS_MEASURING, // Command sent, polling the driver until the result is ready
+  };
+
+  struct Probe
+  {
+    ClimateSensor *sensor;
+    float height; // m above the floor
+
+    // Averaging window (last `averaging` valid readings)
+    float temperatureWindow[ACQUISITION_MAX_AVERAGING];
+    float humidityWindow[ACQUISITION_MAX_AVERAGING];
+    uint8_t windowIndex;
+    uint8_t windowCount;
+    float temperature;
+    float humidity;
+    bool filtered; // Low-pass state holds a value
+    int failures;
+    bool pending;  // Conversion started, result not collected yet
+  };
+
+  bool healthy(const Probe &probe) const { return probe.windowCount > 0 && probe.failures < config.averaging; }
+  uint8_t startClimate();
+  uint8_t pollClimate();
+  uint8_t finishClimate();
+  uint8_t addReading(Probe &probe, bool ok, float t, float h);
+  void aggregate();
+  uint8_t pollGas();
+  void buildSample(SensorSample &sample);
+
+  AcquisitionConfig config;
+  Clock &clock;
+  GasSensor &gas;
+  GasIndexAlgorithm &vocAlgorithm;
+  GasIndexAlgorithm &noxAlgorithm;
+
+  // Climate probes and the room aggregate over the healthy ones
+  Probe climateProbes[CLIMATE_PROBES_MAX];
+  uint8_t probes;
+  uint8_t pendingProbes;     // Conversions of the running cycle not collected yet
+  uint8_t cycleEvents;       // ACQ_* flags gathered during the running cycle
+  uint32_t cycleStart;       // micros() when the cycle's conversions were started
+  float temperature;         // Mean
+  float humidity;
+  float temperatureMin;
+  float temperatureMax;
+  float temperatureGradient; // °C per m of height (least squares)
+  float humidityMin;
+  float humidityMax;
+  bool valid;
+  bool fault;
+  unsigned long lastClimateRead;
+
+  // Gas sensor state machine
+  bool gasEnabled;
+  GasState gasState;
+  GasStatus lastGasStatus;
+  unsigned long gasSlot;
+  unsigned long conditioningStart;
+  unsigned long lastBaselineSave;
+  uint16_t vocRaw;
+  uint16_t noxRaw;
+  float vocIndex;
+  float noxIndex;
+
+  unsigned long lastUplinkSample;
+
+  uint32_t costMax;
+  uint32_t costTotal;
+  uint32_t costCount;
+  uint32_t readCount;
+  uint32_t readLatencyMax;
+  uint32_t readLatencyTotal;
+};
@@ -0,0 +1,249 @@
+#include "ArduinoHal.h"
+
+#include <time.h>
+
+uint32_t ArduinoClock::unixTime()
+{
+  time_t now = time(NULL);
+  return now > 1600000000 ? now : 0; // Not synced yet: the clock still counts from 1970
+}
+
+bool Dht22Sensor::begin()
+{
+  dht.begin();
+  return true;
+}
+
+bool Dht22Sensor::read(float &temperature, float &humidity)
+{
+  temperature = dht.readTemperature();
+  humidity = dht.readHumidity();
+  return !isnan(temperature) && !isnan(humidity);
+}
+
+// Several bit-banged probes still read one after another, ~5 ms each
+bool Dht22Sensor::start()
+{
+  lastOk = read(lastTemperature, lastHumidity);
+  return true;
+}
+
+ClimateStatus Dht22Sensor::poll(float &temperature, float &humidity)
+{
+  temperature = lastTemperature;
+  humidity = lastHumidity;
+  return lastOk ? CLIMATE_OK : CLIMATE_FAILED;
+}
+
+bool Dht22RmtSensor::begin()
+{
+  return sensor.begin();
+}
+
+// One frame for both values; the sensor task sleeps while the RMT captures it
+bool Dht22RmtSensor::read(float &temperature, float &humidity)
+{
+  return sensor.read(temperature, humidity) == DHT22_OK;
+}
+
+// Each probe has its own RMT channel, so their frames are captured at the same time
+bool Dht22RmtSensor::start()
+{
+  return sensor.start();
+}
+
+ClimateStatus Dht22RmtSensor::poll(float &temperature, float &humidity)
+{
+  switch (sensor.poll(temperature, humidity))
+  {
+  case DHT22_OK:
+    return CLIMATE_OK;
+  case DHT22_BUSY:
+    return CLIMATE_BUSY;
+  default:
+    return CLIMATE_FAILED;
+  }
+}
+
+bool ShtClimateSensor::begin()
+{
+  xSemaphoreTake(busLock, portMAX_DELAY);
+  bool ok = select() && sensor.begin();
+  xSemaphoreGive(busLock);
+  return ok;
+}
+
+// The bus is free for the SGP41 and the display while the conversion runs
+bool ShtClimateSensor::read(float &temperature, float &humidity)
+{
+  if (!start())
+    return false;
+
+  vTaskDelay(pdMS_TO_TICKS(sensor.conversionTime(repeatability)));
+
+  ClimateStatus status;
+  while ((status = poll(temperature, humidity)) == CLIMATE_BUSY)
+    vTaskDelay(1);
+  return status == CLIMATE_OK;
+}
+
+bool ShtClimateSensor::start()
+{
+  xSemaphoreTake(busLock, portMAX_DELAY);
+  bool started = select() && sensor.startMeasurement(repeatability);
+  xSemaphoreGive(busLock);
+  return started;
+}
+
+ClimateStatus ShtClimateSensor::poll(float &temperature, float &humidity)
+{
+  xSemaphoreTake(busLock, portMAX_DELAY);
+  ShtStatus status = select() ? sensor.readResult(temperature, humidity) : SHT_I2C_ERROR;
+  xSemaphoreGive(busLock);
+
+  if (status == SHT_OK)
+    return CLIMATE_OK;
+  if (status == SHT_BUSY)
+    return CLIMATE_BUSY;
+  return CLIMATE_FAILED;
+}
+
+// Connect this probe's mux channel (bus lock held)
+bool ShtClimateSensor::select()
+{
+  return mux == NULL || mux->select(muxChannel);
+}
+
+bool Sgp41GasSensor::begin()
+{
+  return sensor.begin();
+}
+
+bool Sgp41GasSensor::startConditioning(float humidity, float temperature)
+{
+  xSemaphoreTake(busLock, portMAX_DELAY);
+  bool started = sensor.startConditioning(humidity, temperature);
+  xSemaphoreGive(busLock);
+  return started;
+}
+
+bool Sgp41GasSensor::startMeasurement(float humidity, float temperature)
+{
+  xSemaphoreTake(busLock, portMAX_DELAY);
+  bool started = sensor.startMeasurement(humidity, temperature);
+  xSemaphoreGive(busLock);
+  return started;
+}
+
+GasStatus Sgp41GasSensor::readResult(uint16_t &srawVoc, uint16_t &srawNox)
+{
+  xSemaphoreTake(busLock, portMAX_DELAY);
+  Sgp41Status status = sensor.readResult(srawVoc, srawNox);
+  xSemaphoreGive(busLock);
+
+  switch (status)
+  {
+  case SGP41_OK:
+    return GAS_OK;
+  case SGP41_BUSY:
+    return GAS_BUSY;
+  case SGP41_CRC_ERROR:
+    return GAS_CRC_ERROR;
+  case SGP41_IDLE:
+    return GAS_IDLE;
+  default:
+    return GAS_I2C_ERROR;
+  }
+}
+
+GpioRelays::GpioRelays(const uint8_t (&pins)[RELAY_CHANNELS])
+    : pins(pins)
+{
+}
+
+void GpioRelays::begin()
+{
+  for (uint8_t channel = 0; channel < RELAY_CHANNELS; channel++)
+  {
+    pinMode(pins[channel], OUTPUT);
+    digitalWrite(pins[channel], LOW);
+  }
+}
+
+void GpioRelays::set(uint8_t channel, bool on)
+{
+  if (channel < RELAY_CHANNELS)
+    digitalWrite(pins[channel], on ? HIGH : LOW);
+}
+
+bool Ssd1306Display::begin()
+{
+  return display.begin(SSD1306_SWITCHCAPVCC, address);
+}
+
+void Ssd1306Display::showReadings(const DisplayState &state)
+{
+  display.clearDisplay();
+  display.setTextSize(2);
+  display.setTextColor(SSD1306_WHITE);
+
+  // Title
+  display.setCursor(0, 0);
+  display.setTextSize(1);
+  display.println("Cold Storage Unit");
+  display.drawLine(0, 10, 128, 10, SSD1306_WHITE);
+
+  // Temperature
+  display.setTextSize(1);
+  display.setCursor(0, 14);
+  display.print("Temp     : ");
+  display.print(state.temperature, 1);
+  display.print(" C");
+  if (state.temperatureAlarm)
+  {
+    display.print(" !");
+  }
+
+  // Humidity
+  display.setCursor(0, 26);
+  display.print("Humidity : ");
+  display.print(state.humidity, 1);
+  display.print(" %");
+  if (state.humidityAlarm)
+  {
+    display.print(" !");
+  }
+
+  // VOC
+  display.setCursor(0, 38);
+  display.print("VOC Index: ");
+  display.print(state.vocIndex, 0);
+  if (state.vocAlarm)
+  {
+    display.print("!");
+  }
+
+  // System Status
+  display.setCursor(0, 50);
+  display.print("Status: ");
+  display.print(state.cooling ? "C" : "-");
+  display.print(state.pump ? "P" : "-");
+  display.print(state.humidifierScrubber ? "H" : "-");
+
+  display.display();
+}
+
+void Ssd1306Display::showSensorError(int attempts)
+{
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+  display.setCursor(0, 0);
+  display.println("Cold Storage Unit");
+  display.setCursor(0, 20);
+  display.println("ERROR: Sensor fail!");
+  display.setCursor(0, 30);
+  display.print("Attempts: ");
+  display.println(attempts);
+  display.display();
+}
@@ -0,0 +1,136 @@
+/*
+ * ESP32 implementations of the Hal.h interfaces
+ *
+ * - ArduinoClock:    millis()/micros(), NTP-synced time()
+ * - Dht22Sensor:     Adafruit DHT library (bit-banged, interrupts off during the frame)
+ * - Dht22RmtSensor:  RMT peripheral capture (DHT22Rmt)
+ * - ShtClimateSensor: SHT4x/SHT3x driver, holding the shared I2C bus mutex per call
+ *                     (behind a TCA9548A channel when several probes share an address)
+ * - Sgp41GasSensor:  SGP41 driver, holding the shared I2C bus mutex per call
+ * - GpioRelays:      one GPIO per relay channel
+ * - Ssd1306Display:  128x64 OLED status screen
+ *
+ * The HTTP transport is UplinkClient.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <DHT.h>
+#include <Adafruit_SSD1306.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "DHT22Rmt.h"
+#include "Hal.h"
+#include "SGP41.h"
+#include "SHTxx.h"
+#include "TCA9548A.h"
+
+class ArduinoClock : public Clock
+{
+public:
+  uint32_t millis() override { return ::millis(); }
+  uint32_t micros() override { return ::micros(); }
+  uint32_t unixTime() override;
+};
+
+class Dht22Sensor : public ClimateSensor
+{
+public:
+  Dht22Sensor(uint8_t pin, uint8_t type) : dht(pin, type), lastOk(false), lastTemperature(NAN), lastHumidity(NAN) {}
+  bool begin() override;
+  bool read(float &temperature, float &humidity) override;
+  bool start() override;
+  ClimateStatus poll(float &temperature, float &humidity) override;
+
+private:
+  DHT dht;
+
+  // The library can only read blocking: start() does it, poll() hands it out
+  bool lastOk;
+  float lastTemperature;
+  float lastHumidity;
+};
+
+class Dht22RmtSensor : public ClimateSensor
+{
+public:
+  Dht22RmtSensor(uint8_t pin, rmt_channel_t channel) : sensor(pin, channel) {}
+  bool begin() override;
+  bool read(float &temperature, float &humidity) override;
+  bool start() override;
+  ClimateStatus poll(float &temperature, float &humidity) override;
+
+  DHT22Rmt &driver() { return sensor; }
+
+private:
+  DHT22Rmt sensor;
+};
+
+class ShtClimateSensor : public ClimateSensor
+{
+public:
+  // busLock may still be NULL here; it must exist before begin(). With a mux,
+  // the probe sits on its muxChannel.
+  ShtClimateSensor(TwoWire &wire, ShtModel model, uint8_t address, SemaphoreHandle_t &busLock,
+                   ShtRepeatability repeatability, TCA9548A *mux = NULL, uint8_t muxChannel = 0)
+      : sensor(wire, model, address), busLock(busLock), repeatability(repeatability), mux(mux),
+        muxChannel(muxChannel) {}
+  bool begin() override;
+  bool read(float &temperature, float &humidity) override;
+  bool start() override;
+  ClimateStatus poll(float &temperature, float &humidity) override;
+
+  const SHTxx &driver() const { return sensor; }
+
+private:
+  bool select();
+
+  SHTxx sensor;
+  SemaphoreHandle_t &busLock;
+  ShtRepeatability repeatability;
+  TCA9548A *mux;
+  uint8_t muxChannel;
+};
+
+class Sgp41GasSensor : public GasSensor
+{
+public:
+  // busLock may still be NULL here; it must exist before the first call
+  Sgp41GasSensor(SGP41 &sensor, SemaphoreHandle_t &busLock) : sensor(sensor), busLock(busLock) {}
+  bool begin() override;
+  bool startConditioning(float humidity, float temperature) override;
+  bool startMeasurement(float humidity, float temperature) override;
+  GasStatus readResult(uint16_t &srawVoc, uint16_t &srawNox) override;
+  uint64_t serialNumber() const override { return sensor.serialNumber(); }
+
+private:
+  SGP41 &sensor;
+  SemaphoreHandle_t &busLock;
+};
+
+class GpioRelays : public RelayBank
+{
+public:
+  explicit GpioRelays(const uint8_t (&pins)[RELAY_CHANNELS]);
+  void begin(); // Outputs, all off
+  void set(uint8_t channel, bool on) override;
+
+private:
+  const uint8_t *pins;
+};
+
+class Ssd1306Display : public StatusDisplay
+{
+public:
+  explicit Ssd1306Display(Adafruit_SSD1306 &display) : display(display), address(0x3C) {}
+  void setAddress(uint8_t i2cAddress) { address = i2cAddress; }
+  bool begin() override;
+  void showReadings(const DisplayState &state) override;
+  void showSensorError(int attempts) override;
+
+private:
+  Adafruit_SSD1306 &display;
+  uint8_t address;
+};
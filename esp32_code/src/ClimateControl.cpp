@@ -0,0 +1,101 @@
+#include "ClimateControl.h"
+#include "Telemetry.h"
+
+ClimateControl::ClimateControl(const CoolingConfig &coolingConfig, RelayBank &relays, const Thresholds &thresholds)
+    : stages(coolingConfig), relays(relays), limits(thresholds), controlTarget(CONTROL_TARGET_MEAN)
+{
+  humidifierOn = false;
+  stages.setTargets(limits.tempSetpoint, limits.tempMin, limits.tempMax);
+}
+
+void ClimateControl::begin()
+{
+  for (uint8_t channel = 0; channel < RELAY_CHANNELS; channel++)
+    relays.set(channel, false);
+  humidifierOn = false;
+}
+
+void ClimateControl::setThresholds(const Thresholds &thresholds)
+{
+  limits = thresholds;
+  stages.setTargets(limits.tempSetpoint, limits.tempMin, limits.tempMax);
+}
+
+HumidifierEvent ClimateControl::update(float temperature, float humidity, float vocIndex, unsigned long now)
+{
+  stages.update(temperature, now);
+
+  bool humidityLow = humidity < limits.humidityMin;
+  bool vocHigh = vocIndex > limits.vocThreshold;
+
+  if (humidityLow || vocHigh)
+  {
+    if (humidifierOn)
+      return HUMIDIFIER_UNCHANGED;
+
+    relays.set(RELAY_HUMIDIFIER_SCRUBBER, true);
+    humidifierOn = true;
+    if (humidityLow && vocHigh)
+      return HUMIDIFIER_ON_BOTH;
+    return humidityLow ? HUMIDIFIER_ON_HUMIDITY : HUMIDIFIER_ON_VOC;
+  }
+
+  // Turn off only when both conditions are OK
+  if (humidifierOn && humidity > limits.humidityMax && vocIndex < limits.vocThreshold * VOC_RELEASE_RATIO)
+  {
+    relays.set(RELAY_HUMIDIFIER_SCRUBBER, false);
+    humidifierOn = false;
+    return HUMIDIFIER_OFF;
+  }
+  return HUMIDIFIER_UNCHANGED;
+}
+
+HumidifierEvent ClimateControl::update(const SensorSample &sample)
+{
+  if (controlTarget == CONTROL_TARGET_MEAN)
+    return update(sample.temperature, sample.humidity, sample.vocIndex, sample.timestamp);
+
+  // Track the midpoint of the warmest and coldest probe, moved off the
+  // setpoint as far as needed to keep both inside the range: chasing the top
+  // shelves alone would freeze the bottom ones
+  float spread = sample.temperatureMax - sample.temperatureMin;
+  float centre = limits.tempSetpoint;
+  if (spread >= limits.tempMax - limits.tempMin)
+    centre = (limits.tempMin + limits.tempMax) / 2;
+  else if (centre - spread / 2 < limits.tempMin)
+    centre = limits.tempMin + spread / 2;
+  else if (centre + spread / 2 > limits.tempMax)
+    centre = limits.tempMax - spread / 2;
+
+  float temperature = (sample.temperatureMin + sample.temperatureMax) / 2 - (centre - limits.tempSetpoint);
+  return update(temperature, sample.humidityMin, sample.vocIndex, sample.timestamp);
+}
+
+bool ClimateControl::tick(unsigned long now)
+{
+  if (!stages.tick(now))
+    return false;
+
+  for (uint8_t i = 0; i < COOLING_STAGES; i++)
+    relays.set(RELAY_COOLING_FIRST + i, stages.stageOn(i));
+  return true;
+}
+
+bool ClimateControl::outOfRange(float temperature, float humidity, float vocIndex) const
+{
+  return temperature < limits.tempMin || temperature > limits.tempMax ||
+         humidity < limits.humidityMin || humidity > limits.humidityMax ||
+         vocIndex > limits.vocThreshold;
+}
+
+bool ClimateControl::outOfRange(const SensorSample &sample) const
+{
+  return outOfRange(sample.temperatureMin, sample.humidityMin, sample.vocIndex) ||
+         outOfRange(sample.temperatureMax, sample.humidityMax, sample.vocIndex);
+}
+
+bool ClimateControl::alert(const SensorSample &sample) const
+{
+  return sample.temperatureMin < limits.tempMin || sample.temperatureMax > limits.tempMax ||
+         sample.humidityMin < limits.humidityMin || sample.vocIndex > limits.vocThreshold;
+}
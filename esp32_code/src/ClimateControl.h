@@ -0,0 +1,102 @@
+/*
+ * Cold-room climate control: staged cooling plus the humidifier + scrubber relay
+ *
+ * Wraps the CoolingController and the humidifier/scrubber hysteresis and
+ * switches the relays through the RelayBank. Feed update() with every new
+ * sample and call tick() at a fixed period (CONTROL_TICK); the thresholds
+ * come from the server (setThresholds()).
+ *
+ * Humidifier + scrubber share one relay: on when humidity is below the range
+ * or VOC above its threshold, off again only once humidity is above the range
+ * and VOC below 80% of the threshold.
+ *
+ * A room with several probes can be controlled on its mean or on the
+ * worst-case probes (setTarget()): cooling then tracks the midpoint of the
+ * warmest and coldest probe, moved off the setpoint just enough to keep both
+ * inside the range, and the humidifier follows the driest probe.
+ *
+ * Pure logic, no Arduino dependencies.
+ */
+
+#pragma once
+
+#include "CoolingController.h"
+#include "Hal.h"
+
+#define VOC_RELEASE_RATIO 0.8f // VOC must fall below this share of the threshold to release the scrubber
+
+struct SensorSample;
+
+struct Thresholds
+{
+  float vocThreshold; // VOC Index (0-500, 100 = typical air)
+  float tempMin;      // °C
+  float tempMax;
+  float tempSetpoint; // Optimal temperature the cooling tracks
+  float humidityMin;  // %
+  float humidityMax;
+};
+
+// Why the humidifier + scrubber relay changed in update()
+enum HumidifierEvent
+{
+  HUMIDIFIER_UNCHANGED,
+  HUMIDIFIER_ON_HUMIDITY, // Humidity low
+  HUMIDIFIER_ON_VOC,      // VOC high
+  HUMIDIFIER_ON_BOTH,
+  HUMIDIFIER_OFF,
+};
+
+// Which reading of a multi-probe room update(const SensorSample &) acts on
+enum ControlTarget
+{
+  CONTROL_TARGET_MEAN,  // Room average
+  CONTROL_TARGET_WORST, // Warmest + coldest probe inside the range, driest probe for the humidifier
+};
+
+class ClimateControl
+{
+public:
+  ClimateControl(const CoolingConfig &coolingConfig, RelayBank &relays, const Thresholds &thresholds);
+
+  // Switch every relay off (start-up)
+  void begin();
+
+  void setThresholds(const Thresholds &thresholds);
+  const Thresholds &thresholds() const { return limits; }
+
+  void setTarget(ControlTarget target) { controlTarget = target; }
+  ControlTarget target() const { return controlTarget; }
+
+  // New sample (timestamp in ms); switches the humidifier + scrubber right away
+  HumidifierEvent update(float temperature, float humidity, float vocIndex, unsigned long now);
+
+  // Same with the reading setTarget() picks from the sample's probe aggregate
+  HumidifierEvent update(const SensorSample &sample);
+
+  // Cooling decision at the control period. Returns true if a cooling relay changed.
+  bool tick(unsigned long now);
+
+  // Any reading outside the produce's thresholds
+  bool outOfRange(float temperature, float humidity, float vocIndex) const;
+
+  // Any probe outside the produce's thresholds
+  bool outOfRange(const SensorSample &sample) const;
+
+  // Any probe out of range in a way the server should hear about now. Humidity
+  // above humidityMax is left out: update() keeps the humidifier on until the
+  // room gets there, so every humidifier cycle ends up past it on purpose.
+  bool alert(const SensorSample &sample) const;
+
+  const CoolingController &cooling() const { return stages; }
+  bool coolingActive() const { return stages.activeStages() > 0; }
+  bool pumpActive() const { return stages.stageOn(0); } // Pump shares CH1 with Peltier 1
+  bool humidifierScrubberActive() const { return humidifierOn; }
+
+private:
+  CoolingController stages;
+  RelayBank &relays;
+  Thresholds limits;
+  ControlTarget controlTarget;
+  bool humidifierOn;
+};
@@ -0,0 +1,99 @@
+/*
+ * Controller settings shared by the firmware and the host programs
+ *
+ * Schedule, control tuning and acquisition settings of main.cpp, kept here
+ * so controller_bench and plant_bench run exactly what the firmware ships
+ * with. Pins, WiFi, the probe list and task layout stay in main.cpp; the
+ * uplink batching policy lives in UplinkBatcher.h.
+ *
+ * Pure C++, no Arduino dependencies.
+ */
+
+#pragma once
+
+#include "Acquisition.h"
+#include "ClimateControl.h"
+#include "GasIndexAlgorithm.h"
+#include "SampleRing.h"
+
+// Default control thresholds (will be updated from server)
+const Thresholds defaultThresholds = {
+    250,  // VOC Index threshold (0-500, 100 = typical air)
+    2.0,  // Target minimum temperature (°C)
+    4.0,  // Target maximum temperature (°C)
+    3.0,  // Optimal temperature the cooling tracks (°C)
+    85.0, // Target minimum humidity (%)
+    95.0, // Target maximum humidity (%)
+};
+
+// Threshold refresh period
+const unsigned long THRESHOLD_UPDATE_INTERVAL = 30000; // Update every 30 seconds
+
+// Acquisition schedule (sensor task, driven by millis())
+const unsigned long DHT_SAMPLE_INTERVAL = 2500; // DHT22 needs at least 2 seconds between reads
+const unsigned long SHT_SAMPLE_INTERVAL = 100;  // SHT4x/SHT3x: 10 Hz oversampling
+const unsigned long SGP_SAMPLE_INTERVAL = GAS_INDEX_SAMPLING_INTERVAL_MS; // Gas Index needs exactly 1 Hz
+const unsigned long SGP_CONDITIONING_DURATION = 10000; // SGP41 conditioning after power-up (ms)
+const unsigned long GAS_INDEX_SAVE_INTERVAL = 3600000; // Persist Gas Index baseline to NVS every hour
+const unsigned long SENSOR_TICK = 10;           // Sensor task polling period (ms)
+const unsigned long UPLINK_INTERVAL = 10000;    // Record a sample for the server every 10 seconds
+const unsigned long DISPLAY_INTERVAL = 1000;    // Refresh OLED every second
+const unsigned long CONTROL_TICK = 1000;        // Relay switching decision period (ms)
+
+// Climate probe averaging
+#define NUM_READINGS 3                // DHT22: number of readings to average
+#define SHT_OVERSAMPLING 8            // SHT4x/SHT3x: readings in the moving average (0.8 s at 10 Hz)
+#define SHT_FILTER_TIME_CONSTANT 5000 // SHT4x/SHT3x: low-pass after the average (ms)
+
+// Calibration offsets (adjust based on known reference values)
+#define TEMP_OFFSET 0.0 // No calibration - raw DHT22 reading
+#define HUM_OFFSET 0.0  // No calibration - raw DHT22 reading
+
+// Staged cooling: demand in Peltier stages from error, trend and integral,
+// the partial stage is duty-cycled within the window
+#define COOLING_PROPORTIONAL_BAND 2.0 // °C above setpoint that demands all 4 stages
+#define COOLING_INTEGRAL_TIME 1800    // Integral time (s)
+#define COOLING_TREND_LOOKAHEAD 120   // Extrapolate the error 2 minutes along its trend (s)
+#define COOLING_TREND_SMOOTHING 300   // Slope time constant (s)
+#define COOLING_WINDOW 900000         // Time-proportional window (ms)
+#define COOLING_MIN_ON 180000         // Minimum relay on time (ms)
+#define COOLING_MIN_OFF 180000        // Minimum relay off time (ms)
+
+// Sample ring between the sensor and uplink tasks
+#define SAMPLE_RING_CAPACITY 64              // Power of two; ~10 minutes at UPLINK_INTERVAL
+#define SAMPLE_RING_POLICY RING_DROP_OLDEST // RING_DROP_OLDEST or RING_DECIMATE
+
+const CoolingConfig coolingConfig = {
+    COOLING_PROPORTIONAL_BAND,
+    COOLING_INTEGRAL_TIME,
+    COOLING_TREND_LOOKAHEAD,
+    COOLING_TREND_SMOOTHING,
+    COOLING_WINDOW,
+    COOLING_MIN_ON,
+    COOLING_MIN_OFF,
+};
+
+// Climate probe averaging + SGP41 / Gas Index schedule, per climate sensor backend
+const AcquisitionConfig dhtAcquisitionConfig = {
+    DHT_SAMPLE_INTERVAL,
+    SGP_SAMPLE_INTERVAL,
+    SGP_CONDITIONING_DURATION,
+    UPLINK_INTERVAL,
+    GAS_INDEX_SAVE_INTERVAL,
+    NUM_READINGS,
+    TEMP_OFFSET,
+    HUM_OFFSET,
+    0, // No low-pass: a DHT22 reading every 2.5 s is slow enough
+};
+
+const AcquisitionConfig shtAcquisitionConfig = {
+    SHT_SAMPLE_INTERVAL,
+    SGP_SAMPLE_INTERVAL,
+    SGP_CONDITIONING_DURATION,
+    UPLINK_INTERVAL,
+    GAS_INDEX_SAVE_INTERVAL,
+    SHT_OVERSAMPLING,
+    TEMP_OFFSET,
+    HUM_OFFSET,
+    SHT_FILTER_TIME_CONSTANT,
+};
@@ -0,0 +1,157 @@
+#include "CoolingController.h"
+
+CoolingController::CoolingController(const CoolingConfig &config)
+    : config(config), setpoint(0), minimum(0), maximum(0), haveSample(false), lastTemperature(0),
+      lastSampleTime(0), slopePerS(0), integral(0), currentDemand(0), heldDemand(0),
+      outsideRange(false), windowStart(0)
+{
+  for (uint8_t i = 0; i < COOLING_STAGES; i++)
+  {
+    stages[i].on = false;
+    stages[i].lastChange = 0;
+    stages[i].cycles = 0;
+  }
+}
+
+void CoolingController::setTargets(float setpoint, float minimum, float maximum)
+{
+  this->setpoint = setpoint;
+  this->minimum = minimum;
+  this->maximum = maximum;
+}
+
+void CoolingController::update(float temperature, unsigned long now)
+{
+  float dt = 0;
+
+  if (haveSample)
+  {
+    dt = (now - lastSampleTime) / 1000.0f;
+    if (dt <= 0)
+      return;
+
+    // Smoothed slope: the DHT22 only resolves 0.1 °C, raw differences are mostly noise
+    float rawSlope = (temperature - lastTemperature) / dt;
+    float alpha = dt / (config.trendTimeConstantS + dt);
+    slopePerS += alpha * (rawSlope - slopePerS);
+  }
+
+  haveSample = true;
+  lastTemperature = temperature;
+  lastSampleTime = now;
+
+  float gain = COOLING_STAGES / config.proportionalBand; // Stages per °C
+  float error = temperature - setpoint;
+
+  // Integral term carries the steady heat load so the proportional part can sit at the setpoint
+  if (config.integralTimeS > 0)
+  {
+    integral += gain * error * dt / config.integralTimeS;
+    if (integral < 0)
+      integral = 0;
+    if (integral > COOLING_STAGES)
+      integral = COOLING_STAGES;
+  }
+
+  float predictedError = error + slopePerS * config.trendLookaheadS;
+  float demand = gain * predictedError + integral;
+
+  outsideRange = temperature >= maximum || temperature <= minimum;
+  if (temperature >= maximum)
+    demand = COOLING_STAGES; // Outside the produce's range: no modulation
+  else if (temperature <= minimum)
+    demand = 0;
+
+  if (demand < 0)
+    demand = 0;
+  if (demand > COOLING_STAGES)
+    demand = COOLING_STAGES;
+
+  currentDemand = demand;
+}
+
+// Whether the window's demand wants this stage on right now (before min on/off times)
+bool CoolingController::requestedOn(uint8_t stage, unsigned long now) const
+{
+  uint8_t fullStages = (uint8_t)heldDemand;
+
+  if (stage < fullStages)
+    return true;
+  if (stage > fullStages)
+    return false;
+
+  // The stage just above the full ones is duty-cycled within the window
+  unsigned long onTime = (unsigned long)((heldDemand - fullStages) * config.windowMs);
+
+  if (onTime < config.minOnMs)
+    return false; // Too short to be worth a relay cycle
+  if (config.windowMs - onTime < config.minOffMs)
+    return true; // Off gap too short, stay on for the whole window
+
+  return (now - windowStart) < onTime;
+}
+
+bool CoolingController::tick(unsigned long now)
+{
+  if (now - windowStart >= config.windowMs)
+  {
+    windowStart += config.windowMs;
+    if (now - windowStart >= config.windowMs)
+      windowStart = now; // Fell behind, restart the window
+    heldDemand = currentDemand;
+  }
+
+  // Within the window only a large change or the range limits move the relays
+  float change = currentDemand - heldDemand;
+  if (outsideRange || change >= 1 || change <= -1)
+    heldDemand = currentDemand;
+
+  bool changed = false;
+
+  // Switch off from the top stage down; stage 0 runs the pump and stays on while any Peltier does
+  for (int8_t i = COOLING_STAGES - 1; i >= 0; i--)
+  {
+    Stage &stage = stages[i];
+    if (!stage.on || requestedOn(i, now))
+      continue;
+    if (now - stage.lastChange < config.minOnMs)
+      continue;
+    if (i == 0 && activeStages() > 1)
+      continue;
+
+    stage.on = false;
+    stage.lastChange = now;
+    changed = true;
+  }
+
+  // Switch on from the bottom up, one relay per tick to spread the inrush
+  for (uint8_t i = 0; i < COOLING_STAGES; i++)
+  {
+    Stage &stage = stages[i];
+    if (stage.on || !requestedOn(i, now))
+      continue;
+    if (i > 0 && !stages[i - 1].on)
+      break;
+    if (stage.cycles > 0 && now - stage.lastChange < config.minOffMs)
+      break;
+
+    stage.on = true;
+    stage.lastChange = now;
+    stage.cycles++;
+    changed = true;
+    break;
+  }
+
+  return changed;
+}
+
+uint8_t CoolingController::activeStages() const
+{
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < COOLING_STAGES; i++)
+  {
+    if (stages[i].on)
+      count++;
+  }
+  return count;
+}
@@ -0,0 +1,89 @@
+/*
+ * Staged, time-proportional Peltier cooling controller
+ *
+ * Replaces all-four-on/all-four-off bang-bang. A cooling demand between 0 and
+ * COOLING_STAGES is computed from the error to the produce's optimal setpoint,
+ * its trend and a slow integral term. Whole stages are switched on in order
+ * (stage 0 = Peltier 1 + pump, stage 1 = Peltier 2 + fans, then Peltier 3, 4)
+ * and the fractional remainder is duty-cycled on the next stage within a
+ * fixed time window.
+ *
+ * The relays follow the demand taken at the start of each window, so a
+ * demand hovering around a stage boundary can't switch that stage on and
+ * off within the window: each stage cycles at most once per window. A move
+ * of a whole stage or more, or the temperature leaving the produce's range,
+ * is followed right away.
+ *
+ * Every relay honours a minimum on and off time, and at most one relay is
+ * switched on per tick so the Peltier inrush currents never stack up.
+ *
+ * Pure logic, no Arduino dependencies: feed update() with samples, call tick()
+ * at a fixed period and apply stageOn() to the relays.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define COOLING_STAGES 4
+
+struct CoolingConfig
+{
+  float proportionalBand;    // °C above setpoint that demands every stage
+  float integralTimeS;       // Integral time (s); 0 disables the integral term
+  float trendLookaheadS;     // Error is extrapolated this far along the trend (s)
+  float trendTimeConstantS;  // Smoothing of the temperature slope (s)
+  unsigned long windowMs;    // Time-proportional window
+  unsigned long minOnMs;     // Minimum relay on time
+  unsigned long minOffMs;    // Minimum relay off time
+};
+
+class CoolingController
+{
+public:
+  explicit CoolingController(const CoolingConfig &config);
+
+  // Optimal temperature to track; limits force full/zero demand outside [min, max]
+  void setTargets(float setpoint, float minimum, float maximum);
+
+  // New temperature sample (timestamp in ms)
+  void update(float temperature, unsigned long now);
+
+  // Switching decision, call at a fixed period. Returns true if a relay changed.
+  bool tick(unsigned long now);
+
+  bool stageOn(uint8_t stage) const { return stages[stage].on; }
+  uint32_t stageCycles(uint8_t stage) const { return stages[stage].cycles; }
+  uint8_t activeStages() const;
+  float demand() const { return currentDemand; }
+  float windowDemand() const { return heldDemand; } // What the relays follow this window
+  float slope() const { return slopePerS; } // °C per second
+
+private:
+  struct Stage
+  {
+    bool on;
+    unsigned long lastChange;
+    uint32_t cycles; // Off -> on transitions since start-up
+  };
+
+  bool requestedOn(uint8_t stage, unsigned long now) const;
+
+  CoolingConfig config;
+
+  float setpoint;
+  float minimum;
+  float maximum;
+
+  bool haveSample;
+  float lastTemperature;
+  unsigned long lastSampleTime;
+  float slopePerS;
+  float integral; // Stages
+  float currentDemand;
+  float heldDemand; // currentDemand at the window start
+  bool outsideRange; // Last sample at or beyond minimum / maximum
+
+  unsigned long windowStart;
+  Stage stages[COOLING_STAGES];
+};
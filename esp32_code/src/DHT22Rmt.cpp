@@ -0,0 +1,163 @@
+#include "DHT22Rmt.h"
+
+DHT22Rmt::DHT22Rmt(uint8_t pin, rmt_channel_t channel)
+    : pin((gpio_num_t)pin), channel(channel), ringbuf(NULL), callback(NULL), callbackContext(NULL), state(IDLE),
+      startTime(0), captureTime(0), lastDuration(0), checksumErrors(0), timeouts(0)
+{
+}
+
+bool DHT22Rmt::begin()
+{
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX(pin, channel);
+  config.clk_div = 80; // 1 µs ticks from the 80 MHz APB clock
+  config.mem_block_num = DHT22_RMT_MEM_BLOCKS;
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = 100; // Ignore glitches shorter than 1.25 µs (APB ticks)
+  config.rx_config.idle_threshold = DHT22_IDLE_US;
+
+  if (rmt_config(&config) != ESP_OK || rmt_driver_install(channel, DHT22_RINGBUF_SIZE, 0) != ESP_OK)
+    return false;
+  if (rmt_get_ringbuf_handle(channel, &ringbuf) != ESP_OK)
+  {
+    ringbuf = NULL;
+    return false;
+  }
+
+  // Open drain: the receiver keeps listening on the pin while we drive the start signal
+  gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+  gpio_set_level(pin, 1);
+  return true;
+}
+
+void DHT22Rmt::onComplete(Dht22Callback callback, void *context)
+{
+  this->callback = callback;
+  callbackContext = context;
+}
+
+bool DHT22Rmt::start()
+{
+  if (ringbuf == NULL || state != IDLE)
+    return false;
+
+  gpio_set_level(pin, 0);
+  startTime = micros();
+  state = START_SIGNAL;
+  return true;
+}
+
+Dht22Status DHT22Rmt::poll(float &temperature, float &humidity)
+{
+  if (state == IDLE)
+    return DHT22_IDLE;
+
+  if (state == START_SIGNAL)
+  {
+    if (micros() - startTime < DHT22_START_LOW_US)
+      return DHT22_BUSY;
+
+    // Arm the receiver before releasing the line so the sensor's response is never missed
+    rmt_rx_start(channel, true);
+    gpio_set_level(pin, 1);
+    captureTime = micros();
+    state = CAPTURING;
+    return DHT22_BUSY;
+  }
+
+  // The RMT ISR only moves the items into the ring buffer; everything else happens here
+  size_t size = 0;
+  rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(ringbuf, &size, 0);
+  if (items == NULL)
+  {
+    if (micros() - captureTime < DHT22_FRAME_TIMEOUT_US)
+      return DHT22_BUSY;
+
+    rmt_rx_stop(channel);
+    timeouts++;
+    return finish(DHT22_TIMEOUT, temperature, humidity, NULL);
+  }
+
+  uint8_t data[5];
+  Dht22Status status = decode(items, size / sizeof(rmt_item32_t), data);
+  vRingbufferReturnItem(ringbuf, items);
+  rmt_rx_stop(channel);
+
+  if (status == DHT22_CHECKSUM_ERROR)
+    checksumErrors++;
+  return finish(status, temperature, humidity, status == DHT22_OK ? data : NULL);
+}
+
+Dht22Status DHT22Rmt::finish(Dht22Status status, float &temperature, float &humidity, const uint8_t *data)
+{
+  state = IDLE;
+  lastDuration = micros() - startTime;
+
+  if (data != NULL)
+  {
+    humidity = (((uint16_t)data[0] << 8) | data[1]) * 0.1f;
+    temperature = ((((uint16_t)data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+    if (data[2] & 0x80)
+      temperature = -temperature; // Sign-magnitude, not two's complement
+  }
+  else
+  {
+    temperature = NAN;
+    humidity = NAN;
+  }
+
+  if (callback != NULL)
+    callback(status, temperature, humidity, callbackContext);
+  return status;
+}
+
+Dht22Status DHT22Rmt::read(float &temperature, float &humidity)
+{
+  if (!start())
+    return DHT22_IDLE;
+
+  Dht22Status status;
+  while ((status = poll(temperature, humidity)) == DHT22_BUSY)
+    vTaskDelay(1);
+  return status;
+}
+
+// Frame: end of the start signal, ~30 µs high, 80 µs low + 80 µs high response,
+// then 40 bits of 50 µs low + 27/70 µs high. The data bits are the last 40 high pulses.
+Dht22Status DHT22Rmt::decode(const rmt_item32_t *items, size_t count, uint8_t data[5])
+{
+  uint16_t highs[2 * (DHT22_FRAME_BITS + 4)];
+  size_t highCount = 0;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    uint16_t levels[2] = {(uint16_t)items[i].level0, (uint16_t)items[i].level1};
+    uint16_t durations[2] = {(uint16_t)items[i].duration0, (uint16_t)items[i].duration1};
+
+    for (uint8_t half = 0; half < 2; half++)
+    {
+      if (durations[half] == 0)
+        break; // End marker
+      if (levels[half] == 0 || durations[half] >= DHT22_IDLE_US)
+        continue; // Low pulse, or the idle line after the frame
+      if (highCount == sizeof(highs) / sizeof(highs[0]))
+        return DHT22_FRAME_ERROR; // Noise, not a frame
+      highs[highCount++] = durations[half];
+    }
+  }
+
+  if (highCount < DHT22_FRAME_BITS)
+    return DHT22_FRAME_ERROR;
+
+  const uint16_t *bits = highs + highCount - DHT22_FRAME_BITS;
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    data[i] = 0;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      data[i] = (data[i] << 1) | (bits[i * 8 + bit] > DHT22_BIT_THRESHOLD_US ? 1 : 0);
+  }
+
+  if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4])
+    return DHT22_CHECKSUM_ERROR;
+  return DHT22_OK;
+}
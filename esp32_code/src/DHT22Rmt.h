@@ -0,0 +1,95 @@
+/*
+ * DHT22 / AM2302 driver on the ESP32 RMT peripheral
+ *
+ * The Adafruit library bit-bangs the 40-bit frame with interrupts disabled
+ * for ~5 ms, which upsets WiFi and the shared I2C bus. Here the RMT receiver
+ * timestamps every edge of the frame in hardware while interrupts stay
+ * enabled; the pulse train is decoded and checksummed in the caller's task.
+ *
+ * Non-blocking like the SGP41 driver: start() pulls the line low for the
+ * start signal, poll() releases it, arms the receiver and reports
+ * DHT22_BUSY until the frame is in. Temperature and humidity come from the
+ * same frame. A completion callback (task context, not ISR) can be set with
+ * onComplete(); read() is the blocking form, it sleeps between polls.
+ *
+ * Wiring as for the Adafruit library: open-drain data line, 10K pull-up.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/ringbuf.h>
+
+#define DHT22_START_LOW_US 1100       // Host start signal (datasheet: 0.8-20 ms)
+#define DHT22_BIT_THRESHOLD_US 48     // High time: ~27 µs = 0, ~70 µs = 1
+#define DHT22_IDLE_US 150             // No edge for this long ends the capture (longest pulse is 80 µs)
+#define DHT22_FRAME_TIMEOUT_US 20000  // Response + 40 bits take ~5 ms
+#define DHT22_FRAME_BITS 40
+#define DHT22_RMT_MEM_BLOCKS 2        // 128 items; a frame needs ~43
+#define DHT22_RINGBUF_SIZE 1024
+
+enum Dht22Status
+{
+  DHT22_OK,
+  DHT22_BUSY,           // Start signal or capture still running, poll again later
+  DHT22_TIMEOUT,        // No (complete) frame from the sensor
+  DHT22_FRAME_ERROR,    // Fewer than 40 bits captured
+  DHT22_CHECKSUM_ERROR, // Data corrupted on the line
+  DHT22_IDLE,           // No read pending (or begin() failed)
+};
+
+// Called from poll() when a read finishes; temperature/humidity are NAN unless status is DHT22_OK
+typedef void (*Dht22Callback)(Dht22Status status, float temperature, float humidity, void *context);
+
+class DHT22Rmt
+{
+public:
+  DHT22Rmt(uint8_t pin, rmt_channel_t channel);
+
+  // Install the RMT receiver (channel plus the next DHT22_RMT_MEM_BLOCKS - 1) and release the line
+  bool begin();
+
+  void onComplete(Dht22Callback callback, void *context = NULL);
+
+  // Send the start signal; at most one read per 2 s (sensor limit)
+  bool start();
+
+  // Drive the read started by start(); temperature (°C) and humidity (%) are valid with DHT22_OK
+  Dht22Status poll(float &temperature, float &humidity);
+
+  // start() + poll() until done, sleeping a tick between polls (~6 ms)
+  Dht22Status read(float &temperature, float &humidity);
+
+  uint32_t lastReadDuration() const { return lastDuration; } // µs from start() to decode
+  uint32_t checksumErrorCount() const { return checksumErrors; }
+  uint32_t timeoutCount() const { return timeouts; }
+
+  // Decode a captured pulse train into the 5 frame bytes and check the checksum
+  static Dht22Status decode(const rmt_item32_t *items, size_t count, uint8_t data[5]);
+
+private:
+  enum State
+  {
+    IDLE,
+    START_SIGNAL, // Line held low
+    CAPTURING,    // Line released, receiver armed
+  };
+
+  Dht22Status finish(Dht22Status status, float &temperature, float &humidity, const uint8_t *data);
+
+  gpio_num_t pin;
+  rmt_channel_t channel;
+  RingbufHandle_t ringbuf;
+  Dht22Callback callback;
+  void *callbackContext;
+
+  State state;
+  uint32_t startTime;   // micros() at start()
+  uint32_t captureTime; // micros() when the receiver was armed
+  uint32_t lastDuration;
+  uint32_t checksumErrors;
+  uint32_t timeouts;
+};
@@ -0,0 +1,435 @@
+#include "GasIndexAlgorithm.h"
+
+// Q16.16 helpers
+#define F16(x) ((fix16_t)(((x) >= 0) ? ((x) * 65536.0 + 0.5) : ((x) * 65536.0 - 0.5)))
+#define FIX16_ONE ((fix16_t)0x00010000)
+#define FIX16_MAXIMUM ((fix16_t)0x7FFFFFFF)
+#define FIX16_MINIMUM ((fix16_t)0x80000000)
+
+// Algorithm parameters (Sensirion Gas Index Algorithm v3)
+#define SAMPLING_INTERVAL 1.0 // Seconds, see GAS_INDEX_SAMPLING_INTERVAL_MS
+#define INITIAL_BLACKOUT F16(45.0)
+#define INDEX_GAIN F16(230.0)
+#define SRAW_STD_INITIAL F16(50.0)
+#define SRAW_STD_BONUS_VOC F16(220.0)
+#define SRAW_STD_NOX F16(2000.0)
+#define TAU_MEAN_HOURS 12.0
+#define TAU_VARIANCE_HOURS 12.0
+#define TAU_INITIAL_MEAN_VOC 20.0
+#define TAU_INITIAL_MEAN_NOX 1200.0
+#define INIT_DURATION_MEAN_VOC F16(3600.0 * 0.75)
+#define INIT_DURATION_MEAN_NOX F16(3600.0 * 4.75)
+#define INIT_TRANSITION_MEAN F16(0.01)
+#define TAU_INITIAL_VARIANCE 2500.0
+#define INIT_DURATION_VARIANCE_VOC F16(3600.0 * 1.45)
+#define INIT_DURATION_VARIANCE_NOX F16(3600.0 * 5.70)
+#define INIT_TRANSITION_VARIANCE F16(0.01)
+#define GATING_THRESHOLD_VOC F16(340.0)
+#define GATING_THRESHOLD_NOX F16(30.0)
+#define GATING_THRESHOLD_INITIAL F16(510.0)
+#define GATING_THRESHOLD_TRANSITION F16(0.09)
+#define GATING_VOC_MAX_DURATION_MINUTES F16(60.0 * 3.0)
+#define GATING_NOX_MAX_DURATION_MINUTES F16(60.0 * 12.0)
+#define GATING_MAX_RATIO F16(0.3)
+#define SIGMOID_L F16(500.0)
+#define SIGMOID_K_VOC F16(-0.0065)
+#define SIGMOID_X0_VOC F16(213.0)
+#define SIGMOID_K_NOX F16(-0.0101)
+#define SIGMOID_X0_NOX F16(614.0)
+#define VOC_INDEX_OFFSET_DEFAULT F16(100.0)
+#define NOX_INDEX_OFFSET_DEFAULT F16(1.0)
+#define LP_TAU_FAST 20.0
+#define LP_TAU_SLOW 500.0
+#define LP_ALPHA F16(-0.2)
+#define VOC_SRAW_MINIMUM 20000
+#define NOX_SRAW_MINIMUM 10000
+#define PERSISTENCE_UPTIME_GAMMA F16(3.0 * 3600.0)
+#define MVE_GAMMA_SCALING 64.0
+#define MVE_ADDITIONAL_GAMMA_MEAN_SCALING 8.0
+#define MVE_FIX16_MAX F16(32767.0)
+
+// Learning rates, precomputed for the fixed 1 s sampling interval so the
+// small ratios keep their precision in Q16.16
+#define GAMMA_MEAN F16(MVE_ADDITIONAL_GAMMA_MEAN_SCALING * MVE_GAMMA_SCALING * (SAMPLING_INTERVAL / 3600.0) / \
+                       (TAU_MEAN_HOURS + SAMPLING_INTERVAL / 3600.0))
+#define GAMMA_VARIANCE F16(MVE_GAMMA_SCALING * (SAMPLING_INTERVAL / 3600.0) / \
+                           (TAU_VARIANCE_HOURS + SAMPLING_INTERVAL / 3600.0))
+#define GAMMA_INITIAL_MEAN_VOC F16(MVE_ADDITIONAL_GAMMA_MEAN_SCALING * MVE_GAMMA_SCALING * SAMPLING_INTERVAL / \
+                                   (TAU_INITIAL_MEAN_VOC + SAMPLING_INTERVAL))
+#define GAMMA_INITIAL_MEAN_NOX F16(MVE_ADDITIONAL_GAMMA_MEAN_SCALING * MVE_GAMMA_SCALING * SAMPLING_INTERVAL / \
+                                   (TAU_INITIAL_MEAN_NOX + SAMPLING_INTERVAL))
+#define GAMMA_INITIAL_VARIANCE F16(MVE_GAMMA_SCALING * SAMPLING_INTERVAL / (TAU_INITIAL_VARIANCE + SAMPLING_INTERVAL))
+#define LP_A1 F16(SAMPLING_INTERVAL / (LP_TAU_FAST + SAMPLING_INTERVAL))
+#define LP_A2 F16(SAMPLING_INTERVAL / (LP_TAU_SLOW + SAMPLING_INTERVAL))
+
+static fix16_t fix16Saturate(int64_t value)
+{
+  if (value > FIX16_MAXIMUM)
+    return FIX16_MAXIMUM;
+  if (value < FIX16_MINIMUM)
+    return FIX16_MINIMUM;
+  return (fix16_t)value;
+}
+
+static fix16_t fix16Add(fix16_t a, fix16_t b)
+{
+  return fix16Saturate((int64_t)a + b);
+}
+
+static fix16_t fix16Mul(fix16_t a, fix16_t b)
+{
+  int64_t product = (int64_t)a * b;
+  return fix16Saturate((product + 0x8000) >> 16);
+}
+
+static fix16_t fix16Div(fix16_t a, fix16_t b)
+{
+  if (b == 0)
+    return (a >= 0) ? FIX16_MAXIMUM : FIX16_MINIMUM;
+
+  int64_t dividend = (int64_t)a * FIX16_ONE;
+  int64_t half = (b > 0 ? b : -(int64_t)b) / 2;
+  dividend += ((dividend >= 0) == (b > 0)) ? half : -half; // Round to nearest
+  return fix16Saturate(dividend / b);
+}
+
+static fix16_t fix16Sqrt(fix16_t x)
+{
+  if (x <= 0)
+    return 0;
+
+  // Integer square root of x << 16 gives the Q16.16 result directly
+  uint64_t num = (uint64_t)x << 16;
+  uint64_t result = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > num)
+    bit >>= 2;
+
+  while (bit != 0)
+  {
+    if (num >= result + bit)
+    {
+      num -= result + bit;
+      result = (result >> 1) + bit;
+    }
+    else
+    {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  return (fix16_t)result;
+}
+
+static fix16_t fix16Exp(fix16_t x)
+{
+  // e^x as a product of e^1, e^(1/8), e^(1/64), e^(1/512) steps
+  static const fix16_t expPosValues[4] = {F16(2.7182818), F16(1.1331485), F16(1.0157477), F16(1.0019550)};
+  static const fix16_t expNegValues[4] = {F16(0.3678794), F16(0.8824969), F16(0.9844964), F16(0.9980488)};
+
+  if (x >= F16(10.3972))
+    return FIX16_MAXIMUM; // Add to it with fix16Add()
+  if (x <= F16(-11.7835))
+    return 0;
+
+  const fix16_t *expValues = expPosValues;
+  if (x < 0)
+  {
+    x = -x;
+    expValues = expNegValues;
+  }
+
+  fix16_t result = FIX16_ONE;
+  fix16_t step = FIX16_ONE;
+  for (int i = 0; i < 4; i++)
+  {
+    while (x >= step)
+    {
+      result = fix16Mul(result, expValues[i]);
+      x -= step;
+    }
+    step >>= 3;
+  }
+
+  return result;
+}
+
+GasIndexAlgorithm::GasIndexAlgorithm(GasIndexType type) : algorithmType(type)
+{
+  if (type == GAS_INDEX_NOX)
+  {
+    srawMinimum = NOX_SRAW_MINIMUM;
+    indexOffset = NOX_INDEX_OFFSET_DEFAULT;
+    gatingThreshold = GATING_THRESHOLD_NOX;
+    gatingMaxDurationMinutes = GATING_NOX_MAX_DURATION_MINUTES;
+    initDurationMean = INIT_DURATION_MEAN_NOX;
+    initDurationVariance = INIT_DURATION_VARIANCE_NOX;
+    srawStdInitial = SRAW_STD_NOX;
+    mveGammaInitialMean = GAMMA_INITIAL_MEAN_NOX;
+    sigmoidScaledK = SIGMOID_K_NOX;
+    sigmoidScaledX0 = SIGMOID_X0_NOX;
+  }
+  else
+  {
+    srawMinimum = VOC_SRAW_MINIMUM;
+    indexOffset = VOC_INDEX_OFFSET_DEFAULT;
+    gatingThreshold = GATING_THRESHOLD_VOC;
+    gatingMaxDurationMinutes = GATING_VOC_MAX_DURATION_MINUTES;
+    initDurationMean = INIT_DURATION_MEAN_VOC;
+    initDurationVariance = INIT_DURATION_VARIANCE_VOC;
+    srawStdInitial = SRAW_STD_INITIAL;
+    mveGammaInitialMean = GAMMA_INITIAL_MEAN_VOC;
+    sigmoidScaledK = SIGMOID_K_VOC;
+    sigmoidScaledX0 = SIGMOID_X0_VOC;
+  }
+  mveGammaInitialVariance = GAMMA_INITIAL_VARIANCE;
+  sigmoidScaledOffset = indexOffset;
+
+  reset();
+}
+
+void GasIndexAlgorithm::reset()
+{
+  uptime = 0;
+  sraw = 0;
+  gasIndex = 0;
+
+  mveInitialized = false;
+  mveMean = 0;
+  mveSrawOffset = 0;
+  mveStd = srawStdInitial;
+  mveGammaMean = 0;
+  mveGammaVariance = 0;
+  mveUptimeGamma = 0;
+  mveUptimeGating = 0;
+  mveGatingDurationMinutes = 0;
+  mveSigmoidK = 0;
+  mveSigmoidX0 = 0;
+
+  moxSrawStd = mveStd;
+  moxSrawMean = meanVarianceEstimatorGetMean();
+
+  lpInitialized = false;
+  lpX1 = 0;
+  lpX2 = 0;
+  lpX3 = 0;
+}
+
+int32_t GasIndexAlgorithm::process(int32_t rawSample)
+{
+  if (uptime <= INITIAL_BLACKOUT)
+  {
+    uptime += F16(SAMPLING_INTERVAL);
+  }
+  else
+  {
+    if (rawSample > 0 && rawSample < 65000)
+    {
+      if (rawSample < srawMinimum + 1)
+        rawSample = srawMinimum + 1;
+      else if (rawSample > srawMinimum + 32767)
+        rawSample = srawMinimum + 32767;
+      sraw = (fix16_t)((rawSample - srawMinimum) << 16);
+    }
+
+    // NOx stays at its offset until the estimator has a baseline
+    if (algorithmType == GAS_INDEX_VOC || mveInitialized)
+    {
+      gasIndex = moxModelProcess(sraw);
+      gasIndex = sigmoidScaledProcess(gasIndex);
+    }
+    else
+    {
+      gasIndex = indexOffset;
+    }
+
+    gasIndex = adaptiveLowpassProcess(gasIndex);
+    if (gasIndex < F16(0.5))
+      gasIndex = F16(0.5);
+
+    if (sraw > 0)
+    {
+      meanVarianceEstimatorProcess(sraw);
+      moxSrawStd = mveStd;
+      moxSrawMean = meanVarianceEstimatorGetMean();
+    }
+  }
+
+  return (gasIndex + F16(0.5)) >> 16;
+}
+
+void GasIndexAlgorithm::getStates(fix16_t &state0, fix16_t &state1) const
+{
+  state0 = meanVarianceEstimatorGetMean();
+  state1 = mveStd;
+}
+
+void GasIndexAlgorithm::setStates(fix16_t state0, fix16_t state1)
+{
+  mveMean = state0;
+  mveSrawOffset = 0;
+  mveStd = state1;
+  mveUptimeGamma = PERSISTENCE_UPTIME_GAMMA; // Skip the fast initial learning phase
+  mveInitialized = true;
+
+  moxSrawStd = mveStd;
+  moxSrawMean = meanVarianceEstimatorGetMean();
+  sraw = state0;
+}
+
+fix16_t GasIndexAlgorithm::meanVarianceEstimatorGetMean() const
+{
+  return mveMean + mveSrawOffset;
+}
+
+void GasIndexAlgorithm::meanVarianceEstimatorSigmoidSetParameters(fix16_t x0, fix16_t k)
+{
+  mveSigmoidK = k;
+  mveSigmoidX0 = x0;
+}
+
+fix16_t GasIndexAlgorithm::meanVarianceEstimatorSigmoidProcess(fix16_t sample) const
+{
+  fix16_t x = fix16Mul(mveSigmoidK, sample - mveSigmoidX0);
+  if (x < F16(-50.0))
+    return FIX16_ONE;
+  if (x > F16(50.0))
+    return 0;
+  return fix16Div(FIX16_ONE, fix16Add(FIX16_ONE, fix16Exp(x)));
+}
+
+void GasIndexAlgorithm::meanVarianceEstimatorCalculateGamma()
+{
+  fix16_t uptimeLimit = MVE_FIX16_MAX - F16(SAMPLING_INTERVAL);
+  if (mveUptimeGamma < uptimeLimit)
+    mveUptimeGamma += F16(SAMPLING_INTERVAL);
+  if (mveUptimeGating < uptimeLimit)
+    mveUptimeGating += F16(SAMPLING_INTERVAL);
+
+  // Mean: fast learning right after start-up, then the slow 12 h time constant,
+  // gated off while the index is high so events don't become the new baseline
+  meanVarianceEstimatorSigmoidSetParameters(initDurationMean, INIT_TRANSITION_MEAN);
+  fix16_t sigmoidGammaMean = meanVarianceEstimatorSigmoidProcess(mveUptimeGamma);
+  fix16_t gammaMean = GAMMA_MEAN + fix16Mul(mveGammaInitialMean - GAMMA_MEAN, sigmoidGammaMean);
+  fix16_t gatingThresholdMean =
+      gatingThreshold + fix16Mul(GATING_THRESHOLD_INITIAL - gatingThreshold,
+                                 meanVarianceEstimatorSigmoidProcess(mveUptimeGating));
+  meanVarianceEstimatorSigmoidSetParameters(gatingThresholdMean, GATING_THRESHOLD_TRANSITION);
+  fix16_t sigmoidGatingMean = meanVarianceEstimatorSigmoidProcess(gasIndex);
+  mveGammaMean = fix16Mul(sigmoidGatingMean, gammaMean);
+
+  // Variance: same scheme with its own initial duration
+  meanVarianceEstimatorSigmoidSetParameters(initDurationVariance, INIT_TRANSITION_VARIANCE);
+  fix16_t sigmoidGammaVariance = meanVarianceEstimatorSigmoidProcess(mveUptimeGamma);
+  fix16_t gammaVariance = GAMMA_VARIANCE + fix16Mul(mveGammaInitialVariance - GAMMA_VARIANCE,
+                                                    sigmoidGammaVariance - sigmoidGammaMean);
+  fix16_t gatingThresholdVariance =
+      gatingThreshold + fix16Mul(GATING_THRESHOLD_INITIAL - gatingThreshold,
+                                 meanVarianceEstimatorSigmoidProcess(mveUptimeGating));
+  meanVarianceEstimatorSigmoidSetParameters(gatingThresholdVariance, GATING_THRESHOLD_TRANSITION);
+  fix16_t sigmoidGatingVariance = meanVarianceEstimatorSigmoidProcess(gasIndex);
+  mveGammaVariance = fix16Mul(sigmoidGatingVariance, gammaVariance);
+
+  // Don't stay gated forever: after the maximum duration learning resumes
+  mveGatingDurationMinutes += fix16Mul(F16(SAMPLING_INTERVAL / 60.0),
+                                       fix16Mul(FIX16_ONE - sigmoidGatingMean, FIX16_ONE + GATING_MAX_RATIO) -
+                                           GATING_MAX_RATIO);
+  if (mveGatingDurationMinutes < 0)
+    mveGatingDurationMinutes = 0;
+  if (mveGatingDurationMinutes > gatingMaxDurationMinutes)
+    mveUptimeGating = 0;
+}
+
+void GasIndexAlgorithm::meanVarianceEstimatorProcess(fix16_t sample)
+{
+  if (!mveInitialized)
+  {
+    mveInitialized = true;
+    mveSrawOffset = sample;
+    mveMean = 0;
+    return;
+  }
+
+  // Keep the mean near zero so the products below stay inside Q16.16
+  if (mveMean >= F16(100.0) || mveMean <= F16(-100.0))
+  {
+    mveSrawOffset += mveMean;
+    mveMean = 0;
+  }
+
+  sample -= mveSrawOffset;
+  meanVarianceEstimatorCalculateGamma();
+
+  fix16_t delta = fix16Div(sample - mveMean, F16(MVE_GAMMA_SCALING));
+  fix16_t c = (delta < 0) ? mveStd - delta : mveStd + delta;
+
+  fix16_t additionalScaling = FIX16_ONE;
+  if (c > F16(1440.0))
+  {
+    fix16_t ratio = fix16Div(c, F16(1440.0));
+    additionalScaling = fix16Mul(ratio, ratio);
+  }
+
+  mveStd = fix16Mul(
+      fix16Sqrt(fix16Mul(additionalScaling, F16(MVE_GAMMA_SCALING) - mveGammaVariance)),
+      fix16Sqrt(fix16Mul(mveStd, fix16Div(mveStd, fix16Mul(F16(MVE_GAMMA_SCALING), additionalScaling))) +
+                fix16Mul(fix16Div(fix16Mul(mveGammaVariance, delta), additionalScaling), delta)));
+  mveMean += fix16Div(fix16Mul(mveGammaMean, delta), F16(MVE_ADDITIONAL_GAMMA_MEAN_SCALING));
+}
+
+fix16_t GasIndexAlgorithm::moxModelProcess(fix16_t sample) const
+{
+  if (algorithmType == GAS_INDEX_NOX)
+    return fix16Mul(fix16Div(sample - moxSrawMean, SRAW_STD_NOX), INDEX_GAIN);
+
+  return fix16Mul(fix16Div(sample - moxSrawMean, -(moxSrawStd + SRAW_STD_BONUS_VOC)), INDEX_GAIN);
+}
+
+fix16_t GasIndexAlgorithm::sigmoidScaledProcess(fix16_t sample) const
+{
+  fix16_t x = fix16Mul(sigmoidScaledK, sample - sigmoidScaledX0);
+  if (x < F16(-50.0))
+    return SIGMOID_L;
+  if (x > F16(50.0))
+    return 0;
+
+  if (sample >= 0)
+  {
+    fix16_t shift;
+    if (sigmoidScaledOffset == FIX16_ONE)
+      shift = fix16Mul(F16(500.0 / 499.0), FIX16_ONE - indexOffset);
+    else
+      shift = fix16Div(SIGMOID_L - fix16Mul(F16(5.0), indexOffset), F16(4.0));
+    return fix16Div(SIGMOID_L + shift, fix16Add(FIX16_ONE, fix16Exp(x))) - shift;
+  }
+
+  return fix16Mul(fix16Div(indexOffset, VOC_INDEX_OFFSET_DEFAULT),
+                  fix16Div(SIGMOID_L, fix16Add(FIX16_ONE, fix16Exp(x))));
+}
+
+fix16_t GasIndexAlgorithm::adaptiveLowpassProcess(fix16_t sample)
+{
+  if (!lpInitialized)
+  {
+    lpX1 = sample;
+    lpX2 = sample;
+    lpX3 = sample;
+    lpInitialized = true;
+  }
+
+  lpX1 = fix16Mul(FIX16_ONE - LP_A1, lpX1) + fix16Mul(LP_A1, sample);
+  lpX2 = fix16Mul(FIX16_ONE - LP_A2, lpX2) + fix16Mul(LP_A2, sample);
+
+  // Fast filter when the two disagree (a real event), slow filter otherwise
+  fix16_t absDelta = lpX1 - lpX2;
+  if (absDelta < 0)
+    absDelta = -absDelta;
+  fix16_t f1 = fix16Exp(fix16Mul(LP_ALPHA, absDelta));
+  fix16_t tauA = fix16Mul(F16(LP_TAU_SLOW - LP_TAU_FAST), f1) + F16(LP_TAU_FAST);
+  fix16_t a3 = fix16Div(F16(SAMPLING_INTERVAL), F16(SAMPLING_INTERVAL) + tauA);
+  lpX3 = fix16Mul(FIX16_ONE - a3, lpX3) + fix16Mul(a3, sample);
+
+  return lpX3;
+}
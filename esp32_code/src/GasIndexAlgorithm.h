@@ -0,0 +1,100 @@
+/*
+ * Sensirion Gas Index Algorithm (VOC + NOx), fixed-point implementation
+ *
+ * Turns SGP41 raw ticks into the Sensirion VOC Index (1-500, 100 = average
+ * conditions of the last 24 h) and NOx Index (1-500, 1 = clean air). The
+ * algorithm learns the sensor's baseline online, so it must be fed exactly
+ * once per GAS_INDEX_SAMPLING_INTERVAL_MS.
+ *
+ * All arithmetic is Q16.16 integer (no float), following the structure of
+ * Sensirion's reference implementation. No Arduino dependencies, so the same
+ * code builds on the host for replaying recorded raw traces.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define GAS_INDEX_SAMPLING_INTERVAL_MS 1000 // Algorithm is tuned for 1 Hz
+
+typedef int32_t fix16_t; // Q16.16
+
+enum GasIndexType
+{
+  GAS_INDEX_VOC,
+  GAS_INDEX_NOX,
+};
+
+class GasIndexAlgorithm
+{
+public:
+  explicit GasIndexAlgorithm(GasIndexType type);
+
+  // Forget everything learned (baseline, variance, uptime)
+  void reset();
+
+  // Feed one raw sample; returns the index (0 during the first 45 s blackout)
+  int32_t process(int32_t sraw);
+
+  // Learned baseline (mean, std) for persisting across reboots
+  void getStates(fix16_t &state0, fix16_t &state1) const;
+  void setStates(fix16_t state0, fix16_t state1);
+
+  GasIndexType type() const { return algorithmType; }
+
+private:
+  fix16_t meanVarianceEstimatorGetMean() const;
+  void meanVarianceEstimatorCalculateGamma();
+  void meanVarianceEstimatorProcess(fix16_t sample);
+  void meanVarianceEstimatorSigmoidSetParameters(fix16_t x0, fix16_t k);
+  fix16_t meanVarianceEstimatorSigmoidProcess(fix16_t sample) const;
+  fix16_t moxModelProcess(fix16_t sample) const;
+  fix16_t sigmoidScaledProcess(fix16_t sample) const;
+  fix16_t adaptiveLowpassProcess(fix16_t sample);
+
+  GasIndexType algorithmType;
+
+  // Tuning (fixed per algorithm type)
+  int32_t srawMinimum;
+  fix16_t indexOffset;
+  fix16_t gatingThreshold;
+  fix16_t gatingMaxDurationMinutes;
+  fix16_t initDurationMean;
+  fix16_t initDurationVariance;
+  fix16_t srawStdInitial;
+
+  // Top-level state
+  fix16_t uptime;
+  fix16_t sraw;
+  fix16_t gasIndex;
+
+  // Mean/variance estimator
+  bool mveInitialized;
+  fix16_t mveMean;
+  fix16_t mveSrawOffset;
+  fix16_t mveStd;
+  fix16_t mveGammaMean;     // Effective (gated) learning rates
+  fix16_t mveGammaVariance;
+  fix16_t mveGammaInitialMean;
+  fix16_t mveGammaInitialVariance;
+  fix16_t mveUptimeGamma;
+  fix16_t mveUptimeGating;
+  fix16_t mveGatingDurationMinutes;
+  fix16_t mveSigmoidK;
+  fix16_t mveSigmoidX0;
+
+  // MOX model (baseline the index is computed against)
+  fix16_t moxSrawStd;
+  fix16_t moxSrawMean;
+
+  // Sigmoid scaling to the 0-500 index range
+  fix16_t sigmoidScaledK;
+  fix16_t sigmoidScaledX0;
+  fix16_t sigmoidScaledOffset;
+
+  // Adaptive lowpass
+  bool lpInitialized;
+  fix16_t lpX1;
+  fix16_t lpX2;
+  fix16_t lpX3;
+};
@@ -0,0 +1,122 @@
+/*
+ * Hardware abstraction for the controller logic
+ *
+ * The acquisition, control and telemetry code only talks to the hardware
+ * through these interfaces, so the same code runs on the ESP32 (ArduinoHal)
+ * and on a Linux host against simulated sensors and a virtual clock (SimHal,
+ * env:native).
+ *
+ * Pure C++, no Arduino dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Monotonic milliseconds/microseconds plus wall-clock time
+class Clock
+{
+public:
+  virtual ~Clock() {}
+  virtual uint32_t millis() = 0;
+  virtual uint32_t micros() = 0;
+  virtual uint32_t unixTime() = 0; // 0 while the clock isn't synced
+};
+
+#define CLIMATE_PROBES_MAX 8 // Temperature/humidity probes per room
+
+enum ClimateStatus
+{
+  CLIMATE_OK,
+  CLIMATE_BUSY,   // Conversion still running, poll again later
+  CLIMATE_FAILED, // Timeout, bus or checksum error
+};
+
+// Temperature + relative humidity probe (DHT22, SHT4x/SHT3x)
+class ClimateSensor
+{
+public:
+  virtual ~ClimateSensor() {}
+  virtual bool begin() = 0;
+  // One reading of both values; false on a timeout or checksum error
+  virtual bool read(float &temperature, float &humidity) = 0;
+  // Split-phase form of read(), so the probes of a room convert at the same
+  // time: start(), then poll() until it stops answering CLIMATE_BUSY
+  virtual bool start() = 0;
+  virtual ClimateStatus poll(float &temperature, float &humidity) = 0;
+};
+
+enum GasStatus
+{
+  GAS_OK,
+  GAS_BUSY,      // Conversion still running, poll again later
+  GAS_I2C_ERROR, // No ACK or short read
+  GAS_CRC_ERROR, // Data corrupted on the bus
+  GAS_IDLE,      // No command pending
+};
+
+// VOC + NOx raw signal sensor (SGP41): start a conversion, then poll for the result
+class GasSensor
+{
+public:
+  virtual ~GasSensor() {}
+  virtual bool begin() = 0;
+  virtual bool startConditioning(float humidity, float temperature) = 0;
+  virtual bool startMeasurement(float humidity, float temperature) = 0;
+  virtual GasStatus readResult(uint16_t &srawVoc, uint16_t &srawNox) = 0;
+  virtual uint64_t serialNumber() const = 0;
+};
+
+// Relay channels: the cooling stages in switch-on order, then the humidifier + scrubber
+#define RELAY_COOLING_FIRST 0 // Channels 0-3: Peltier 1 + pump, Peltier 2 + fans, Peltier 3, Peltier 4
+#define RELAY_HUMIDIFIER_SCRUBBER 4
+#define RELAY_CHANNELS 5
+
+class RelayBank
+{
+public:
+  virtual ~RelayBank() {}
+  virtual void set(uint8_t channel, bool on) = 0;
+};
+
+// What the status screen shows
+struct DisplayState
+{
+  float temperature;
+  float humidity;
+  float vocIndex;
+  bool temperatureAlarm; // Outside the produce's range
+  bool humidityAlarm;
+  bool vocAlarm;
+  bool cooling;
+  bool pump;
+  bool humidifierScrubber;
+};
+
+class StatusDisplay
+{
+public:
+  virtual ~StatusDisplay() {}
+  virtual bool begin() = 0;
+  virtual void showReadings(const DisplayState &state) = 0;
+  virtual void showSensorError(int attempts) = 0;
+};
+
+// Request/response transport to the backend
+class HttpTransport
+{
+public:
+  virtual ~HttpTransport() {}
+
+  // Send a request ("GET"/"POST"; contentType/accept/body may be NULL). Up to
+  // responseSize bytes of the response body are copied to response and their
+  // count stored in responseLength. Returns the HTTP status, negative if the
+  // request got no response.
+  virtual int request(const char *method, const char *url, const char *contentType, const char *accept,
+                      const uint8_t *body, size_t length,
+                      uint8_t *response, size_t responseSize, size_t &responseLength) = 0;
+
+  // Content-Type of the last response ("" if none)
+  virtual const char *responseType() const = 0;
+};
@@ -0,0 +1,135 @@
+#include "SGP41.h"
+#include "SensirionCrc.h"
+
+SGP41::SGP41(TwoWire &wire, uint8_t address)
+    : wire(wire), address(address), serial(0), crcErrors(0), pendingWords(0), startTime(0)
+{
+}
+
+bool SGP41::begin()
+{
+  if (!sendCommand(SGP41_CMD_GET_SERIAL_NUMBER, NULL, 0))
+    return false;
+
+  delay(1); // get_serial_number takes 1 ms
+
+  uint16_t words[3];
+  if (readWords(words, 3) != SGP41_OK)
+    return false;
+
+  serial = ((uint64_t)words[0] << 32) | ((uint64_t)words[1] << 16) | words[2];
+  return true;
+}
+
+bool SGP41::startConditioning(float humidity, float temperature)
+{
+  uint16_t args[2] = {humidityTicks(humidity), temperatureTicks(temperature)};
+  if (!sendCommand(SGP41_CMD_EXECUTE_CONDITIONING, args, 2))
+    return false;
+
+  pendingWords = 1; // VOC only
+  startTime = millis();
+  return true;
+}
+
+bool SGP41::startMeasurement(float humidity, float temperature)
+{
+  uint16_t args[2] = {humidityTicks(humidity), temperatureTicks(temperature)};
+  if (!sendCommand(SGP41_CMD_MEASURE_RAW_SIGNALS, args, 2))
+    return false;
+
+  pendingWords = 2; // VOC + NOx
+  startTime = millis();
+  return true;
+}
+
+Sgp41Status SGP41::readResult(uint16_t &srawVoc, uint16_t &srawNox)
+{
+  if (pendingWords == 0)
+    return SGP41_IDLE;
+
+  unsigned long elapsed = millis() - startTime;
+  if (elapsed < SGP41_MEASURE_TYPICAL_MS)
+    return SGP41_BUSY;
+
+  uint16_t words[2] = {0, 0};
+  Sgp41Status status = readWords(words, pendingWords);
+
+  // The sensor NACKs reads while it is still converting
+  if (status == SGP41_I2C_ERROR && elapsed < SGP41_MEASURE_MAX_MS)
+    return SGP41_BUSY;
+
+  pendingWords = 0;
+  if (status == SGP41_OK)
+  {
+    srawVoc = words[0];
+    srawNox = words[1];
+  }
+  return status;
+}
+
+bool SGP41::turnHeaterOff()
+{
+  pendingWords = 0;
+  return sendCommand(SGP41_CMD_TURN_HEATER_OFF, NULL, 0);
+}
+
+uint16_t SGP41::humidityTicks(float humidity)
+{
+  if (humidity < 0.0f)
+    humidity = 0.0f;
+  if (humidity > 100.0f)
+    humidity = 100.0f;
+  return (uint16_t)(humidity * 65535.0f / 100.0f + 0.5f);
+}
+
+uint16_t SGP41::temperatureTicks(float temperature)
+{
+  if (temperature < -45.0f)
+    temperature = -45.0f;
+  if (temperature > 130.0f)
+    temperature = 130.0f;
+  return (uint16_t)((temperature + 45.0f) * 65535.0f / 175.0f + 0.5f);
+}
+
+bool SGP41::sendCommand(uint16_t command, const uint16_t *args, uint8_t argCount)
+{
+  wire.beginTransmission(address);
+  wire.write((uint8_t)(command >> 8));
+  wire.write((uint8_t)(command & 0xFF));
+
+  for (uint8_t i = 0; i < argCount; i++)
+  {
+    uint8_t word[2] = {(uint8_t)(args[i] >> 8), (uint8_t)(args[i] & 0xFF)};
+    wire.write(word[0]);
+    wire.write(word[1]);
+    wire.write(sensirionCrc8(word, 2));
+  }
+
+  return wire.endTransmission() == 0;
+}
+
+Sgp41Status SGP41::readWords(uint16_t *words, uint8_t count)
+{
+  uint8_t length = count * 3; // Each word is followed by its CRC
+  if (wire.requestFrom(address, length) != length)
+    return SGP41_I2C_ERROR;
+
+  Sgp41Status status = SGP41_OK;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uint8_t word[2];
+    word[0] = wire.read();
+    word[1] = wire.read();
+    uint8_t crc = wire.read();
+
+    if (sensirionCrc8(word, 2) != crc)
+    {
+      crcErrors++;
+      status = SGP41_CRC_ERROR;
+    }
+    words[i] = ((uint16_t)word[0] << 8) | word[1];
+  }
+
+  return status;
+}
@@ -0,0 +1,78 @@
+/*
+ * Sensirion SGP41 VOC + NOx sensor driver (I2C)
+ *
+ * Non-blocking: start*() sends a command and returns immediately, readResult()
+ * is polled afterwards and reports SGP41_BUSY until the conversion is done.
+ * Every word read back is checked against its Sensirion CRC-8 (SensirionCrc.h).
+ *
+ * Typical use:
+ * - executeConditioning once per second for the first 10 s after power-up
+ * - then measureRawSignals once per second with live T/RH compensation
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define SGP41_DEFAULT_ADDRESS 0x59
+
+// Command codes (datasheet section 4)
+#define SGP41_CMD_EXECUTE_CONDITIONING 0x2612
+#define SGP41_CMD_MEASURE_RAW_SIGNALS 0x2619
+#define SGP41_CMD_TURN_HEATER_OFF 0x3615
+#define SGP41_CMD_GET_SERIAL_NUMBER 0x3682
+
+// Conversion times (ms): result is usually ready after 30 ms, guaranteed after 50 ms
+#define SGP41_MEASURE_TYPICAL_MS 30
+#define SGP41_MEASURE_MAX_MS 50
+#define SGP41_CONDITIONING_DURATION_MS 10000 // Conditioning phase after power-up
+
+enum Sgp41Status
+{
+  SGP41_OK,
+  SGP41_BUSY,      // Conversion still running, poll again later
+  SGP41_I2C_ERROR, // No ACK or short read
+  SGP41_CRC_ERROR, // Data corrupted on the bus
+  SGP41_IDLE,      // No command pending
+};
+
+class SGP41
+{
+public:
+  SGP41(TwoWire &wire, uint8_t address = SGP41_DEFAULT_ADDRESS);
+
+  // Read the serial number to check the sensor is there and talking CRC-valid data
+  bool begin();
+
+  // Start a conditioning cycle (first 10 s after power-up only, VOC output only)
+  bool startConditioning(float humidity, float temperature);
+
+  // Start a raw VOC + NOx measurement compensated for the given RH (%) and T (°C)
+  bool startMeasurement(float humidity, float temperature);
+
+  // Poll for the result of the last start*() call. NOx is 0 after conditioning.
+  Sgp41Status readResult(uint16_t &srawVoc, uint16_t &srawNox);
+
+  bool turnHeaterOff();
+
+  uint64_t serialNumber() const { return serial; }
+  uint32_t crcErrorCount() const { return crcErrors; }
+
+  // Compensation words as defined in the datasheet
+  static uint16_t humidityTicks(float humidity);
+  static uint16_t temperatureTicks(float temperature);
+
+private:
+  bool sendCommand(uint16_t command, const uint16_t *args, uint8_t argCount);
+  Sgp41Status readWords(uint16_t *words, uint8_t count);
+
+  TwoWire &wire;
+  uint8_t address;
+  uint64_t serial;
+  uint32_t crcErrors;
+
+  // Pending command state
+  uint8_t pendingWords;   // Words expected back (0 = nothing pending)
+  unsigned long startTime; // millis() when the command was sent
+};
@@ -0,0 +1,123 @@
+#include "SHTxx.h"
+#include "SensirionCrc.h"
+
+// Worst-case conversion times (ms), indexed by ShtRepeatability
+static const uint8_t sht4xConversionMs[] = {2, 5, 9};
+static const uint8_t sht3xConversionMs[] = {5, 7, 16};
+
+SHTxx::SHTxx(TwoWire &wire, ShtModel model, uint8_t address)
+    : wire(wire), type(model), address(address), serial(0), crcErrors(0), pending(false), pendingTime(0),
+      startTime(0)
+{
+}
+
+bool SHTxx::begin()
+{
+  if (!sendCommand(type == SHT_MODEL_4X ? SHT4X_CMD_READ_SERIAL : SHT3X_CMD_READ_SERIAL))
+    return false;
+
+  delay(1);
+
+  uint16_t words[2];
+  if (readWords(words, 2) != SHT_OK)
+    return false;
+
+  serial = ((uint32_t)words[0] << 16) | words[1];
+  return true;
+}
+
+uint8_t SHTxx::conversionTime(ShtRepeatability repeatability) const
+{
+  return type == SHT_MODEL_4X ? sht4xConversionMs[repeatability] : sht3xConversionMs[repeatability];
+}
+
+bool SHTxx::startMeasurement(ShtRepeatability repeatability)
+{
+  uint16_t command;
+  if (type == SHT_MODEL_4X)
+  {
+    const uint16_t commands[] = {SHT4X_CMD_MEASURE_LOW, SHT4X_CMD_MEASURE_MEDIUM, SHT4X_CMD_MEASURE_HIGH};
+    command = commands[repeatability];
+  }
+  else
+  {
+    const uint16_t commands[] = {SHT3X_CMD_MEASURE_LOW, SHT3X_CMD_MEASURE_MEDIUM, SHT3X_CMD_MEASURE_HIGH};
+    command = commands[repeatability];
+  }
+
+  if (!sendCommand(command))
+    return false;
+
+  pending = true;
+  pendingTime = conversionTime(repeatability);
+  startTime = millis();
+  return true;
+}
+
+ShtStatus SHTxx::readResult(float &temperature, float &humidity)
+{
+  if (!pending)
+    return SHT_IDLE;
+
+  unsigned long elapsed = millis() - startTime;
+  if (elapsed < pendingTime)
+    return SHT_BUSY;
+
+  uint16_t words[2] = {0, 0};
+  ShtStatus status = readWords(words, 2);
+
+  // Still converting (slow part or clock drift): allow twice the datasheet time
+  if (status == SHT_I2C_ERROR && elapsed < 2UL * pendingTime)
+    return SHT_BUSY;
+
+  pending = false;
+  if (status != SHT_OK)
+    return status;
+
+  // Datasheet conversion formulas
+  temperature = -45.0f + 175.0f * words[0] / 65535.0f;
+  if (type == SHT_MODEL_4X)
+    humidity = -6.0f + 125.0f * words[1] / 65535.0f; // Can leave 0-100 % at the extremes
+  else
+    humidity = 100.0f * words[1] / 65535.0f;
+
+  if (humidity < 0.0f)
+    humidity = 0.0f;
+  if (humidity > 100.0f)
+    humidity = 100.0f;
+  return SHT_OK;
+}
+
+bool SHTxx::sendCommand(uint16_t command)
+{
+  wire.beginTransmission(address);
+  if (type == SHT_MODEL_3X)
+    wire.write((uint8_t)(command >> 8));
+  wire.write((uint8_t)(command & 0xFF));
+  return wire.endTransmission() == 0;
+}
+
+ShtStatus SHTxx::readWords(uint16_t *words, uint8_t count)
+{
+  uint8_t length = count * 3; // Each word is followed by its CRC
+  if (wire.requestFrom(address, length) != length)
+    return SHT_I2C_ERROR;
+
+  ShtStatus status = SHT_OK;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uint8_t word[2];
+    word[0] = wire.read();
+    word[1] = wire.read();
+    uint8_t crc = wire.read();
+
+    if (sensirionCrc8(word, 2) != crc)
+    {
+      crcErrors++;
+      status = SHT_CRC_ERROR;
+    }
+    words[i] = ((uint16_t)word[0] << 8) | word[1];
+  }
+
+  return status;
+}
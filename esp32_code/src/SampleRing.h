@@ -0,0 +1,148 @@
+/*
+ * Lock-free single-producer / single-consumer sample ring
+ *
+ * Fixed capacity, no heap, no locks. The sensor task pushes, the uplink task
+ * pops. Head, tail and the producer-only state each sit on their own cache
+ * line so the two cores don't keep invalidating each other's counters.
+ *
+ * Overflow policies:
+ * - RING_DROP_OLDEST: a full ring discards its oldest sample to make room
+ * - RING_DECIMATE:    as the ring fills up only every 2nd (half full) or 4th
+ *                     (3/4 full) sample is kept, so a backlog still covers the
+ *                     whole outage at lower resolution; a full ring drops new samples
+ *
+ * pop() claims the oldest slot (CAS on the tail) before copying it and
+ * announces the slot it is copying, so the producer never writes into a slot
+ * that is being read: a push that would land there while the copy is running
+ * (the ring wrapped all the way round in the meantime) is dropped instead.
+ *
+ * T must be trivially copyable (plain struct).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SAMPLE_RING_CACHE_LINE
+#if defined(ESP32)
+#define SAMPLE_RING_CACHE_LINE 32 // Xtensa LX6 cache line
+#else
+#define SAMPLE_RING_CACHE_LINE 64
+#endif
+#endif
+
+enum RingOverflowPolicy
+{
+  RING_DROP_OLDEST,
+  RING_DECIMATE,
+};
+
+template <typename T, size_t CAPACITY>
+class SampleRing
+{
+  static_assert(CAPACITY >= 4 && (CAPACITY & (CAPACITY - 1)) == 0, "SampleRing capacity must be a power of two");
+
+public:
+  explicit SampleRing(RingOverflowPolicy policy = RING_DROP_OLDEST)
+      : head(0), tail(0), reading(0), policy(policy), decimateCounter(0), droppedCount(0)
+  {
+  }
+
+  // Producer only. Returns false if the sample was discarded by the overflow policy.
+  bool push(const T &item)
+  {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    uint32_t fill = h - t;
+    bool claimed = false;
+
+    if (policy == RING_DECIMATE)
+    {
+      uint32_t factor = 1;
+      if (fill >= CAPACITY * 3 / 4)
+        factor = 4;
+      else if (fill >= CAPACITY / 2)
+        factor = 2;
+
+      if (fill >= CAPACITY || (decimateCounter++ % factor) != 0)
+      {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    else if (fill >= CAPACITY)
+    {
+      // Claim the oldest slot. If the consumer popped it first the CAS fails,
+      // which is fine: a slot was freed either way.
+      if (tail.compare_exchange_strong(t, t + 1, std::memory_order_acq_rel))
+      {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        claimed = true; // The consumer can't be copying that slot any more
+      }
+    }
+
+    // The slot's previous sample may still be being copied by a pop() that
+    // claimed it: keep that copy intact and lose this sample instead
+    if (!claimed && reading.load(std::memory_order_acquire) == ((h & MASK) | READING_BUSY))
+    {
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    slots[h & MASK] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Returns false if the ring is empty.
+  bool pop(T &item)
+  {
+    uint32_t t = tail.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+      if (t == head.load(std::memory_order_acquire))
+        return false;
+
+      // Announce the slot, then claim it; if the producer dropped it first
+      // the CAS fails and t is reloaded
+      reading.store((t & MASK) | READING_BUSY, std::memory_order_relaxed);
+      if (tail.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel))
+        break;
+    }
+
+    item = slots[t & MASK];
+    reading.store(0, std::memory_order_release);
+    return true;
+  }
+
+  // Number of samples waiting (approximate while the other side is active)
+  size_t size() const
+  {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  size_t capacity() const { return CAPACITY; }
+
+  // Samples discarded by the overflow policy since start-up
+  uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+  static const uint32_t MASK = CAPACITY - 1;
+  static const uint32_t READING_BUSY = 0x80000000;
+
+  alignas(SAMPLE_RING_CACHE_LINE) std::atomic<uint32_t> head; // Written by the producer
+  alignas(SAMPLE_RING_CACHE_LINE) std::atomic<uint32_t> tail; // Written by the consumer (and the producer when dropping)
+  std::atomic<uint32_t> reading; // Slot the consumer is copying | READING_BUSY, 0 if none
+
+  // Producer-only state
+  alignas(SAMPLE_RING_CACHE_LINE) const RingOverflowPolicy policy;
+  uint32_t decimateCounter;
+  std::atomic<uint32_t> droppedCount;
+
+  alignas(SAMPLE_RING_CACHE_LINE) T slots[CAPACITY];
+};
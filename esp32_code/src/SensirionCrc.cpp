@@ -0,0 +1,18 @@
+#include "SensirionCrc.h"
+
+uint8_t sensirionCrc8(const uint8_t *data, size_t len)
+{
+  uint8_t crc = 0xFF;
+  for (size_t i = 0; i < len; i++)
+  {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      if (crc & 0x80)
+        crc = (crc << 1) ^ 0x31;
+      else
+        crc = crc << 1;
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,13 @@
+/*
+ * Sensirion CRC-8 shared by the SGP41 and SHT4x/SHT3x drivers
+ *
+ * Every 16-bit word these sensors send or accept is followed by a CRC-8
+ * (polynomial 0x31, init 0xFF, no final XOR) over its two bytes.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint8_t sensirionCrc8(const uint8_t *data, size_t len);
@@ -0,0 +1,313 @@
+#include "SimHal.h"
+
+#include <math.h>
+#include <string.h>
+#include <ArduinoJson.h>
+#include "Telemetry.h"
+
+#define SIM_VOC_RAW_CENTRE 30000 // Typical SGP41 raw ticks in clean air
+#define SIM_NOX_RAW_CENTRE 16000
+
+uint32_t SimRandom::next()
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+float SimRandom::uniform()
+{
+  return (next() >> 8) * (1.0f / 16777216.0f);
+}
+
+float SimRandom::symmetric(float amplitude)
+{
+  return (uniform() * 2.0f - 1.0f) * amplitude;
+}
+
+SimClimateSensor::SimClimateSensor(uint32_t seed)
+    : random(seed)
+{
+  temperature = 20.0;
+  humidity = 50.0;
+  temperatureNoise = 0;
+  humidityNoise = 0;
+  resolution = 0.1;
+  failureRate = 0;
+  readCount = 0;
+  failureCount = 0;
+  pending = false;
+  pendingOk = false;
+  pendingTemperature = NAN;
+  pendingHumidity = NAN;
+}
+
+void SimClimateSensor::set(float t, float h)
+{
+  temperature = t;
+  humidity = h;
+}
+
+void SimClimateSensor::setNoise(float t, float h)
+{
+  temperatureNoise = t;
+  humidityNoise = h;
+}
+
+void SimClimateSensor::setResolution(float step)
+{
+  resolution = step;
+}
+
+void SimClimateSensor::setFailureRate(float rate)
+{
+  failureRate = rate;
+}
+
+bool SimClimateSensor::start()
+{
+  pendingOk = read(pendingTemperature, pendingHumidity);
+  pending = true;
+  return true;
+}
+
+ClimateStatus SimClimateSensor::poll(float &t, float &h)
+{
+  if (!pending)
+    return CLIMATE_FAILED;
+
+  pending = false;
+  t = pendingTemperature;
+  h = pendingHumidity;
+  return pendingOk ? CLIMATE_OK : CLIMATE_FAILED;
+}
+
+bool SimClimateSensor::read(float &t, float &h)
+{
+  readCount++;
+  if (failureRate > 0 && random.uniform() < failureRate)
+  {
+    // Like the DHT library: NAN on a timeout or checksum error
+    failureCount++;
+    t = NAN;
+    h = NAN;
+    return false;
+  }
+
+  t = temperature + random.symmetric(temperatureNoise);
+  h = humidity + random.symmetric(humidityNoise);
+  if (resolution > 0)
+  {
+    t = roundf(t / resolution) * resolution;
+    h = roundf(h / resolution) * resolution;
+  }
+  if (h > 100)
+    h = 100;
+  if (h < 0)
+    h = 0;
+  return true;
+}
+
+SimGasSensor::SimGasSensor(Clock &clock, uint32_t seed)
+    : clock(clock), random(seed)
+{
+  pending = false;
+  conditioning = false;
+  readyAt = 0;
+  vocWalk = 0;
+  noxWalk = 0;
+  vocOffset = 0;
+  crcErrorRate = 0;
+  conversionCount = 0;
+}
+
+bool SimGasSensor::start(bool conditioningOnly)
+{
+  pending = true;
+  conditioning = conditioningOnly;
+  readyAt = clock.millis() + SIM_GAS_CONVERSION_MS;
+  return true;
+}
+
+bool SimGasSensor::startConditioning(float humidity, float temperature)
+{
+  return start(true);
+}
+
+bool SimGasSensor::startMeasurement(float humidity, float temperature)
+{
+  return start(false);
+}
+
+GasStatus SimGasSensor::readResult(uint16_t &srawVoc, uint16_t &srawNox)
+{
+  if (!pending)
+    return GAS_IDLE;
+  if ((int32_t)(clock.millis() - readyAt) < 0)
+    return GAS_BUSY;
+  pending = false;
+  conversionCount++;
+
+  if (crcErrorRate > 0 && random.uniform() < crcErrorRate)
+    return GAS_CRC_ERROR;
+
+  // Mean-reverting random walk around the clean-air signal
+  vocWalk += random.symmetric(40) - vocWalk * 0.01f;
+  noxWalk += random.symmetric(10) - noxWalk * 0.01f;
+
+  int32_t voc = SIM_VOC_RAW_CENTRE - vocOffset + (int32_t)vocWalk;
+  srawVoc = (uint16_t)(voc < 0 ? 0 : voc > 65535 ? 65535 : voc);
+  srawNox = conditioning ? 0 : (uint16_t)(SIM_NOX_RAW_CENTRE + (int32_t)noxWalk); // No NOx while conditioning
+  return GAS_OK;
+}
+
+SimRelays::SimRelays(Clock &clock)
+    : clock(clock)
+{
+  for (uint8_t channel = 0; channel < RELAY_CHANNELS; channel++)
+  {
+    state[channel] = false;
+    cycles[channel] = 0;
+    onSince[channel] = 0;
+    onTotal[channel] = 0;
+  }
+}
+
+void SimRelays::set(uint8_t channel, bool on)
+{
+  if (channel >= RELAY_CHANNELS || state[channel] == on)
+    return;
+
+  uint32_t now = clock.millis();
+  if (on)
+  {
+    cycles[channel]++;
+    onSince[channel] = now;
+  }
+  else
+  {
+    onTotal[channel] += now - onSince[channel];
+  }
+  state[channel] = on;
+}
+
+uint64_t SimRelays::onTimeMs(uint8_t channel)
+{
+  if (channel >= RELAY_CHANNELS)
+    return 0;
+  return onTotal[channel] + (state[channel] ? clock.millis() - onSince[channel] : 0);
+}
+
+void SimDisplay::showReadings(const DisplayState &state)
+{
+  frameCount++;
+  lastState = state;
+}
+
+void SimDisplay::showSensorError(int attempts)
+{
+  frameCount++;
+  errorCount++;
+}
+
+SimHttpTransport::SimHttpTransport(const Thresholds &thresholds, uint32_t seed)
+    : random(seed), limits(thresholds)
+{
+  version = 1;
+  failureRate = 0;
+  msgpackSupported = true;
+  lastType = "";
+  requestCount = 0;
+  sampleCount = 0;
+  ackSeq = 0;
+  byteCount = 0;
+  largest = 0;
+}
+
+void SimHttpTransport::setThresholds(const Thresholds &thresholds)
+{
+  limits = thresholds;
+  version++;
+}
+
+int SimHttpTransport::request(const char *method, const char *url, const char *contentType, const char *accept,
+                              const uint8_t *body, size_t length,
+                              uint8_t *response, size_t responseSize, size_t &responseLength)
+{
+  requestCount++;
+  responseLength = 0;
+  lastType = "";
+
+  if (failureRate > 0 && random.uniform() < failureRate)
+    return -1; // Like HTTPC_ERROR_CONNECTION_REFUSED
+
+  if (strcmp(method, "POST") == 0 && strstr(url, "/api/metrics") != NULL)
+    return answerBatch(contentType, body, length, response, responseSize, responseLength);
+  if (strcmp(method, "GET") == 0 && strstr(url, "/api/thresholds") != NULL)
+    return answerThresholds(accept, response, responseSize, responseLength);
+  return 404;
+}
+
+// server.js bookkeeping, minus the out-of-order set: count the samples, advance the contiguous ack
+int SimHttpTransport::answerBatch(const char *contentType, const uint8_t *body, size_t length,
+                                  uint8_t *response, size_t responseSize, size_t &responseLength)
+{
+  byteCount += length;
+  if (length > largest)
+    largest = length;
+
+  DynamicJsonDocument doc(length * 16 + 1024); // Probe arrays: 1-byte MessagePack ints take a whole slot each
+  bool msgpack = contentType != NULL && strcmp(contentType, MSGPACK_CONTENT_TYPE) == 0;
+  if (msgpack && !msgpackSupported)
+    return 415;
+  DeserializationError error = msgpack ? deserializeMsgPack(doc, (const char *)body, length)
+                                       : deserializeJson(doc, (const char *)body, length);
+  if (error)
+    return 400;
+
+  uint32_t base = doc["base"] | 0;
+  if (base > ackSeq + 1)
+    ackSeq = base - 1; // Older samples were overwritten on the device: don't wait for them
+
+  JsonArray samples = doc["samples"];
+  for (JsonObject sample : samples)
+  {
+    uint32_t seq = sample["seq"] | 0;
+    if (seq == ackSeq + 1)
+      ackSeq = seq;
+    sampleCount++;
+  }
+
+  StaticJsonDocument<64> answer;
+  answer["ack"] = ackSeq;
+  answer["thresholds"] = version;
+  responseLength = serializeJson(answer, (char *)response, responseSize);
+  lastType = JSON_CONTENT_TYPE;
+  return 200;
+}
+
+int SimHttpTransport::answerThresholds(const char *accept, uint8_t *response, size_t responseSize,
+                                       size_t &responseLength)
+{
+  StaticJsonDocument<256> doc;
+  doc["temperature"]["min"] = limits.tempMin;
+  doc["temperature"]["max"] = limits.tempMax;
+  doc["temperature"]["optimal"] = limits.tempSetpoint;
+  doc["humidity"]["min"] = limits.humidityMin;
+  doc["humidity"]["max"] = limits.humidityMax;
+  doc["voc"] = limits.vocThreshold;
+  doc["version"] = version;
+
+  if (accept != NULL && strstr(accept, MSGPACK_CONTENT_TYPE) != NULL)
+  {
+    responseLength = serializeMsgPack(doc, response, responseSize);
+    lastType = MSGPACK_CONTENT_TYPE;
+  }
+  else
+  {
+    responseLength = serializeJson(doc, (char *)response, responseSize);
+    lastType = JSON_CONTENT_TYPE;
+  }
+  return 200;
+}
@@ -0,0 +1,194 @@
+/*
+ * Simulated implementations of the Hal.h interfaces (env:native)
+ *
+ * - SimClock:          virtual time, only moves when advance() is called
+ * - SimClimateSensor:  returns the temperature/humidity set by the caller,
+ *                      quantized, with optional noise and read failures;
+ *                      a split-phase read is ready at the first poll()
+ * - SimGasSensor:      SGP41 timing (conversion busy for SIM_GAS_CONVERSION_MS)
+ *                      and random-walk raw VOC/NOx ticks
+ * - SimRelays:         channel states, switch-on counts and on-time
+ * - SimDisplay:        counts frames, keeps the last one
+ * - SimHttpTransport:  in-process stand-in for the backend: decodes batch
+ *                      POSTs, answers with "ack"/"thresholds" and serves
+ *                      /api/thresholds
+ *
+ * Randomness comes from a seeded generator, so a run is reproducible.
+ */
+
+#pragma once
+
+#include "Hal.h"
+#include "ClimateControl.h"
+
+#define SIM_GAS_CONVERSION_MS 50 // SGP41 measurement duration
+
+// Small deterministic generator (xorshift32) shared by the simulated sensors
+class SimRandom
+{
+public:
+  explicit SimRandom(uint32_t seed) : state(seed != 0 ? seed : 1) {}
+  uint32_t next();
+  float uniform();                   // [0, 1)
+  float symmetric(float amplitude);  // [-amplitude, amplitude)
+
+private:
+  uint32_t state;
+};
+
+class SimClock : public Clock
+{
+public:
+  SimClock() : elapsedUs(0), epoch(0) {}
+  uint32_t millis() override { return (uint32_t)(elapsedUs / 1000); }
+  uint32_t micros() override { return (uint32_t)elapsedUs; }
+  uint32_t unixTime() override { return epoch != 0 ? epoch + (uint32_t)(elapsedUs / 1000000) : 0; }
+
+  void advance(uint32_t ms) { elapsedUs += (uint64_t)ms * 1000; }
+  void setEpoch(uint32_t unixTimeAtStart) { epoch = unixTimeAtStart; } // 0 = not synced
+
+private:
+  uint64_t elapsedUs;
+  uint32_t epoch;
+};
+
+class SimClimateSensor : public ClimateSensor
+{
+public:
+  explicit SimClimateSensor(uint32_t seed = 1);
+  bool begin() override { return true; }
+  bool read(float &temperature, float &humidity) override;
+  bool start() override;
+  ClimateStatus poll(float &temperature, float &humidity) override;
+
+  void set(float temperature, float humidity);
+  void setNoise(float temperatureNoise, float humidityNoise); // Peak amplitude (°C, %)
+  void setResolution(float step);                             // Reading quantization (DHT22: 0.1)
+  void setFailureRate(float rate);                            // Share of reads that fail (0-1)
+
+  uint32_t reads() const { return readCount; }
+  uint32_t failures() const { return failureCount; }
+
+private:
+  SimRandom random;
+  float temperature;
+  float humidity;
+  float temperatureNoise;
+  float humidityNoise;
+  float resolution;
+  float failureRate;
+  uint32_t readCount;
+  uint32_t failureCount;
+
+  // Split-phase read taken at start()
+  bool pending;
+  bool pendingOk;
+  float pendingTemperature;
+  float pendingHumidity;
+};
+
+class SimGasSensor : public GasSensor
+{
+public:
+  SimGasSensor(Clock &clock, uint32_t seed = 1);
+  bool begin() override { return true; }
+  bool startConditioning(float humidity, float temperature) override;
+  bool startMeasurement(float humidity, float temperature) override;
+  GasStatus readResult(uint16_t &srawVoc, uint16_t &srawNox) override;
+  uint64_t serialNumber() const override { return 0x53494D000041ULL; }
+
+  // Raw VOC ticks drop as VOC rises; shift the random walk's centre (ticks)
+  void setVocOffset(int32_t ticks) { vocOffset = ticks; }
+  void setCrcErrorRate(float rate) { crcErrorRate = rate; }
+
+  uint32_t conversions() const { return conversionCount; }
+
+private:
+  bool start(bool conditioning);
+
+  Clock &clock;
+  SimRandom random;
+  bool pending;
+  bool conditioning;
+  uint32_t readyAt;
+  float vocWalk;
+  float noxWalk;
+  int32_t vocOffset;
+  float crcErrorRate;
+  uint32_t conversionCount;
+};
+
+class SimRelays : public RelayBank
+{
+public:
+  explicit SimRelays(Clock &clock);
+  void set(uint8_t channel, bool on) override;
+
+  bool isOn(uint8_t channel) const { return channel < RELAY_CHANNELS && state[channel]; }
+  uint32_t switchOns(uint8_t channel) const { return channel < RELAY_CHANNELS ? cycles[channel] : 0; }
+  uint64_t onTimeMs(uint8_t channel); // Including the current on period
+
+private:
+  Clock &clock;
+  bool state[RELAY_CHANNELS];
+  uint32_t cycles[RELAY_CHANNELS];
+  uint32_t onSince[RELAY_CHANNELS];
+  uint64_t onTotal[RELAY_CHANNELS];
+};
+
+class SimDisplay : public StatusDisplay
+{
+public:
+  SimDisplay() : frameCount(0), errorCount(0), lastState() {}
+  bool begin() override { return true; }
+  void showReadings(const DisplayState &state) override;
+  void showSensorError(int attempts) override;
+
+  uint32_t frames() const { return frameCount; }
+  uint32_t errorFrames() const { return errorCount; }
+  const DisplayState &last() const { return lastState; }
+
+private:
+  uint32_t frameCount;
+  uint32_t errorCount;
+  DisplayState lastState;
+};
+
+class SimHttpTransport : public HttpTransport
+{
+public:
+  SimHttpTransport(const Thresholds &thresholds, uint32_t seed = 1);
+
+  int request(const char *method, const char *url, const char *contentType, const char *accept,
+              const uint8_t *body, size_t length,
+              uint8_t *response, size_t responseSize, size_t &responseLength) override;
+  const char *responseType() const override { return lastType; }
+
+  // Server-side changes: new thresholds and version bump (like a detection)
+  void setThresholds(const Thresholds &thresholds);
+  void setFailureRate(float rate) { failureRate = rate; } // Share of requests with no response
+  void setMsgPackSupport(bool supported) { msgpackSupported = supported; } // false: 415 for MessagePack bodies
+
+  uint32_t requests() const { return requestCount; }
+  uint32_t samplesReceived() const { return sampleCount; }
+  uint32_t acked() const { return ackSeq; }
+  size_t bytesReceived() const { return byteCount; }
+  size_t largestBody() const { return largest; }
+
+private:
+  int answerBatch(const char *contentType, const uint8_t *body, size_t length,
+                  uint8_t *response, size_t responseSize, size_t &responseLength);
+  int answerThresholds(const char *accept, uint8_t *response, size_t responseSize, size_t &responseLength);
+
+  SimRandom random;
+  Thresholds limits;
+  uint32_t version;
+  float failureRate;
+  bool msgpackSupported;
+  const char *lastType;
+  uint32_t requestCount;
+  uint32_t sampleCount;
+  uint32_t ackSeq; // Highest contiguous sequence number received
+  size_t byteCount;
+  size_t largest;
+};
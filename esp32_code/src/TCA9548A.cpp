@@ -0,0 +1,36 @@
+#include "TCA9548A.h"
+
+TCA9548A::TCA9548A(TwoWire &wire, uint8_t address)
+    : wire(wire), address(address), current(TCA9548A_NONE)
+{
+}
+
+bool TCA9548A::begin()
+{
+  current = TCA9548A_NONE;
+  return write(0);
+}
+
+bool TCA9548A::select(uint8_t channel)
+{
+  if (channel >= TCA9548A_CHANNELS)
+    return false;
+  if (channel == current)
+    return true;
+
+  if (!write(1 << channel))
+  {
+    current = TCA9548A_NONE; // State unknown: write it again next time
+    return false;
+  }
+  current = channel;
+  return true;
+}
+
+// The control register is the only one: a single byte, bit n = channel n connected
+bool TCA9548A::write(uint8_t mask)
+{
+  wire.beginTransmission(address);
+  wire.write(mask);
+  return wire.endTransmission() == 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * TI TCA9548A 8-channel I2C multiplexer driver
+ *
+ * Lets several SHT4x/SHT3x probes with the same address share the bus: each
+ * sits on its own downstream channel, and select() connects one of them
+ * before it is addressed. Devices on the upstream bus (SGP41, OLED) stay
+ * reachable whatever the selection. The selected channel is cached, so
+ * talking to the same probe again costs no extra transaction.
+ *
+ * Not locked: callers hold the I2C bus mutex across select() and the
+ * transaction that follows.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define TCA9548A_DEFAULT_ADDRESS 0x70 // A0-A2 low (0x70-0x77)
+#define TCA9548A_CHANNELS 8
+#define TCA9548A_NONE 0xFF
+
+class TCA9548A
+{
+public:
+  TCA9548A(TwoWire &wire, uint8_t address = TCA9548A_DEFAULT_ADDRESS);
+
+  // Disconnect every channel; false if the mux doesn't answer
+  bool begin();
+
+  // Connect one downstream channel (and only that one)
+  bool select(uint8_t channel);
+
+  uint8_t selected() const { return current; }
+
+private:
+  bool write(uint8_t mask);
+
+  TwoWire &wire;
+  uint8_t address;
+  uint8_t current; // TCA9548A_NONE: unknown or nothing selected
+};
@@ -0,0 +1,126 @@
+#include "Telemetry.h"
+
+#include <ArduinoJson.h>
+
+// Room aggregate plus the per-probe values in tenths (small integers: 1-3 bytes each in MessagePack)
+static void encodeProbes(const SensorSample &sample, JsonObject item)
+{
+  item["temperature"]["min"] = sample.temperatureMin;
+  item["temperature"]["max"] = sample.temperatureMax;
+  item["temperature"]["gradient"] = sample.temperatureGradient;
+  item["humidity"]["min"] = sample.humidityMin;
+  item["humidity"]["max"] = sample.humidityMax;
+
+  JsonObject probes = item.createNestedObject("probes");
+  JsonArray temperatures = probes.createNestedArray("t");
+  JsonArray humidities = probes.createNestedArray("h");
+  for (uint8_t p = 0; p < sample.probeCount && p < CLIMATE_PROBES_MAX; p++)
+  {
+    if (sample.probeValid & (1 << p))
+    {
+      temperatures.add(sample.probeTemperature[p]);
+      humidities.add(sample.probeHumidity[p]);
+    }
+    else
+    {
+      temperatures.add(nullptr);
+      humidities.add(nullptr);
+    }
+  }
+}
+
+size_t encodeBatch(const BatchHeader &header, const SensorSample *samples, uint8_t count, bool msgpack,
+                   uint8_t *out, size_t size)
+{
+  // Heap: a full batch is several KB
+  const size_t sampleSize = JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(3) + 3 * JSON_OBJECT_SIZE(2) +
+                            2 * JSON_ARRAY_SIZE(CLIMATE_PROBES_MAX);
+  DynamicJsonDocument doc(JSON_OBJECT_SIZE(6) + JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(count) + count * sampleSize);
+
+  doc["now"] = header.now; // Lets the server turn sample timestamps into wall-clock time
+  doc["stream"] = header.stream;
+  doc["base"] = header.base;
+  doc["replay"] = header.replay;
+  doc["spool"]["depth"] = header.spoolDepth;
+  doc["spool"]["overwritten"] = header.spoolOverwritten;
+  doc["spool"]["replayed"] = header.replayed;
+  JsonArray array = doc.createNestedArray("samples");
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    JsonObject item = array.createNestedObject();
+    item["seq"] = samples[i].seq;
+    if (samples[i].time != 0)
+      item["time"] = samples[i].time;
+    item["timestamp"] = samples[i].timestamp;
+    item["temperature"]["value"] = samples[i].temperature;
+    item["humidity"]["value"] = samples[i].humidity;
+    if (samples[i].probeCount > 1)
+      encodeProbes(samples[i], item);
+    item["vocs"]["value"] = samples[i].vocIndex; // VOC index value (also used for ethylene monitoring)
+    item["vocs"]["raw"] = samples[i].vocRaw;
+    item["nox"]["value"] = samples[i].noxIndex;  // NOx index value
+    item["nox"]["raw"] = samples[i].noxRaw;
+  }
+
+  if (doc.overflowed())
+    return 0;
+
+  // The serializers silently truncate to the buffer: check the full length first
+  if (msgpack)
+    return measureMsgPack(doc) <= size ? serializeMsgPack(doc, out, size) : 0;
+  return measureJson(doc) < size ? serializeJson(doc, (char *)out, size) : 0; // Plus the terminator
+}
+
+bool decodeAck(const uint8_t *response, size_t length, UplinkAck &ack)
+{
+  StaticJsonDocument<192> doc;
+  ack.hasAck = false;
+  ack.hasThresholdsVersion = false;
+  if (deserializeJson(doc, (const char *)response, length))
+    return false;
+
+  if (doc.containsKey("ack"))
+  {
+    ack.hasAck = true;
+    ack.ack = doc["ack"];
+  }
+  if (doc.containsKey("thresholds"))
+  {
+    ack.hasThresholdsVersion = true;
+    ack.thresholdsVersion = doc["thresholds"];
+  }
+  return true;
+}
+
+bool decodeThresholds(const uint8_t *response, size_t length, bool msgpack, Thresholds &thresholds)
+{
+  StaticJsonDocument<256> doc;
+  DeserializationError error;
+  if (msgpack)
+    error = deserializeMsgPack(doc, (const char *)response, length);
+  else
+    error = deserializeJson(doc, (const char *)response, length);
+  if (error)
+    return false;
+
+  // Temperature thresholds
+  if (doc.containsKey("temperature"))
+  {
+    thresholds.tempMin = doc["temperature"]["min"];
+    thresholds.tempMax = doc["temperature"]["max"];
+    thresholds.tempSetpoint = doc["temperature"]["optimal"] | (thresholds.tempMin + thresholds.tempMax) / 2;
+  }
+
+  // Humidity thresholds
+  if (doc.containsKey("humidity"))
+  {
+    thresholds.humidityMin = doc["humidity"]["min"];
+    thresholds.humidityMax = doc["humidity"]["max"];
+  }
+
+  // VOC threshold
+  if (doc.containsKey("voc"))
+    thresholds.vocThreshold = doc["voc"];
+  return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * Telemetry samples and their encoding for the backend
+ *
+ * Batch payload (JSON or MessagePack, same structure):
+ *   {"now": millis(), "stream", "base", "replay", "spool": {depth, overwritten, replayed},
+ *    "samples": [{seq, time, timestamp, temperature, humidity, vocs, nox}, ...]}
+ * With several climate probes, "temperature" also carries min/max/gradient
+ * (°C per m of height), "humidity" min/max, and "probes" the per-probe values
+ * as compact integer arrays: {"t": [0.1 °C, ...], "h": [0.1 %, ...]}, null
+ * for a probe left out of the aggregate.
+ * The /api/metrics answer carries the highest contiguous sequence number the
+ * server holds ("ack") and the version of its thresholds ("thresholds").
+ *
+ * Pure logic on top of ArduinoJson, which builds on the host as well.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ClimateControl.h"
+#include "Hal.h"
+
+#define MSGPACK_CONTENT_TYPE "application/msgpack"
+#define JSON_CONTENT_TYPE "application/json"
+
+// One sensor sample handed from the sensor task to the other tasks
+struct SensorSample
+{
+  uint32_t seq;       // Spool sequence number, assigned by the uplink task
+  uint32_t time;      // Unix time when the sample was taken (0 before NTP sync)
+  uint32_t timestamp; // millis() when the sample was taken
+  float temperature;  // Mean over the room's healthy probes
+  float humidity;
+  float temperatureMin; // Coldest / warmest probe
+  float temperatureMax;
+  float temperatureGradient; // Vertical, °C per m (0 without probes at different heights)
+  float humidityMin;
+  float humidityMax;
+  uint8_t probeCount;
+  uint8_t probeValid; // Bit per probe: included in the aggregate
+  int16_t probeTemperature[CLIMATE_PROBES_MAX]; // 0.1 °C
+  int16_t probeHumidity[CLIMATE_PROBES_MAX];    // 0.1 %
+  uint16_t vocRaw;
+  float vocIndex;
+  uint16_t noxRaw;
+  float noxIndex;
+};
+
+// Everything in a batch besides the samples
+struct BatchHeader
+{
+  uint32_t now;    // millis() when the batch is sent
+  uint32_t stream; // Spool identity
+  uint32_t base;   // Oldest sample still held
+  bool replay;
+  uint32_t spoolDepth;
+  uint32_t spoolOverwritten;
+  uint32_t replayed;
+};
+
+struct UplinkAck
+{
+  bool hasAck;
+  uint32_t ack;               // Highest contiguous sequence number on the server
+  bool hasThresholdsVersion;
+  uint32_t thresholdsVersion; // Changes whenever the server's thresholds do
+};
+
+// Encode a batch into out; returns the encoded length, 0 if the batch doesn't fit
+// in out (nothing usable is written then)
+size_t encodeBatch(const BatchHeader &header, const SensorSample *samples, uint8_t count, bool msgpack,
+                   uint8_t *out, size_t size);
+
+// Parse the JSON answer to a batch POST
+bool decodeAck(const uint8_t *response, size_t length, UplinkAck &ack);
+
+// Parse /api/thresholds (JSON or MessagePack); fields missing from the answer keep their value
+bool decodeThresholds(const uint8_t *response, size_t length, bool msgpack, Thresholds &thresholds);
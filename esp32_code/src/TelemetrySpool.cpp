@@ -0,0 +1,299 @@
+#include "TelemetrySpool.h"
+
+#define SPOOL_ACK_PATH TELEMETRY_SPOOL_DIR "/ack"
+#define SPOOL_MAGIC 0x31505354 // "TSP1"
+
+// Persisted next to the segments, rewritten on every acknowledgement
+struct SpoolAckFile
+{
+  uint32_t magic;
+  uint32_t recordSize;
+  uint32_t stream;
+  uint32_t acked;
+};
+
+TelemetrySpool::TelemetrySpool(fs::FS &fs, size_t recordSize)
+    : fs(fs), recordSize(recordSize), isReady(false), stream(0), headSeq(0), acked(0),
+      firstSegment(0), overwrittenCount(0)
+{
+}
+
+bool TelemetrySpool::begin()
+{
+  isReady = false;
+  if (recordSize > TELEMETRY_SPOOL_MAX_RECORD)
+    return false;
+
+  if (!fs.exists(TELEMETRY_SPOOL_DIR) && !fs.mkdir(TELEMETRY_SPOOL_DIR))
+    return false;
+
+  SpoolAckFile ackFile;
+  File file = fs.open(SPOOL_ACK_PATH, "r");
+  bool haveAck = file && file.read((uint8_t *)&ackFile, sizeof(ackFile)) == sizeof(ackFile) &&
+                 ackFile.magic == SPOOL_MAGIC && ackFile.recordSize == recordSize;
+  if (file)
+    file.close();
+
+  if (!haveAck)
+  {
+    reset(); // First boot, or the record layout changed with a firmware update
+    isReady = saveAck();
+    return isReady;
+  }
+
+  stream = ackFile.stream;
+  acked = ackFile.acked;
+
+  // Find the oldest and newest segment files
+  bool haveSegments = false;
+  uint32_t lastSegment = 0;
+  File dir = fs.open(TELEMETRY_SPOOL_DIR);
+  for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile())
+  {
+    String name = entry.name();
+    name = name.substring(name.lastIndexOf('/') + 1); // Older cores return the full path
+    entry.close();
+    if (!name.endsWith(".seg"))
+      continue;
+
+    uint32_t segment = name.toInt();
+    if (!haveSegments || segment < firstSegment)
+      firstSegment = segment;
+    if (!haveSegments || segment > lastSegment)
+      lastSegment = segment;
+    haveSegments = true;
+  }
+  dir.close();
+
+  if (!haveSegments)
+  {
+    // Segments are only deleted once full and acknowledged, so the ack must sit on a boundary
+    if (acked % TELEMETRY_SPOOL_SEGMENT_RECORDS != 0)
+    {
+      reset();
+      isReady = saveAck();
+      return isReady;
+    }
+    headSeq = acked;
+    firstSegment = segmentOf(acked + 1);
+    isReady = true;
+    return true;
+  }
+
+  // Count the intact records in the newest segment
+  const size_t recordBytes = sizeof(RecordHeader) + recordSize;
+  String path = segmentPath(lastSegment);
+  file = fs.open(path, "r");
+  size_t stored = file ? file.size() / recordBytes : 0;
+  uint32_t firstSeq = lastSegment * TELEMETRY_SPOOL_SEGMENT_RECORDS + 1;
+  uint8_t record[TELEMETRY_SPOOL_MAX_RECORD];
+  uint32_t valid = 0;
+  while (valid < stored && readRecord(file, firstSeq + valid, record))
+    valid++;
+  bool torn = file && file.size() != valid * recordBytes;
+  if (file)
+    file.close();
+
+  // A reset mid-write left a partial record: keep only the intact prefix so appends stay aligned
+  if (torn)
+  {
+    String tmpPath = path + ".tmp";
+    fs.remove(tmpPath);
+    fs.rename(path, tmpPath);
+    File source = fs.open(tmpPath, "r");
+    File target = fs.open(path, "w");
+    uint8_t buffer[sizeof(RecordHeader) + TELEMETRY_SPOOL_MAX_RECORD];
+    for (uint32_t i = 0; i < valid && source && target; i++)
+    {
+      source.read(buffer, recordBytes);
+      target.write(buffer, recordBytes);
+    }
+    source.close();
+    target.close();
+    fs.remove(tmpPath);
+  }
+
+  headSeq = lastSegment * TELEMETRY_SPOOL_SEGMENT_RECORDS + valid;
+  if (acked > headSeq)
+  {
+    reset(); // Ack ahead of the data: the spool can't be trusted
+    isReady = saveAck();
+    return isReady;
+  }
+
+  isReady = true;
+  return true;
+}
+
+bool TelemetrySpool::append(uint32_t seq, const void *record)
+{
+  if (!isReady || seq != headSeq + 1)
+    return false;
+
+  uint32_t segment = segmentOf(seq);
+
+  // Starting a new segment on a full spool: the oldest one has to go
+  if (segment >= firstSegment + TELEMETRY_SPOOL_SEGMENTS)
+  {
+    uint32_t dropFirst = firstSegment * TELEMETRY_SPOOL_SEGMENT_RECORDS + 1;
+    uint32_t dropLast = (firstSegment + 1) * TELEMETRY_SPOOL_SEGMENT_RECORDS;
+    if (acked < dropLast)
+      overwrittenCount += dropLast - max(acked + 1, dropFirst) + 1;
+    dropSegmentsThrough(firstSegment);
+  }
+
+  RecordHeader header;
+  header.seq = seq;
+  header.checksum = checksum(seq, record);
+
+  File file = fs.open(segmentPath(segment), "a");
+  if (!file)
+    return false;
+
+  bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            file.write((const uint8_t *)record, recordSize) == recordSize;
+  file.close();
+
+  if (ok)
+    headSeq = seq;
+  return ok;
+}
+
+size_t TelemetrySpool::read(uint32_t fromSeq, uint32_t toSeq, void *records, size_t maxCount)
+{
+  if (!isReady)
+    return 0;
+
+  if (fromSeq < oldestSeq())
+    fromSeq = oldestSeq();
+  if (toSeq > headSeq)
+    toSeq = headSeq;
+
+  const size_t recordBytes = sizeof(RecordHeader) + recordSize;
+  uint8_t *out = (uint8_t *)records;
+  size_t count = 0;
+  File file;
+  uint32_t openSegment = 0;
+
+  for (uint32_t seq = fromSeq; seq <= toSeq && count < maxCount; seq++)
+  {
+    uint32_t segment = segmentOf(seq);
+    if (!file || segment != openSegment)
+    {
+      if (file)
+        file.close();
+      file = fs.open(segmentPath(segment), "r");
+      openSegment = segment;
+      if (!file || !file.seek(((seq - 1) % TELEMETRY_SPOOL_SEGMENT_RECORDS) * recordBytes))
+        break;
+    }
+
+    if (!readRecord(file, seq, out + count * recordSize))
+      break;
+    count++;
+  }
+
+  if (file)
+    file.close();
+  return count;
+}
+
+void TelemetrySpool::acknowledge(uint32_t seq)
+{
+  if (!isReady || seq <= acked || seq > headSeq)
+    return;
+
+  acked = seq;
+  saveAck();
+
+  // Delete segments that are full and entirely acknowledged
+  uint32_t fullyAcked = acked / TELEMETRY_SPOOL_SEGMENT_RECORDS;
+  if (fullyAcked > firstSegment)
+    dropSegmentsThrough(fullyAcked - 1);
+}
+
+uint32_t TelemetrySpool::oldestSeq() const
+{
+  uint32_t firstStored = firstSegment * TELEMETRY_SPOOL_SEGMENT_RECORDS + 1;
+  return max(acked + 1, firstStored);
+}
+
+uint32_t TelemetrySpool::pending() const
+{
+  uint32_t oldest = oldestSeq();
+  return headSeq >= oldest ? headSeq - oldest + 1 : 0;
+}
+
+String TelemetrySpool::segmentPath(uint32_t segment) const
+{
+  return String(TELEMETRY_SPOOL_DIR "/") + String(segment) + ".seg";
+}
+
+// FNV-1a over the sequence number and the record
+uint32_t TelemetrySpool::checksum(uint32_t seq, const void *record) const
+{
+  uint32_t hash = 2166136261u;
+  const uint8_t *seqBytes = (const uint8_t *)&seq;
+  for (size_t i = 0; i < sizeof(seq); i++)
+    hash = (hash ^ seqBytes[i]) * 16777619u;
+
+  const uint8_t *bytes = (const uint8_t *)record;
+  for (size_t i = 0; i < recordSize; i++)
+    hash = (hash ^ bytes[i]) * 16777619u;
+  return hash;
+}
+
+bool TelemetrySpool::readRecord(File &file, uint32_t seq, void *record)
+{
+  RecordHeader header;
+  if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header))
+    return false;
+  if (file.read((uint8_t *)record, recordSize) != recordSize)
+    return false;
+  return header.seq == seq && header.checksum == checksum(seq, record);
+}
+
+bool TelemetrySpool::saveAck()
+{
+  SpoolAckFile ackFile;
+  ackFile.magic = SPOOL_MAGIC;
+  ackFile.recordSize = recordSize;
+  ackFile.stream = stream;
+  ackFile.acked = acked;
+
+  File file = fs.open(SPOOL_ACK_PATH, "w");
+  if (!file)
+    return false;
+  bool ok = file.write((const uint8_t *)&ackFile, sizeof(ackFile)) == sizeof(ackFile);
+  file.close();
+  return ok;
+}
+
+// Start a new stream: the server resets its sequence tracking when the stream id changes
+void TelemetrySpool::reset()
+{
+  File dir = fs.open(TELEMETRY_SPOOL_DIR);
+  String names[TELEMETRY_SPOOL_SEGMENTS * 2];
+  uint8_t count = 0;
+  for (File entry = dir.openNextFile(); entry && count < TELEMETRY_SPOOL_SEGMENTS * 2; entry = dir.openNextFile())
+  {
+    String name = entry.name();
+    names[count++] = name.substring(name.lastIndexOf('/') + 1);
+    entry.close();
+  }
+  dir.close();
+
+  for (uint8_t i = 0; i < count; i++)
+    fs.remove(String(TELEMETRY_SPOOL_DIR "/") + names[i]);
+
+  stream = esp_random() | 1; // Never 0
+  headSeq = 0;
+  acked = 0;
+  firstSegment = 0;
+}
+
+void TelemetrySpool::dropSegmentsThrough(uint32_t lastSegment)
+{
+  for (; firstSegment <= lastSegment; firstSegment++)
+    fs.remove(segmentPath(firstSegment));
+}
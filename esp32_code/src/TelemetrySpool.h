@@ -0,0 +1,83 @@
+/*
+ * Persistent store-and-forward queue for telemetry samples (LittleFS)
+ *
+ * Every sample gets the next sequence number of this spool's stream and is
+ * appended to flash before it is sent, so a WiFi or server outage no longer
+ * loses data. The server acknowledges the highest contiguous sequence number
+ * it has; everything up to there is released.
+ *
+ * Records go into append-only segment files of TELEMETRY_SPOOL_SEGMENT_RECORDS
+ * records each (LittleFS rewrites everything behind a modified block, so the
+ * spool never writes into the middle of a file). Fully acknowledged segments are
+ * deleted; when the spool is full the oldest segment is dropped.
+ *
+ * Each record carries its sequence number and a checksum, so a record torn
+ * by a reset mid-write is detected on the next boot.
+ *
+ * Not thread-safe: only the uplink task may use it.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define TELEMETRY_SPOOL_DIR "/spool"
+#define TELEMETRY_SPOOL_SEGMENT_RECORDS 256 // Records per segment file
+#define TELEMETRY_SPOOL_SEGMENTS 16         // Segment files kept at most
+#define TELEMETRY_SPOOL_MAX_RECORD 128      // Largest record size (bytes), a SensorSample with 8 probes is ~90
+
+class TelemetrySpool
+{
+public:
+  TelemetrySpool(fs::FS &fs, size_t recordSize);
+
+  // Mount-time recovery: finds the last record and the acknowledged sequence number
+  bool begin();
+  bool ready() const { return isReady; }
+
+  // Sequence number the next record must carry
+  uint32_t nextSeq() const { return headSeq + 1; }
+
+  // Append the record for seq, which must be nextSeq()
+  bool append(uint32_t seq, const void *record);
+
+  // Read up to maxCount consecutive records starting at fromSeq, never past toSeq
+  size_t read(uint32_t fromSeq, uint32_t toSeq, void *records, size_t maxCount);
+
+  // Server confirmed everything up to and including seq
+  void acknowledge(uint32_t seq);
+
+  uint32_t streamId() const { return stream; }    // Changes whenever the spool is recreated
+  uint32_t lastSeq() const { return headSeq; }    // Last appended (0 if none)
+  uint32_t ackedSeq() const { return acked; }     // Last acknowledged
+  uint32_t oldestSeq() const;                     // First record still waiting
+  uint32_t pending() const;                       // Records waiting for an ack
+  uint32_t capacity() const { return TELEMETRY_SPOOL_SEGMENT_RECORDS * TELEMETRY_SPOOL_SEGMENTS; }
+  uint32_t overwritten() const { return overwrittenCount; } // Unacked records lost to a full spool
+
+private:
+  struct RecordHeader
+  {
+    uint32_t seq;
+    uint32_t checksum;
+  };
+
+  String segmentPath(uint32_t segment) const;
+  uint32_t segmentOf(uint32_t seq) const { return (seq - 1) / TELEMETRY_SPOOL_SEGMENT_RECORDS; }
+  uint32_t checksum(uint32_t seq, const void *record) const;
+  bool readRecord(File &file, uint32_t seq, void *record);
+  bool saveAck();
+  void reset();
+  void dropSegmentsThrough(uint32_t lastSegment);
+
+  fs::FS &fs;
+  size_t recordSize;
+  bool isReady;
+
+  uint32_t stream;
+  uint32_t headSeq;
+  uint32_t acked;
+  uint32_t firstSegment; // Oldest segment file still on flash
+  uint32_t overwrittenCount;
+};
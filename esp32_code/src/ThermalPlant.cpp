@@ -0,0 +1,84 @@
+#include "ThermalPlant.h"
+
+#include <math.h>
+
+#define AIR_VOLUMETRIC_HEAT 1200.0f // J/(m³ K), air near 0-25 °C
+#define RESPIRATION_Q10 2.0f
+#define RESPIRATION_REFERENCE 5.0f  // °C the respiration rate is given at
+
+ThermalPlant::ThermalPlant(const PlantConfig &config)
+    : config(config)
+{
+  reset(20.0, 60.0);
+  setAmbient(20.0, 60.0);
+}
+
+void ThermalPlant::reset(float temperature, float relativeHumidity)
+{
+  air = temperature;
+  produce = temperature;
+  vapour = saturationDensity(temperature) * relativeHumidity / 100.0f;
+  doorOpen = false;
+}
+
+void ThermalPlant::setAmbient(float temperature, float relativeHumidity)
+{
+  ambientTemperature = temperature;
+  ambientVapour = saturationDensity(temperature) * relativeHumidity / 100.0f;
+}
+
+// Magnus formula for the saturation pressure, ideal gas for the density
+float ThermalPlant::saturationDensity(float temperature)
+{
+  float pressure = 611.2f * expf(17.62f * temperature / (243.12f + temperature)); // Pa
+  return pressure / (461.5f * (temperature + 273.15f)) * 1000.0f;
+}
+
+float ThermalPlant::humidity() const
+{
+  float rh = vapour / saturationDensity(air) * 100.0f;
+  return rh > 100.0f ? 100.0f : rh;
+}
+
+float ThermalPlant::respirationHeat() const
+{
+  return config.produceMass * config.respiration *
+         powf(RESPIRATION_Q10, (produce - RESPIRATION_REFERENCE) / 10.0f);
+}
+
+void ThermalPlant::step(float dt, uint8_t coolingStages, bool humidifier)
+{
+  float exchange = config.leakageFlow + (doorOpen ? config.doorFlow : 0); // m³/s
+
+  // Heat balance (W)
+  float ambientHeat = (config.wallConductance + exchange * AIR_VOLUMETRIC_HEAT) * (ambientTemperature - air);
+  float produceHeat = config.produceCoupling * (produce - air);
+  float cooling = coolingStages * config.stageCooling;
+
+  air += (ambientHeat + produceHeat - cooling) / config.airHeatCapacity * dt;
+  produce += (respirationHeat() - produceHeat) / (config.produceMass * config.produceHeatCapacity) * dt;
+
+  // Moisture balance (g/s)
+  float saturated = saturationDensity(air);
+  float transpired = config.transpiration * (saturationDensity(produce) - vapour);
+  if (transpired < 0)
+    transpired = 0; // Produce doesn't take water back up
+  float exchanged = exchange * (ambientVapour - vapour);
+  float added = humidifier ? config.humidifierRate : 0;
+
+  float condensed = 0;
+  if (coolingStages > 0)
+  {
+    float dewPoint = saturationDensity(air - config.coldPlateOffset);
+    if (vapour > dewPoint)
+      condensed = coolingStages * config.coldPlateFlow * (vapour - dewPoint);
+  }
+
+  vapour += (transpired + exchanged + added - condensed) / config.airVolume * dt;
+
+  // Anything above saturation fogs out on the walls
+  if (vapour > saturated)
+    vapour = saturated;
+  if (vapour < 0)
+    vapour = 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Lumped-parameter thermal and humidity model of the cold storage unit
+ *
+ * Two thermal masses: the air (plus shelving and liner) and the produce,
+ * coupled to each other and, through the walls, to the ambient air. Heat
+ * flows in:
+ *   - wall leakage, UA * (ambient - air)
+ *   - door openings: a much larger air exchange while the door is open
+ *   - produce respiration, rate per kg doubling every 10 °C (Q10 = 2)
+ * and out through the Peltier stages (fixed heat removed per active stage).
+ *
+ * Moisture is tracked as water vapour in the air: the produce transpires
+ * towards saturation at its surface, the humidifier adds a fixed rate, the
+ * Peltier cold plates condense anything above their dew point, and leakage
+ * and the door exchange vapour with the ambient air.
+ *
+ * Integrated with explicit Euler steps; keep dt at or below a second.
+ *
+ * Pure logic, no Arduino dependencies (host simulation, env:plant_bench).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+struct PlantConfig
+{
+  // Enclosure
+  float airVolume;          // m³
+  float airHeatCapacity;    // J/K, air plus shelving and liner
+  float wallConductance;    // UA, W/K
+  float leakageFlow;        // Ambient air exchanged with the door shut, m³/s
+  float doorFlow;           // ... while the door is open, m³/s
+
+  // Produce
+  float produceMass;        // kg
+  float produceHeatCapacity;// J/(kg K)
+  float produceCoupling;    // Produce-to-air heat transfer, W/K
+  float respiration;        // Respiration heat at 5 °C, W/kg
+  float transpiration;      // Produce-to-air vapour exchange, m³/s of saturated air
+
+  // Equipment
+  float stageCooling;       // Heat removed per active Peltier stage, W
+  float coldPlateOffset;    // Cold plate below the air temperature while running, °C
+  float coldPlateFlow;      // Air through the cold plate fins per active stage, m³/s
+  float humidifierRate;     // Water added while the humidifier runs, g/s
+};
+
+class ThermalPlant
+{
+public:
+  explicit ThermalPlant(const PlantConfig &config);
+
+  // Start with the air and the produce at the same temperature and humidity
+  void reset(float temperature, float humidity);
+
+  void setAmbient(float temperature, float humidity);
+  void setDoorOpen(bool open) { doorOpen = open; }
+
+  // Advance dt seconds with the given number of cooling stages and humidifier state
+  void step(float dt, uint8_t coolingStages, bool humidifier);
+
+  float airTemperature() const { return air; }
+  float produceTemperature() const { return produce; }
+  float humidity() const; // Relative humidity of the air, %
+  float respirationHeat() const; // W, at the current produce temperature
+
+  // Saturation water vapour density at a temperature (g/m³)
+  static float saturationDensity(float temperature);
+
+private:
+  PlantConfig config;
+
+  float air;      // °C
+  float produce;  // °C
+  float vapour;   // Water vapour density in the air, g/m³
+
+  float ambientTemperature;
+  float ambientVapour;
+  bool doorOpen;
+};
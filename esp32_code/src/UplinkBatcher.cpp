@@ -0,0 +1,155 @@
+#include "UplinkBatcher.h"
+
+#include <string.h>
+
+UplinkBatcher::UplinkBatcher(HttpTransport &http, const char *url)
+    : http(http), url(url), batchCount(0), urgent(false), alertPending(false), inRange(UPLINK_BATCH_MIN),
+      useMsgPack(UPLINK_MSGPACK), jsonSince(0), version(0), sent(0), length(0), httpStatus(0), rejectedFrom(0),
+      rejectedTo(0)
+{
+  memset(&lastAck, 0, sizeof(lastAck));
+  memset(&counters, 0, sizeof(counters));
+}
+
+void UplinkBatcher::add(const SensorSample &sample, bool outOfRange)
+{
+  if (full())
+    return;
+
+  batch[batchCount++] = sample;
+  if (!outOfRange)
+  {
+    if (inRange < UPLINK_BATCH_MIN)
+      inRange++;
+    return;
+  }
+
+  // Only a reading that was back in range for a while raises a new alert
+  if (inRange >= UPLINK_BATCH_MIN)
+  {
+    alertPending = true;
+    counters.alerts++;
+  }
+  inRange = 0;
+  urgent = true;
+}
+
+void UplinkBatcher::clear()
+{
+  batchCount = 0;
+  urgent = false;
+  alertPending = false;
+}
+
+// Alerts at once, small batches while something is out of range, large ones when steady
+bool UplinkBatcher::due(uint32_t now) const
+{
+  if (batchCount == 0)
+    return false;
+  return alertPending || batchCount >= (urgent ? UPLINK_BATCH_MIN : UPLINK_BATCH_MAX) ||
+         now - batch[0].timestamp >= UPLINK_BATCH_MAX_AGE;
+}
+
+uint8_t UplinkBatcher::flush(const BatchHeader &header, bool keepOnFailure)
+{
+  uint8_t result = 0;
+  uint8_t delivered = 0;
+  while (batchCount > 0)
+  {
+    uint8_t flags = send(header, batch, batchCount);
+    result |= flags;
+    if (flags & UPLINK_FAILED)
+    {
+      if (!keepOnFailure)
+        clear();
+      break;
+    }
+
+    delivered += sent; // Including dropped and rejected samples
+    batchCount -= sent;
+    memmove(batch, batch + sent, batchCount * sizeof(SensorSample));
+  }
+
+  if (batchCount == 0)
+    clear();
+  sent = delivered;
+  return result;
+}
+
+uint8_t UplinkBatcher::send(const BatchHeader &header, const SensorSample *samples, uint8_t count)
+{
+  sent = 0;
+  length = 0;
+  httpStatus = 0;
+  if (count == 0)
+    return 0;
+
+  // The server may have been updated since it refused MessagePack
+  if (UPLINK_MSGPACK && !useMsgPack && header.now - jsonSince >= UPLINK_MSGPACK_RETRY)
+    useMsgPack = true;
+
+  // Leading samples that fit the payload buffer; an empty or cut-off body is never sent
+  uint8_t fit = count;
+  while (fit > 0 && (length = encodeBatch(header, samples, fit, useMsgPack, payload, sizeof(payload))) == 0)
+    fit /= 2;
+  if (fit == 0)
+  {
+    sent = 1;
+    counters.dropped++;
+    return UPLINK_DROPPED;
+  }
+
+  size_t responseLength = 0;
+  httpStatus = http.request("POST", url, useMsgPack ? MSGPACK_CONTENT_TYPE : JSON_CONTENT_TYPE, NULL, payload,
+                            length, response, sizeof(response), responseLength);
+  counters.posts++;
+  counters.payloadTotal += length;
+  if (length > counters.payloadMax)
+    counters.payloadMax = length;
+
+  // Older servers only speak JSON: switch over and resend. Only a 415 says so,
+  // a 400 is about this batch and is handled like any other refusal below.
+  if (useMsgPack && httpStatus == 415)
+  {
+    useMsgPack = false;
+    jsonSince = header.now;
+    return UPLINK_JSON_FALLBACK | send(header, samples, count);
+  }
+
+  uint8_t result = 0;
+  if (fit < count)
+  {
+    result |= UPLINK_SPLIT;
+    counters.split++;
+  }
+
+  // The server won't take these whatever we do (bad payload, unknown device...):
+  // let them go rather than retry them forever. 408 and 429 are worth a retry.
+  if (httpStatus >= 400 && httpStatus < 500 && httpStatus != 408 && httpStatus != 429)
+  {
+    sent = fit;
+    rejectedFrom = samples[0].seq;
+    rejectedTo = samples[fit - 1].seq;
+    counters.rejected += fit;
+    return result | UPLINK_REJECTED;
+  }
+  if (httpStatus != 200)
+  {
+    counters.failed++;
+    return result | UPLINK_FAILED;
+  }
+
+  sent = fit;
+  result |= UPLINK_SENT;
+  UplinkAck answer;
+  if (decodeAck(response, responseLength, answer))
+  {
+    lastAck = answer;
+    if (answer.hasThresholdsVersion && answer.thresholdsVersion != version)
+    {
+      version = answer.thresholdsVersion;
+      result |= UPLINK_THRESHOLDS;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,133 @@
+/*
+ * Uplink batching and flush policy (uplink task)
+ *
+ * Samples taken from the sample ring collect in a batch that goes out in one
+ * POST: right away when a reading goes out of range (the alert), then every
+ * UPLINK_BATCH_MIN samples while it stays out, at UPLINK_BATCH_MAX samples
+ * when steady, and never later than UPLINK_BATCH_MAX_AGE after the oldest
+ * one. A reading has to be back in range for UPLINK_BATCH_MIN samples before
+ * it can raise a new alert, so noise on a threshold doesn't send every sample.
+ *
+ * send() encodes samples (MessagePack unless the server answered 415 to it
+ * within the last UPLINK_MSGPACK_RETRY) and
+ * POSTs them over an HttpTransport. Nothing that doesn't fit the payload
+ * buffer is ever sent: the batch is halved until its leading samples fit
+ * and the rest goes in the next POST, and a single sample too large on its
+ * own is dropped and counted. The server's answer carries the ack and the
+ * thresholds version. A 4xx other than 408/429 means the server will never
+ * take these samples: they are dropped and counted instead of being retried
+ * (and blocking everything behind them).
+ *
+ * Pure logic, no Arduino dependencies: the firmware's uplink task and
+ * controller_bench run the same policy. Not thread-safe (uplink task only).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Hal.h"
+#include "Telemetry.h"
+
+// Adaptive batching: samples per POST
+#define UPLINK_BATCH_MIN 12         // While a reading stays out of range (2 minutes at UPLINK_INTERVAL)
+#define UPLINK_BATCH_MAX 30         // When steady (5 minutes at UPLINK_INTERVAL)
+#define UPLINK_BATCH_MAX_AGE 300000 // Never hold a sample back longer than 5 minutes (ms)
+#define UPLINK_REPLAY_BATCH 30      // Spooled samples per replay POST (~30 samples/s while catching up)
+#define UPLINK_REPLAY_INTERVAL 1000 // At most one backlog replay POST per second (ms)
+
+// Telemetry encoding: MessagePack is ~30% smaller than JSON; the controller
+// falls back to JSON on its own if the server doesn't accept it (415)
+#define UPLINK_MSGPACK true
+#define UPLINK_MSGPACK_RETRY 3600000 // Try MessagePack again after an hour on JSON (ms)
+// Encoded batch buffer: a full batch (UPLINK_BATCH_MAX samples, CLIMATE_PROBES_MAX
+// probes) is ~10.1 KB of JSON in a steady room and ~13.2 KB with every field at
+// its widest (telemetry_bench checks it fits); ArduinoJson 6 prints floats with
+// up to 9 digits, ~0.5 KB more. Anything larger is split, never truncated.
+#define UPLINK_PAYLOAD_SIZE 14336
+#define UPLINK_RESPONSE_SIZE 512  // Ack / thresholds answers
+
+// send() / flush() result flags
+#define UPLINK_SENT 0x01          // The server took (some of) the samples: 200
+#define UPLINK_FAILED 0x02        // No answer or an error status, the samples are still to be sent
+#define UPLINK_SPLIT 0x04         // Too large for one payload: only the leading samples went out
+#define UPLINK_DROPPED 0x08       // A sample too large for the payload buffer on its own was dropped
+#define UPLINK_JSON_FALLBACK 0x10 // The server refused MessagePack: JSON for UPLINK_MSGPACK_RETRY
+#define UPLINK_THRESHOLDS 0x20    // The server announced a new thresholds version
+#define UPLINK_REJECTED 0x40      // The server refused samples for good (4xx): dropped, see rejectedFirst/Last()
+
+struct UplinkBatchStats
+{
+  uint32_t posts;
+  uint32_t alerts;     // Readings that went out of range (each sent without waiting)
+  uint32_t failed;     // POSTs without a 200
+  uint32_t split;      // POSTs that carried only the leading part of their batch
+  uint32_t dropped;    // Samples too large to send at all
+  uint32_t rejected;   // Samples the server refused for good
+  size_t payloadTotal; // Bytes POSTed
+  size_t payloadMax;
+};
+
+class UplinkBatcher
+{
+public:
+  UplinkBatcher(HttpTransport &http, const char *url);
+
+  // Live batch: add() does nothing when full() (leave the sample in the ring).
+  // outOfRange: the sample needs attention (ClimateControl::alert()).
+  void add(const SensorSample &sample, bool outOfRange);
+  bool full() const { return batchCount >= UPLINK_BATCH_MAX; }
+  bool empty() const { return batchCount == 0; }
+  uint8_t size() const { return batchCount; }
+  const SensorSample &oldest() const { return batch[0]; }
+  void clear(); // Forget the live batch (e.g. it is spooled)
+
+  // Enough samples for the current target, or the oldest one is too old
+  bool due(uint32_t now) const;
+
+  // Send the whole live batch, in several POSTs if it doesn't fit one.
+  // Delivered samples leave the batch; on a failure the rest stays for the
+  // next flush() if keepOnFailure, else it is discarded (it is spooled).
+  // Returns UPLINK_* flags.
+  uint8_t flush(const BatchHeader &header, bool keepOnFailure);
+
+  // POST the leading samples that fit one payload (live or replayed);
+  // returns UPLINK_* flags, sentCount() tells how many samples it took
+  uint8_t send(const BatchHeader &header, const SensorSample *samples, uint8_t count);
+
+  // Last send() / flush()
+  uint8_t sentCount() const { return sent; } // Samples delivered (or dropped)
+  size_t sentLength() const { return length; } // Bytes of the last POST
+  int status() const { return httpStatus; }  // HTTP status of the last POST, negative without an answer
+  const UplinkAck &ack() const { return lastAck; } // Server's last answer to a POST that went through
+  uint32_t rejectedFirst() const { return rejectedFrom; } // Sequence numbers of the last rejected POST
+  uint32_t rejectedLast() const { return rejectedTo; }
+
+  bool msgpack() const { return useMsgPack; }
+  uint32_t thresholdsVersion() const { return version; }
+  const UplinkBatchStats &stats() const { return counters; }
+
+private:
+  HttpTransport &http;
+  const char *url;
+
+  SensorSample batch[UPLINK_BATCH_MAX];
+  uint8_t batchCount;
+  bool urgent;       // A reading in the batch is out of range
+  bool alertPending; // A reading went out of range: send without waiting
+  uint8_t inRange;   // Samples in range in a row (up to UPLINK_BATCH_MIN)
+
+  bool useMsgPack;
+  uint32_t jsonSince; // header.now of the 415 that switched to JSON
+  uint32_t version;   // Last thresholds version announced in an answer
+  uint8_t sent;
+  size_t length;
+  int httpStatus;
+  UplinkAck lastAck;
+  uint32_t rejectedFrom;
+  uint32_t rejectedTo;
+  UplinkBatchStats counters;
+
+  uint8_t payload[UPLINK_PAYLOAD_SIZE];
+  uint8_t response[UPLINK_RESPONSE_SIZE];
+};
@@ -0,0 +1,119 @@
+#include "UplinkClient.h"
+
+UplinkClient::UplinkClient()
+{
+  resetStats();
+}
+
+int UplinkClient::post(const char *url, const char *contentType, const uint8_t *body, size_t length,
+                       String *response)
+{
+  return send("POST", url, contentType, NULL, body, length, response);
+}
+
+int UplinkClient::get(const char *url, String &response, const char *accept)
+{
+  return send("GET", url, NULL, accept, NULL, 0, &response);
+}
+
+void UplinkClient::disconnect()
+{
+  http.end();
+  client.stop();
+}
+
+void UplinkClient::resetStats()
+{
+  memset(&counters, 0, sizeof(counters));
+}
+
+float UplinkClient::reuseRatio() const
+{
+  if (counters.requests == 0)
+    return 0;
+  return (float)counters.reused / counters.requests;
+}
+
+uint32_t UplinkClient::averageLatency() const
+{
+  if (counters.requests == 0)
+    return 0;
+  return counters.totalLatency / counters.requests;
+}
+
+int UplinkClient::request(const char *method, const char *url, const char *contentType, const char *accept,
+                          const uint8_t *body, size_t length,
+                          uint8_t *response, size_t responseSize, size_t &responseLength)
+{
+  String text;
+  int code = send(method, url, contentType, accept, body, length, response != NULL ? &text : NULL);
+
+  responseLength = response != NULL ? min((size_t)text.length(), responseSize) : 0;
+  if (responseLength > 0)
+    memcpy(response, text.c_str(), responseLength);
+  return code;
+}
+
+int UplinkClient::send(const char *method, const char *url, const char *contentType, const char *accept,
+                       const uint8_t *body, size_t length, String *response)
+{
+  static const char *responseHeaders[] = {"Content-Type"};
+  lastContentType = "";
+
+  for (uint8_t attempt = 0; attempt < 2; attempt++)
+  {
+    bool reusing = client.connected();
+    unsigned long start = millis();
+
+    // begin() keeps the open socket when the host and port haven't changed
+    http.begin(client, url);
+    http.setReuse(true);
+    http.setConnectTimeout(UPLINK_HTTP_TIMEOUT);
+    http.setTimeout(UPLINK_HTTP_TIMEOUT);
+    if (contentType != NULL)
+      http.addHeader("Content-Type", contentType);
+    if (accept != NULL)
+      http.addHeader("Accept", accept);
+    http.collectHeaders(responseHeaders, 1);
+
+    int code = http.sendRequest(method, (uint8_t *)body, length);
+
+    if (code > 0)
+    {
+      lastContentType = http.header("Content-Type");
+      if (response != NULL)
+        *response = http.getString();
+      http.end(); // Leaves the connection open if the server allows keep-alive
+
+      uint32_t latency = millis() - start;
+      counters.requests++;
+      if (reusing)
+        counters.reused++;
+      counters.totalLatency += latency;
+      counters.lastLatency = latency;
+      if (latency > counters.maxLatency)
+        counters.maxLatency = latency;
+      return code;
+    }
+
+    http.end();
+    client.stop();
+
+    // A reused socket that fails before any response was most likely closed by
+    // the server while idle: retry once on a fresh connection
+    bool staleConnection = code == HTTPC_ERROR_SEND_HEADER_FAILED ||
+                           code == HTTPC_ERROR_SEND_PAYLOAD_FAILED ||
+                           code == HTTPC_ERROR_NOT_CONNECTED ||
+                           code == HTTPC_ERROR_CONNECTION_LOST;
+    if (!reusing || !staleConnection)
+    {
+      counters.failures++;
+      return code;
+    }
+
+    counters.reconnects++;
+  }
+
+  counters.failures++;
+  return HTTPC_ERROR_CONNECTION_LOST;
+}
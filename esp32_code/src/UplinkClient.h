@@ -0,0 +1,74 @@
+/*
+ * Long-lived HTTP/1.1 keep-alive client for the telemetry uplink
+ *
+ * One WiFiClient socket is shared by every request to the backend
+ * (/api/metrics and /api/thresholds live on the same host), so the TCP
+ * handshake and socket setup are paid once instead of once per sample.
+ * If the server has closed an idle connection the request is retried once
+ * on a fresh one, so callers never see stale keep-alive sockets.
+ *
+ * Keeps per-request latency and connection reuse statistics. Implements
+ * the HttpTransport interface of Hal.h for the shared telemetry code.
+ * Not thread-safe: only the uplink task may use it.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include "Hal.h"
+
+#define UPLINK_HTTP_TIMEOUT 5000 // Connect + response timeout (ms)
+
+struct UplinkStats
+{
+  uint32_t requests;      // Requests that got an HTTP response
+  uint32_t reused;        // ... of which went over an already open connection
+  uint32_t reconnects;    // Stale keep-alive connections replaced on the fly
+  uint32_t failures;      // Requests that got no response at all
+  uint32_t totalLatency;  // Sum of request latencies (ms)
+  uint32_t maxLatency;    // Slowest request (ms)
+  uint32_t lastLatency;   // Most recent request (ms)
+};
+
+class UplinkClient : public HttpTransport
+{
+public:
+  UplinkClient();
+
+  // POST a body (optionally keeping the response); returns the HTTP status or a negative HTTPC_ERROR_* code
+  int post(const char *url, const char *contentType, const uint8_t *body, size_t length,
+           String *response = NULL);
+
+  // GET into response (may be binary); returns the HTTP status or a negative HTTPC_ERROR_* code
+  int get(const char *url, String &response, const char *accept = NULL);
+
+  // HttpTransport: the response body is copied into a caller buffer
+  int request(const char *method, const char *url, const char *contentType, const char *accept,
+              const uint8_t *body, size_t length,
+              uint8_t *response, size_t responseSize, size_t &responseLength) override;
+
+  // Content-Type of the last response ("" if none)
+  const String &responseContentType() const { return lastContentType; }
+  const char *responseType() const override { return lastContentType.c_str(); }
+
+  // Drop the connection (e.g. after WiFi went down)
+  void disconnect();
+
+  const UplinkStats &stats() const { return counters; }
+  void resetStats();
+
+  // Fraction of answered requests that reused an open connection (0-1)
+  float reuseRatio() const;
+  uint32_t averageLatency() const;
+
+private:
+  int send(const char *method, const char *url, const char *contentType, const char *accept,
+              const uint8_t *body, size_t length, String *response);
+
+  WiFiClient client;
+  HTTPClient http;
+  UplinkStats counters;
+  String lastContentType;
+};
@@ -0,0 +1,304 @@
+/*
+ * Host run of the controller logic against simulated hardware (env:native)
+ *
+ * Drives the firmware's Acquisition, ClimateControl, SampleRing and
+ * UplinkBatcher code with the SimHal sensors, relays, display and backend on
+ * a virtual clock, in the same order the sensor, control, display and uplink
+ * tasks run them, and reports how fast that went compared to real time:
+ *
+ *   pio run -e native
+ *   .pio/build/native/program [-h hours] [-j] [-q] [-s seed] [-f dhtFailureRate] [-l httpLossRate] [-n probes]
+ *
+ * The climate follows a scripted trace (slow temperature and humidity swings
+ * through the produce's range, a VOC event every six hours, new thresholds
+ * from the server halfway through); nothing reacts to the relays. Schedule,
+ * control and uplink settings are the firmware's (ControllerConfig.h,
+ * UplinkBatcher.h), there is no spool. -j has the server refuse MessagePack,
+ * so the controller falls back to JSON. -n spreads
+ * several probes from floor to ceiling in a stratified room (warmer at the
+ * top), controlled on the worst-case probes.
+ *
+ * -q keeps the room quiet instead (small swings well inside the thresholds,
+ * no stratification, VOC event or new thresholds): nothing is urgent, so
+ * every batch fills up to UPLINK_BATCH_MAX. With -n 8 -j that is the
+ * largest payload the firmware sends. Exits non-zero if a batch didn't fit
+ * the payload buffer (split or dropped), or if -q produced no full batch.
+ */
+
+#include "Acquisition.h"
+#include "ClimateControl.h"
+#include "ControllerConfig.h"
+#include "GasIndexAlgorithm.h"
+#include "SampleRing.h"
+#include "SimHal.h"
+#include "Telemetry.h"
+#include "UplinkBatcher.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define STRATIFICATION 1.5 // °C per m of height in the simulated room
+
+const Thresholds detectedThresholds = {200, 0.0, 2.0, 1.0, 90.0, 95.0}; // e.g. apples
+
+static const char *serverUrl = "http://sim/api/metrics";
+static const char *thresholdsUrl = "http://sim/api/thresholds";
+
+int main(int argc, char **argv)
+{
+  double hours = 24;
+  bool msgpack = true;
+  uint32_t seed = 1;
+  float dhtFailureRate = 0.02;
+  float httpLossRate = 0.01;
+  int probes = 1;
+  bool quiet = false;
+
+  for (int arg = 1; arg < argc; arg++)
+  {
+    if (argv[arg][0] != '-')
+    {
+      fprintf(stderr,
+              "usage: %s [-h hours] [-j] [-q] [-s seed] [-f dhtFailureRate] [-l httpLossRate] [-n probes]\n",
+              argv[0]);
+      return 2;
+    }
+    if (argv[arg][1] == 'j' || argv[arg][1] == 'q')
+    {
+      msgpack = msgpack && argv[arg][1] != 'j';
+      quiet = quiet || argv[arg][1] == 'q';
+      continue;
+    }
+    if (arg + 1 >= argc)
+    {
+      fprintf(stderr, "Missing value for %s\n", argv[arg]);
+      return 2;
+    }
+    const char *value = argv[++arg];
+    switch (argv[arg - 1][1])
+    {
+    case 'h': hours = atof(value); break;
+    case 's': seed = (uint32_t)strtoul(value, NULL, 10); break;
+    case 'f': dhtFailureRate = atof(value); break;
+    case 'l': httpLossRate = atof(value); break;
+    case 'n': probes = atoi(value); break;
+    default:
+      fprintf(stderr, "Unknown option %s\n", argv[arg - 1]);
+      return 2;
+    }
+  }
+
+  SimClock clock;
+  clock.setEpoch(1760000000);
+  if (probes < 1 || probes > CLIMATE_PROBES_MAX)
+  {
+    fprintf(stderr, "1 to %d probes\n", CLIMATE_PROBES_MAX);
+    return 2;
+  }
+
+  // Probes evenly from 0.2 m to 2.2 m (a single one at 1 m)
+  SimClimateSensor probeSensors[CLIMATE_PROBES_MAX];
+  float probeHeights[CLIMATE_PROBES_MAX];
+  for (int i = 0; i < probes; i++)
+  {
+    probeSensors[i] = SimClimateSensor(seed + 10 + i);
+    probeSensors[i].setNoise(0.1, 0.5);
+    probeSensors[i].setFailureRate(dhtFailureRate);
+    probeHeights[i] = probes > 1 ? 0.2 + 2.0 * i / (probes - 1) : 1.0;
+  }
+  SimGasSensor gasSensor(clock, seed + 1);
+  SimRelays relays(clock);
+  SimDisplay display;
+  SimHttpTransport server(defaultThresholds, seed + 2);
+  server.setFailureRate(httpLossRate);
+  server.setMsgPackSupport(msgpack);
+
+  GasIndexAlgorithm vocAlgorithm(GAS_INDEX_VOC);
+  GasIndexAlgorithm noxAlgorithm(GAS_INDEX_NOX);
+  ClimateControl climate(coolingConfig, relays, defaultThresholds);
+  Acquisition acquisition(dhtAcquisitionConfig, clock, gasSensor, vocAlgorithm, noxAlgorithm);
+  for (int i = 0; i < probes; i++)
+    acquisition.addProbe(probeSensors[i], probeHeights[i]);
+
+  climate.begin();
+  climate.setTarget(CONTROL_TARGET_WORST);
+  display.begin();
+  acquisition.begin(gasSensor.begin());
+
+  static SampleRing<SensorSample, SAMPLE_RING_CAPACITY> sampleRing(SAMPLE_RING_POLICY);
+  static UplinkBatcher uplinkBatcher(server, serverUrl);
+  static uint8_t response[UPLINK_RESPONSE_SIZE];
+  uint32_t nextSeq = 1;
+  bool thresholdsChanged = false;
+  bool thresholdsSwapped = false;
+
+  SensorSample latest = {};
+  uint32_t samples = 0, uplinkSamples = 0, thresholdFetches = 0;
+  uint32_t relayEvents = 0, humidifierEvents = 0, sensorFaults = 0, fullBatches = 0;
+  unsigned long lastControl = 0, lastDisplay = 0, lastThresholds = 0;
+
+  const uint32_t simulatedMs = (uint32_t)(hours * 3600000.0);
+  auto started = std::chrono::steady_clock::now();
+
+  while (clock.millis() < simulatedMs)
+  {
+    clock.advance(SENSOR_TICK);
+    uint32_t now = clock.millis();
+
+    // Scripted climate: 2 h temperature swing, 3 h humidity swing, a 20 minute VOC event every 6 h
+    // (quiet: a tenth of the swings, no stratification or VOC event)
+    double h = now / 3600000.0;
+    float swing = quiet ? 0.1 : 1.0;
+    float roomTemperature = 3.0 + swing * 2.0 * sin(2 * M_PI * h / 2.0);
+    float roomHumidity = 89.0 + swing * 7.0 * sin(2 * M_PI * h / 3.0);
+    for (int i = 0; i < probes; i++)
+      probeSensors[i].set(roomTemperature + (quiet ? 0 : STRATIFICATION) * (probeHeights[i] - 1.0), roomHumidity);
+    gasSensor.setVocOffset(!quiet && fmod(h, 6.0) > 5.0 && fmod(h, 6.0) < 5.34 ? 4000 : 0);
+
+    // Produce detected halfway through: the server bumps its thresholds version
+    if (!quiet && !thresholdsSwapped && now >= simulatedMs / 2)
+    {
+      server.setThresholds(detectedThresholds);
+      thresholdsSwapped = true;
+    }
+
+    // Sensor task
+    SensorSample sample;
+    uint8_t events = acquisition.poll(sample);
+    if (events & ACQ_SENSOR_FAULT)
+      sensorFaults++;
+    if (events & ACQ_SAMPLE)
+    {
+      samples++;
+      latest = sample;
+      if (climate.update(sample) != HUMIDIFIER_UNCHANGED)
+        humidifierEvents++;
+    }
+
+    // Control task
+    if (now - lastControl >= CONTROL_TICK)
+    {
+      lastControl = now;
+      if (climate.tick(now))
+        relayEvents++;
+    }
+
+    // Display task
+    if (now - lastDisplay >= DISPLAY_INTERVAL)
+    {
+      lastDisplay = now;
+      if (acquisition.sensorFault())
+      {
+        display.showSensorError(acquisition.failedReadings());
+      }
+      else
+      {
+        DisplayState state;
+        state.temperature = latest.temperature;
+        state.humidity = latest.humidity;
+        state.vocIndex = latest.vocIndex;
+        state.temperatureAlarm = latest.temperatureMin < climate.thresholds().tempMin ||
+                                 latest.temperatureMax > climate.thresholds().tempMax;
+        state.humidityAlarm = latest.humidityMin < climate.thresholds().humidityMin ||
+                              latest.humidityMax > climate.thresholds().humidityMax;
+        state.vocAlarm = latest.vocIndex > climate.thresholds().vocThreshold;
+        state.cooling = climate.coolingActive();
+        state.pump = climate.pumpActive();
+        state.humidifierScrubber = climate.humidifierScrubberActive();
+        display.showReadings(state);
+      }
+    }
+
+    // Sensor task hands the uplink samples over through the ring
+    if (events & ACQ_UPLINK)
+    {
+      uplinkSamples++;
+      sampleRing.push(sample);
+    }
+
+    // Uplink task: adaptive batch, ack and thresholds version from the answer
+    SensorSample queued;
+    while (!uplinkBatcher.full() && sampleRing.pop(queued))
+    {
+      queued.seq = nextSeq++;
+      uplinkBatcher.add(queued, climate.alert(queued));
+    }
+    if (uplinkBatcher.due(now))
+    {
+      BatchHeader header = {now, seed, uplinkBatcher.oldest().seq, false, 0, 0, 0};
+      if (uplinkBatcher.flush(header, true) & UPLINK_THRESHOLDS)
+        thresholdsChanged = true;
+      if (uplinkBatcher.sentCount() == UPLINK_BATCH_MAX)
+        fullBatches++;
+    }
+
+    if (thresholdsChanged || now - lastThresholds >= THRESHOLD_UPDATE_INTERVAL)
+    {
+      lastThresholds = now;
+      thresholdsChanged = false;
+
+      size_t length = 0;
+      int status = server.request("GET", thresholdsUrl, NULL,
+                                  uplinkBatcher.msgpack() ? MSGPACK_CONTENT_TYPE ", " JSON_CONTENT_TYPE
+                                                          : JSON_CONTENT_TYPE,
+                                  NULL, 0, response, sizeof(response), length);
+      Thresholds thresholds = climate.thresholds();
+      bool packed = strcmp(server.responseType(), MSGPACK_CONTENT_TYPE) == 0;
+      if (status == 200 && decodeThresholds(response, length, packed, thresholds))
+      {
+        climate.setThresholds(thresholds);
+        thresholdFetches++;
+      }
+    }
+  }
+
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  double simulatedS = simulatedMs / 1000.0;
+
+  printf("Simulated %.1f h in %.3f s wall: %.0fx real time (%u sensor ticks, %.2f us each)\n",
+         simulatedS / 3600, wallS, simulatedS / wallS, simulatedMs / (uint32_t)SENSOR_TICK,
+         wallS * 1e6 / (simulatedMs / SENSOR_TICK));
+  uint32_t probeReads = 0, probeFailures = 0;
+  for (int i = 0; i < probes; i++)
+  {
+    probeReads += probeSensors[i].reads();
+    probeFailures += probeSensors[i].failures();
+  }
+  printf("Samples: %u (%u DHT reads on %d probe(s), %u failed, %u faults), %u gas conversions\n",
+         samples, probeReads, probes, probeFailures, sensorFaults, gasSensor.conversions());
+  printf("Room: last mean %.2f°C, probes %.2f–%.2f°C, gradient %+.2f°C/m\n", latest.temperature,
+         latest.temperatureMin, latest.temperatureMax, latest.temperatureGradient);
+  const UplinkBatchStats &uplink = uplinkBatcher.stats();
+  printf("Uplink (%s): %u samples (%u dropped by the ring), %u POSTs (%u failed, %u split, %u samples too large)\n",
+         uplinkBatcher.msgpack() ? "msgpack" : "json", uplinkSamples, sampleRing.dropped(), uplink.posts,
+         uplink.failed, uplink.split, uplink.dropped);
+  printf("Payload: avg %zu / max %zu bytes (buffer %u), %u full %u-sample batches\n",
+         uplink.posts > 0 ? uplink.payloadTotal / uplink.posts : 0, uplink.payloadMax, UPLINK_PAYLOAD_SIZE,
+         fullBatches, UPLINK_BATCH_MAX);
+  printf("Batching: %.1f samples per POST, %u alerts sent at once\n",
+         uplink.posts > 0 ? (double)uplinkSamples / uplink.posts : 0.0, uplink.alerts);
+  printf("Server: %u samples received, ack %u of %u, %u threshold fetches\n",
+         server.samplesReceived(), server.acked(), nextSeq - 1, thresholdFetches);
+  printf("Control: %u cooling decisions, %u humidifier/scrubber changes, %u display frames\n",
+         relayEvents, humidifierEvents, display.frames());
+  for (uint8_t channel = 0; channel < RELAY_CHANNELS; channel++)
+    printf("  relay %u: %u switch-ons, on %.1f%% of the time\n", channel, relays.switchOns(channel),
+           100.0 * relays.onTimeMs(channel) / simulatedMs);
+
+  int failures = 0;
+  if (uplink.split > 0 || uplink.dropped > 0)
+  {
+    printf("FAIL: batches larger than the payload buffer (%u split, %u samples dropped)\n", uplink.split,
+           uplink.dropped);
+    failures++;
+  }
+  if (quiet && fullBatches == 0)
+  {
+    printf("FAIL: no full batch in a quiet room\n");
+    failures++;
+  }
+  return failures > 0 ? 1 : 0;
+}
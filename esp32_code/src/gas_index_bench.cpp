@@ -0,0 +1,255 @@
+/*
+ * Host replay and benchmark of the Gas Index algorithm (env:gas_index_bench)
+ *
+ * Feeds a 1 Hz SGP41 raw trace through GasIndexAlgorithm (VOC and NOx),
+ * compares the indices with the reference values recorded alongside, then
+ * times process() over repeated passes:
+ *
+ *   pio run -e gas_index_bench
+ *   .pio/build/gas_index_bench/program [-t tolerance] [-r repeat] [trace.csv]
+ *
+ * Trace: one line per second, "srawVoc,srawNox[,vocIndex,noxIndex]" (a
+ * header line and lines starting with # are skipped), e.g. raw signals
+ * logged from the SGP41 together with the indices Sensirion's reference
+ * implementation computes for them. Without a file a synthetic 36 h trace
+ * (noisy baseline, a VOC/NOx event every 6 h) is replayed and checked for
+ * the algorithm's invariants instead: blackout, 1-500 range, baseline index
+ * near 100 (VOC) / 1 (NOx), events well above it.
+ *
+ * Exits non-zero if an index misses its reference by more than the
+ * tolerance or an invariant fails.
+ */
+
+#include "GasIndexAlgorithm.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define BLACKOUT_SAMPLES 46 // INITIAL_BLACKOUT: uptime up to and including 45 s
+#define SYNTHETIC_HOURS 36
+#define SYNTHETIC_EVENT_EVERY_S (6 * 3600)
+#define SYNTHETIC_EVENT_S 1200
+#define SYNTHETIC_LEARNING_S (3 * 3600) // Invariants are checked after this
+
+struct TraceSample
+{
+  int32_t srawVoc;
+  int32_t srawNox;
+  bool hasReference;
+  int32_t vocIndex;
+  int32_t noxIndex;
+};
+
+static bool loadTrace(const char *path, std::vector<TraceSample> &trace)
+{
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    return false;
+
+  char line[128];
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    TraceSample sample = {};
+    int fields = sscanf(line, "%d,%d,%d,%d", &sample.srawVoc, &sample.srawNox, &sample.vocIndex, &sample.noxIndex);
+    if (fields < 2)
+      continue; // Header or comment
+    sample.hasReference = fields == 4;
+    trace.push_back(sample);
+  }
+  fclose(file);
+  return true;
+}
+
+// Noisy baseline with a 20 minute event every 6 hours (VOC ticks drop, NOx ticks rise)
+static void syntheticTrace(std::vector<TraceSample> &trace)
+{
+  uint32_t state = 1;
+  auto noise = [&state](float amplitude) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return amplitude * ((state >> 8) / 8388608.0f - 1.0f);
+  };
+
+  float vocDrift = 0;
+  for (uint32_t t = 0; t < SYNTHETIC_HOURS * 3600; t++)
+  {
+    uint32_t phase = t % SYNTHETIC_EVENT_EVERY_S;
+    bool event = t >= SYNTHETIC_EVENT_EVERY_S && phase < SYNTHETIC_EVENT_S;
+    float envelope = event ? sinf(M_PI * phase / SYNTHETIC_EVENT_S) : 0.0f;
+
+    vocDrift += noise(0.5f) - vocDrift * 0.001f; // Slow wander of the baseline
+    TraceSample sample = {};
+    sample.srawVoc = (int32_t)(30000 + vocDrift + noise(5.0f) - 4000 * envelope);
+    sample.srawNox = (int32_t)(16000 + noise(5.0f) + 3000 * envelope);
+    trace.push_back(sample);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int tolerance = 1;
+  int repeat = 20;
+
+  int arg = 1;
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+  {
+    int value = atoi(argv[arg + 1]);
+    switch (argv[arg][1])
+    {
+    case 't': tolerance = value; break;
+    case 'r': repeat = value > 0 ? value : 1; break;
+    default:
+      fprintf(stderr, "usage: %s [-t tolerance] [-r repeat] [trace.csv]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<TraceSample> trace;
+  bool synthetic = arg >= argc;
+  if (synthetic)
+  {
+    syntheticTrace(trace);
+  }
+  else if (!loadTrace(argv[arg], trace) || trace.empty())
+  {
+    fprintf(stderr, "Can't read a trace from %s (srawVoc,srawNox[,vocIndex,noxIndex] per line)\n", argv[arg]);
+    return 1;
+  }
+
+  // Replay, against the reference where the trace has one
+  GasIndexAlgorithm voc(GAS_INDEX_VOC);
+  GasIndexAlgorithm nox(GAS_INDEX_NOX);
+  std::vector<int32_t> vocIndex(trace.size()), noxIndex(trace.size());
+  uint32_t compared = 0, mismatches = 0;
+  int32_t worstError = 0;
+  for (size_t i = 0; i < trace.size(); i++)
+  {
+    vocIndex[i] = voc.process(trace[i].srawVoc);
+    noxIndex[i] = nox.process(trace[i].srawNox);
+    if (!trace[i].hasReference)
+      continue;
+
+    compared++;
+    int32_t error = abs(vocIndex[i] - trace[i].vocIndex);
+    if (abs(noxIndex[i] - trace[i].noxIndex) > error)
+      error = abs(noxIndex[i] - trace[i].noxIndex);
+    if (error > worstError)
+      worstError = error;
+    if (error > tolerance)
+    {
+      if (mismatches < 10)
+        printf("line %zu: VOC %d (reference %d), NOx %d (reference %d)\n", i + 1, vocIndex[i],
+               trace[i].vocIndex, noxIndex[i], trace[i].noxIndex);
+      mismatches++;
+    }
+  }
+
+  printf("Replayed %zu samples (%s, %.1f h)\n", trace.size(), synthetic ? "synthetic" : argv[arg],
+         trace.size() / 3600.0);
+  if (compared > 0)
+    printf("Reference: %u samples compared, worst error %d, %u beyond +/-%d\n", compared, worstError, mismatches,
+           tolerance);
+
+  int failures = mismatches > 0 ? 1 : 0;
+  if (synthetic)
+  {
+    // Invariants: blackout, range, quiet baseline and events after the learning phase
+    int32_t quietMin = 500, quietMax = 0, noxQuietMax = 0, eventPeakMin = 500, eventPeak = 0;
+    bool blackout = true, inRange = true;
+    for (size_t t = 0; t < trace.size(); t++)
+    {
+      if (t < BLACKOUT_SAMPLES)
+      {
+        blackout = blackout && vocIndex[t] == 0 && noxIndex[t] == 0;
+        continue;
+      }
+      inRange = inRange && vocIndex[t] >= 1 && vocIndex[t] <= 500 && noxIndex[t] >= 1 && noxIndex[t] <= 500;
+      if (t < SYNTHETIC_LEARNING_S)
+        continue;
+
+      uint32_t phase = t % SYNTHETIC_EVENT_EVERY_S;
+      if (phase == SYNTHETIC_EVENT_S - 1) // End of an event: its peak is in
+      {
+        if (eventPeak < eventPeakMin)
+          eventPeakMin = eventPeak;
+        eventPeak = 0;
+      }
+      if (phase < SYNTHETIC_EVENT_S)
+      {
+        if (vocIndex[t] > eventPeak)
+          eventPeak = vocIndex[t];
+      }
+      else if (phase > 2 * SYNTHETIC_EVENT_S) // Settled after the event
+      {
+        if (vocIndex[t] < quietMin)
+          quietMin = vocIndex[t];
+        if (vocIndex[t] > quietMax)
+          quietMax = vocIndex[t];
+        if (noxIndex[t] > noxQuietMax)
+          noxQuietMax = noxIndex[t];
+      }
+    }
+
+    printf("Baseline: VOC index %d-%d, NOx index <= %d; weakest event peak VOC %d\n", quietMin, quietMax,
+           noxQuietMax, eventPeakMin);
+    struct
+    {
+      bool ok;
+      const char *what;
+    } checks[] = {
+        {blackout, "index 0 during the 45 s blackout"},
+        {inRange, "index within 1-500 afterwards"},
+        {quietMin >= 80 && quietMax <= 120, "VOC baseline index near 100"},
+        {noxQuietMax <= 5, "NOx baseline index near 1"},
+        {eventPeakMin >= 250, "every VOC event above the default threshold (250)"},
+    };
+    for (const auto &check : checks)
+    {
+      if (!check.ok)
+      {
+        printf("FAIL: %s\n", check.what);
+        failures++;
+      }
+    }
+  }
+
+  // Cost: whole passes for the average, single calls for the worst case
+  double totalS = 0, worstNs = 0;
+  for (int pass = 0; pass < repeat; pass++)
+  {
+    GasIndexAlgorithm timedVoc(GAS_INDEX_VOC);
+    GasIndexAlgorithm timedNox(GAS_INDEX_NOX);
+    volatile int32_t sink = 0;
+
+    auto passStart = std::chrono::steady_clock::now();
+    for (const TraceSample &sample : trace)
+      sink = sink + timedVoc.process(sample.srawVoc) + timedNox.process(sample.srawNox);
+    totalS += std::chrono::duration<double>(std::chrono::steady_clock::now() - passStart).count();
+  }
+  {
+    GasIndexAlgorithm timedVoc(GAS_INDEX_VOC);
+    volatile int32_t sink = 0;
+    for (const TraceSample &sample : trace)
+    {
+      auto start = std::chrono::steady_clock::now();
+      sink = sink + timedVoc.process(sample.srawVoc);
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      if (ns > worstNs)
+        worstNs = ns;
+    }
+  }
+  double calls = 2.0 * trace.size() * repeat;
+  printf("process(): avg %.1f ns, worst %.0f ns per sample (%d passes, VOC + NOx; worst includes the timer)\n",
+         totalS * 1e9 / calls, worstNs, repeat);
+
+  if (failures > 0)
+  {
+    printf("FAILED\n");
+    return 1;
+  }
+  return 0;
+}
@@ -30,15 +30,38 @@
  *
  * Scrubbing System Relay:
  * - Control Pin -> GPIO 5 (ESP32)
+ *
+ * More temperature/humidity probes (optional, see probeSensors):
+ * - DHT22: one GPIO each (e.g. 16, 17, 27), wired like the first one
+ * - SHT4x/SHT3x: TCA9548A I2C mux on SDA/SCL (0x70), one probe per channel
  */
 
 #include <WiFi.h>
 #include <HTTPClient.h>
-#include <DHT.h>
-#include <ArduinoJson.h>
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "SampleRing.h"
+#include "SGP41.h"
+#include "DHT22Rmt.h"
+#include "SHTxx.h"
+#include "TCA9548A.h"
+#include "GasIndexAlgorithm.h"
+#include "ClimateControl.h"
+#include "Acquisition.h"
+#include "ControllerConfig.h"
+#include "Telemetry.h"
+#include "UplinkBatcher.h"
+#include "ArduinoHal.h"
+#include "UplinkClient.h"
+#include "TelemetrySpool.h"
+#include <LittleFS.h>
+#include <time.h>
+#include <Preferences.h>
 
 // OLED Display settings
 #define SCREEN_WIDTH 128
@@ -48,7 +71,7 @@
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 
 // SGP41 I2C Address
-#define SGP41_ADDRESS 0x59
+#define SGP41_ADDRESS SGP41_DEFAULT_ADDRESS
 
 // WiFi credentials - UPDATE THESE WITH YOUR NETWORK
 
@@ -59,10 +82,31 @@ const char *password = "talent401";
 const char *serverUrl = "http://172.20.10.2:3000/api/metrics";
 const char *thresholdsUrl = "http://172.20.10.2:3000/api/thresholds";
 
+// Temperature/humidity sensor backend, selected at compile time like DHT_TYPE
+#define CLIMATE_SENSOR_DHT22 1 // One-wire on DHT_PIN, one reading per 2.5 s, averaged
+#define CLIMATE_SENSOR_SHT4X 2 // I2C (shares the bus with the SGP41), oversampled at 10 Hz and filtered
+#define CLIMATE_SENSOR_SHT3X 3
+#define CLIMATE_SENSOR CLIMATE_SENSOR_DHT22
+
 // Pin definitions
 #define DHT_PIN 4      // GPIO 4 for DHT22 data pin
 #define DHT_TYPE DHT22 // DHT22 sensor type
-#define NUM_READINGS 3 // Number of readings to average
+#define DHT_USE_RMT true // Capture the frame with the RMT peripheral; false: Adafruit DHT library
+                         // (bit-banged with interrupts off for ~5 ms, disturbs WiFi and I2C)
+#define DHT_RMT_CHANNEL RMT_CHANNEL_2 // Uses the memory of channels 2 and 3
+
+// SHT4x/SHT3x settings
+#define SHT_ADDRESS SHT_DEFAULT_ADDRESS
+#define SHT_REPEATABILITY SHT_REPEATABILITY_HIGH // On-chip averaging, still < 20 ms per conversion
+#define SHT_USE_MUX false                         // Probes behind a TCA9548A, one per channel (same address)
+#define MUX_ADDRESS TCA9548A_DEFAULT_ADDRESS
+
+// Probe array (probeSensors below): the room's probes convert at the same time
+// and are aggregated into mean, min/max and vertical gradient. The control can
+// follow the mean or the worst-case probes (cooling keeps the warmest and the
+// coldest inside the range, the humidifier follows the driest); with a single
+// probe both are the same.
+#define CONTROL_TARGET CONTROL_TARGET_WORST
 
 // Single Relay Module (1 channel)
 #define HUMIDIFIER_SCRUBBER_PIN 26 // GPIO 26 for humidifier + scrubber (4A total)
@@ -73,359 +117,638 @@ const char *thresholdsUrl = "http://172.20.10.2:3000/api/thresholds";
 #define PELTIER_3_PIN 23      // GPIO 23 for Peltier 3 (6A)
 #define PELTIER_4_PIN 25      // GPIO 25 for Peltier 4 (6A)
 
-// Default control thresholds (will be updated from server)
-float VOC_THRESHOLD = 30000; // VOC raw threshold (clean air: ~25000, polluted: >30000)
-float TEMP_MIN = 2.0;        // Target minimum temperature (°C)
-float TEMP_MAX = 4.0;        // Target maximum temperature (°C)
-float HUMIDITY_MIN = 85.0;   // Target minimum humidity (%)
-float HUMIDITY_MAX = 95.0;   // Target maximum humidity (%)
-
-// Last threshold update time
-unsigned long lastThresholdUpdate = 0;
-const unsigned long THRESHOLD_UPDATE_INTERVAL = 30000; // Update every 30 seconds
-
-// Calibration offsets (adjust based on known reference values)
-#define TEMP_OFFSET 0.0 // No calibration - raw DHT22 reading
-#define HUM_OFFSET 0.0  // No calibration - raw DHT22 reading
-
-// Create DHT sensor object
-DHT dht(DHT_PIN, DHT_TYPE);
-
-// VOC sensor variables
-uint16_t vocRaw = 0;
-
-// Variables to store sensor readings
-float temperature = 0.0;
-float humidity = 0.0;
-float vocIndex = 0.0;
-int failedReadings = 0;
-bool sgpReady = false;
-
-// Relay status tracking
-bool coolingActive = false;
-bool pumpActive = false;
-bool humidifierScrubberActive = false;
-
-// Function to get averaged sensor readings
-bool getAveragedReadings(float &avgTemp, float &avgHum)
+// Thresholds, schedule, cooling and acquisition settings are shared with the host
+// benches (ControllerConfig.h), so is the uplink batching policy (UplinkBatcher.h)
+bool thresholdsChanged = false; // Server has newer thresholds: fetch before the next interval
+const unsigned long WIFI_CHECK_INTERVAL = 5000; // Check WiFi link every 5 seconds
+const unsigned long STACK_REPORT_INTERVAL = 60000; // Print task stack high-water marks every minute
+static_assert(SGP_CONDITIONING_DURATION == SGP41_CONDITIONING_DURATION_MS, "SGP41 conditioning time");
+
+// FreeRTOS tasks: acquisition + control on the APP core, networking + display on the PRO core
+// (where the WiFi stack lives), so a hung HTTP request can never starve the relay logic
+#define CONTROL_TASK_PRIORITY 4
+#define SENSOR_TASK_PRIORITY 3
+#define UPLINK_TASK_PRIORITY 2
+#define DISPLAY_TASK_PRIORITY 1
+
+#define SENSOR_TASK_STACK 4096 // Stack sizes in bytes
+#define CONTROL_TASK_STACK 4096
+#define UPLINK_TASK_STACK 8192
+#define DISPLAY_TASK_STACK 4096
+
+// Keep-alive HTTP connection shared by the metrics POSTs and threshold GETs (uplink task only)
+UplinkClient uplink;
+
+// SGP41 VOC/NOx sensor
+SGP41 sgp41(Wire);
+
+// Sensirion Gas Index algorithms (raw ticks -> 0-500 index), baseline kept in NVS
+GasIndexAlgorithm vocAlgorithm(GAS_INDEX_VOC);
+GasIndexAlgorithm noxAlgorithm(GAS_INDEX_NOX);
+Preferences gasIndexStore;
+
+// Worst-case sensor task iteration since the last stack report (ms)
+unsigned long maxSensorIteration = 0;
+
+// Statically allocated queues holding only the latest sample (xQueueOverwrite)
+StaticQueue_t controlQueueBuffer;
+StaticQueue_t displayQueueBuffer;
+uint8_t controlQueueStorage[sizeof(SensorSample)];
+uint8_t displayQueueStorage[sizeof(SensorSample)];
+QueueHandle_t controlQueue = NULL;
+QueueHandle_t displayQueue = NULL;
+
+// Timestamped samples waiting for the uplink task (sensor task pushes, uplink task drains)
+SampleRing<SensorSample, SAMPLE_RING_CAPACITY> sampleRing(SAMPLE_RING_POLICY);
+
+// Samples popped from the ring and waiting to go out in the next batch (uplink task only)
+UplinkBatcher uplinkBatcher(uplink, serverUrl);
+uint8_t thresholdsResponse[UPLINK_RESPONSE_SIZE];
+
+// Store-and-forward: every sample is spooled to flash before it is sent and
+// released once the server acknowledges it (uplink task only)
+TelemetrySpool spool(LittleFS, sizeof(SensorSample));
+SensorSample replayBatch[UPLINK_REPLAY_BATCH];
+uint32_t uplinkSeq = 0;      // Sequence numbers while the spool is unavailable
+uint32_t uplinkStream = 0;
+unsigned long lastReplay = 0;
+uint32_t replayedCount = 0;  // Spooled samples delivered after the fact
+
+// I2C bus is shared by the SGP41 (sensor task) and the SSD1306 (display task)
+StaticSemaphore_t i2cMutexBuffer;
+SemaphoreHandle_t i2cMutex = NULL;
+
+// Thresholds are written by the uplink task and read by the control task
+// (the display only uses them for the "!" markers and reads them unlocked)
+StaticSemaphore_t thresholdsMutexBuffer;
+SemaphoreHandle_t thresholdsMutex = NULL;
+
+// Statically allocated task stacks and control blocks
+StaticTask_t sensorTaskBuffer;
+StaticTask_t controlTaskBuffer;
+StaticTask_t uplinkTaskBuffer;
+StaticTask_t displayTaskBuffer;
+StackType_t sensorTaskStack[SENSOR_TASK_STACK];
+StackType_t controlTaskStack[CONTROL_TASK_STACK];
+StackType_t uplinkTaskStack[UPLINK_TASK_STACK];
+StackType_t displayTaskStack[DISPLAY_TASK_STACK];
+TaskHandle_t sensorTaskHandle = NULL;
+TaskHandle_t controlTaskHandle = NULL;
+TaskHandle_t uplinkTaskHandle = NULL;
+TaskHandle_t displayTaskHandle = NULL;
+
+// Hardware behind the Hal.h interfaces the control and acquisition logic uses
+ArduinoClock systemClock;
+#if CLIMATE_SENSOR == CLIMATE_SENSOR_DHT22
+#define CLIMATE_SENSOR_NAME "DHT22"
+#define CLIMATE_ACQUISITION dhtAcquisitionConfig
+#if DHT_USE_RMT
+// One GPIO and RMT channel per probe; each also takes the next channel's memory (4 probes at most)
+Dht22RmtSensor probeSensors[] = {
+    {DHT_PIN, DHT_RMT_CHANNEL}, // Middle shelf
+    // {16, RMT_CHANNEL_0},     // Floor
+    // {17, RMT_CHANNEL_4},     // Top shelf
+};
+#else
+Dht22Sensor probeSensors[] = {
+    {DHT_PIN, DHT_TYPE},
+};
+#endif
+#else
+#define CLIMATE_SENSOR_NAME (CLIMATE_SENSOR == CLIMATE_SENSOR_SHT4X ? "SHT4x" : "SHT3x")
+#define CLIMATE_ACQUISITION shtAcquisitionConfig
+#define SHT_MODEL (CLIMATE_SENSOR == CLIMATE_SENSOR_SHT4X ? SHT_MODEL_4X : SHT_MODEL_3X)
+#if SHT_USE_MUX
+TCA9548A i2cMux(Wire, MUX_ADDRESS);
+ShtClimateSensor probeSensors[] = {
+    {Wire, SHT_MODEL, SHT_ADDRESS, i2cMutex, SHT_REPEATABILITY, &i2cMux, 0}, // Middle shelf
+    {Wire, SHT_MODEL, SHT_ADDRESS, i2cMutex, SHT_REPEATABILITY, &i2cMux, 1}, // Floor
+    {Wire, SHT_MODEL, SHT_ADDRESS, i2cMutex, SHT_REPEATABILITY, &i2cMux, 2}, // Top shelf
+};
+#else
+ShtClimateSensor probeSensors[] = {
+    {Wire, SHT_MODEL, SHT_ADDRESS, i2cMutex, SHT_REPEATABILITY},
+    // {Wire, SHT_MODEL, 0x45, i2cMutex, SHT_REPEATABILITY}, // Second probe with ADDR high
+};
+#endif
+#endif
+#define CLIMATE_PROBES (sizeof(probeSensors) / sizeof(probeSensors[0]))
+
+// Height of each probe above the floor (m), in the order above: gives the vertical gradient
+#if CLIMATE_SENSOR != CLIMATE_SENSOR_DHT22 && SHT_USE_MUX
+const float probeHeights[] = {1.0, 0.2, 1.8};
+#else
+const float probeHeights[] = {1.0};
+#endif
+static_assert(sizeof(probeHeights) / sizeof(probeHeights[0]) == CLIMATE_PROBES, "One height per probe");
+static_assert(CLIMATE_PROBES <= CLIMATE_PROBES_MAX, "Too many climate probes");
+
+Sgp41GasSensor gasSensor(sgp41, i2cMutex);
+Ssd1306Display statusDisplay(display);
+
+// Relay channels: cooling stages in switch-on order (Peltier 1 + pump first,
+// Peltier 4 last), then the humidifier + scrubber
+const uint8_t relayPins[RELAY_CHANNELS] = {PELTIER_1_PUMP_PIN, PELTIER_2_FAN_PIN, PELTIER_3_PIN, PELTIER_4_PIN,
+                                           HUMIDIFIER_SCRUBBER_PIN};
+GpioRelays relays(relayPins);
+
+ClimateControl climate(coolingConfig, relays, defaultThresholds);
+
+// Climate probe averaging + SGP41 / Gas Index schedule (sensor task only, probes added in setup())
+const AcquisitionConfig &acquisitionConfig = CLIMATE_ACQUISITION;
+Acquisition acquisition(acquisitionConfig, systemClock, gasSensor, vocAlgorithm, noxAlgorithm);
+
+// Log the cooling controller's stage decisions (ClimateControl has applied them to the relays)
+void reportCooling()
 {
-  float tempSum = 0.0;
-  float humSum = 0.0;
-  int validReadings = 0;
+  const CoolingController &cooling = climate.cooling();
+  Serial.printf("❄️ Cooling: %u/%u Peltier stages ON (demand %.2f, trend %+.2f°C/min)\n",
+                cooling.activeStages(), COOLING_STAGES, cooling.demand(), cooling.slope() * 60);
+}
 
-  // Take multiple readings
-  for (int i = 0; i < NUM_READINGS; i++)
+// Log a humidifier + scrubber switch (combined on single relay: humidity low OR VOC high)
+void reportHumidifierScrubber(HumidifierEvent event)
+{
+  switch (event)
   {
-    float t = dht.readTemperature();
-    float h = dht.readHumidity();
+  case HUMIDIFIER_ON_BOTH:
+    Serial.println("⚠️ Humidity LOW & VOC HIGH! Humidifier+Scrubber ACTIVATED");
+    break;
+  case HUMIDIFIER_ON_HUMIDITY:
+    Serial.println("💧 Humidity LOW! Humidifier+Scrubber ACTIVATED");
+    break;
+  case HUMIDIFIER_ON_VOC:
+    Serial.println("⚠️ VOC HIGH! Humidifier+Scrubber ACTIVATED");
+    break;
+  case HUMIDIFIER_OFF:
+    Serial.println("✓ Humidity & VOC OK. Humidifier+Scrubber DEACTIVATED");
+    break;
+  default:
+    break;
+  }
+}
 
-    // Check if reading is valid
-    if (!isnan(t) && !isnan(h))
-    {
-      // Additional validation - check if values are in reasonable range
-      if (t >= -40 && t <= 80 && h >= 0 && h <= 100)
-      {
-        tempSum += t;
-        humSum += h;
-        validReadings++;
-      }
-    }
+// Header of a batch POST (format in Telemetry.h); base is the oldest sample still held
+BatchHeader batchHeader(uint32_t oldestSeq, bool replay)
+{
+  BatchHeader header;
+  header.now = millis(); // Lets the server turn sample timestamps into wall-clock time
+  header.stream = spool.ready() ? spool.streamId() : uplinkStream;
+  header.base = spool.ready() ? spool.oldestSeq() : oldestSeq;
+  header.replay = replay;
+  header.spoolDepth = spool.pending();
+  header.spoolOverwritten = spool.overwritten();
+  header.replayed = replayedCount;
+  return header;
+}
 
-    // Wait between readings (DHT22 needs at least 2 seconds)
-    if (i < NUM_READINGS - 1)
-    {
-      delay(2500);
-    }
+// Log a batch POST and take in the server's answer: it carries the highest
+// contiguous sequence number it holds ("ack") and the version of its
+// thresholds ("thresholds"), which changes after a detection
+void handleUplinkResult(uint8_t result, bool replay)
+{
+  if (result & UPLINK_JSON_FALLBACK)
+    Serial.println("⚠️  Server rejected MessagePack (415), falling back to JSON for an hour");
+  if (result & UPLINK_SPLIT)
+    Serial.println("⚠️  Batch too large for one payload, sent in parts");
+  if (result & UPLINK_DROPPED)
+    Serial.println("⚠️  Sample too large for the payload buffer, dropped");
+  if (result & UPLINK_REJECTED)
+    Serial.printf("✗ Server refused %s samples %u-%u (%d), dropped\n", replay ? "spooled" : "live",
+                  uplinkBatcher.rejectedFirst(), uplinkBatcher.rejectedLast(), uplinkBatcher.status());
+
+  if (uplinkBatcher.status() > 0 && !(result & UPLINK_REJECTED))
+  {
+    Serial.printf("✓ %u %s sample(s) sent to server. Response: %d (%lu ms, %u bytes %s)\n",
+                  uplinkBatcher.sentCount(), replay ? "spooled" : "live", uplinkBatcher.status(),
+                  (unsigned long)uplink.stats().lastLatency, uplinkBatcher.sentLength(),
+                  uplinkBatcher.msgpack() ? "msgpack" : "json");
   }
-
-  // Calculate averages if we have valid readings
-  if (validReadings > 0)
+  else if (result & UPLINK_FAILED)
   {
-    avgTemp = (tempSum / validReadings) + TEMP_OFFSET; // Apply temperature calibration
-    avgHum = (humSum / validReadings) + HUM_OFFSET;    // Apply humidity calibration
-
-    // Ensure humidity stays within valid range (0-100%)
-    if (avgHum > 100.0)
-      avgHum = 100.0;
-    if (avgHum < 0.0)
-      avgHum = 0.0;
-
-    failedReadings = 0;
-    return true;
+    Serial.print("✗ Error sending data: ");
+    Serial.println(uplinkBatcher.status());
   }
 
-  failedReadings++;
-  return false;
+  // Release everything the server confirmed
+  if ((result & UPLINK_SENT) && uplinkBatcher.ack().hasAck)
+    spool.acknowledge(uplinkBatcher.ack().ack);
+  if (result & UPLINK_THRESHOLDS)
+    thresholdsChanged = true;
 }
 
-// Simple function to read VOC from SGP41
-uint16_t readSGP41_VOC()
+// Function to send the live batch to the backend API (several POSTs if it doesn't fit one)
+void sendBatchToServer()
 {
-  // SGP41 execute conditioning command: 0x2612
-  Wire.beginTransmission(SGP41_ADDRESS);
-  Wire.write(0x26);
-  Wire.write(0x12);
-  // Add default humidity (50% RH) and temperature (25°C) compensation
-  Wire.write(0x80);
-  Wire.write(0x00);
-  Wire.write(0xA2); // 50% RH
-  Wire.write(0x66);
-  Wire.write(0x66);
-  Wire.write(0x93); // 25°C
-  if (Wire.endTransmission() != 0)
+  if (WiFi.status() != WL_CONNECTED)
   {
-    return 0;
+    Serial.println("✗ WiFi disconnected. Reconnecting...");
+    uplink.disconnect();
+    WiFi.reconnect();
+
+    // Without a spool a failed batch stays put and the ring buffers the rest;
+    // with one, the samples are already on flash and get replayed later
+    if (spool.ready())
+      uplinkBatcher.clear();
+    return;
   }
 
-  delay(50); // Wait for measurement (SGP41 needs 30ms)
+  uint8_t result = uplinkBatcher.flush(batchHeader(uplinkBatcher.oldest().seq, false), !spool.ready());
+  handleUplinkResult(result, false);
+}
 
-  // Read 6 bytes (VOC: 2 bytes + CRC, NOx: 2 bytes + CRC)
-  uint8_t bytesReceived = Wire.requestFrom((uint8_t)SGP41_ADDRESS, (uint8_t)6);
+// Function to replay spooled samples the server hasn't acknowledged, oldest first.
+// Rate-limited to one batch per UPLINK_REPLAY_INTERVAL so live samples still go out on time.
+void replayBacklog()
+{
+  if (!spool.ready() || WiFi.status() != WL_CONNECTED || millis() - lastReplay < UPLINK_REPLAY_INTERVAL)
+    return;
+
+  // Samples still waiting in the live batch go out with it
+  uint32_t lastSeq = !uplinkBatcher.empty() ? uplinkBatcher.oldest().seq - 1 : spool.lastSeq();
+  if (spool.oldestSeq() > lastSeq)
+    return;
+
+  lastReplay = millis();
+  size_t count = spool.read(spool.oldestSeq(), lastSeq, replayBatch, UPLINK_REPLAY_BATCH);
+  if (count == 0)
+    return;
+
+  uint8_t result = uplinkBatcher.send(batchHeader(replayBatch[0].seq, true), replayBatch, count);
+  handleUplinkResult(result, true);
+  if (result & UPLINK_SENT)
+    replayedCount += uplinkBatcher.sentCount();
+
+  // Refused samples are the oldest the spool holds: skip them, the next
+  // batch's base tells the server not to wait for them. (A refused live
+  // batch is left on the spool and gets here once it is replayed.)
+  if (result & UPLINK_REJECTED)
+    spool.acknowledge(uplinkBatcher.rejectedLast());
+}
 
-  if (bytesReceived == 6)
+// Function to fetch updated thresholds from server
+void updateThresholds()
+{
+  if (WiFi.status() == WL_CONNECTED)
   {
-    uint8_t voc_msb = Wire.read();
-    uint8_t voc_lsb = Wire.read();
-    Wire.read(); // CRC for VOC
-    uint8_t nox_msb = Wire.read();
-    uint8_t nox_lsb = Wire.read();
-    Wire.read(); // CRC for NOx
-
-    return (voc_msb << 8) | voc_lsb;
-  }
+    size_t length = 0;
+    int httpResponseCode = uplink.request("GET", thresholdsUrl, NULL,
+                                          uplinkBatcher.msgpack() ? MSGPACK_CONTENT_TYPE ", " JSON_CONTENT_TYPE : JSON_CONTENT_TYPE,
+                                          NULL, 0, thresholdsResponse, sizeof(thresholdsResponse), length);
+
+    if (httpResponseCode == 200)
+    {
+      Thresholds thresholds = climate.thresholds();
+      bool msgpack = uplink.responseContentType().startsWith(MSGPACK_CONTENT_TYPE);
+
+      if (decodeThresholds(thresholdsResponse, length, msgpack, thresholds))
+      {
+        xSemaphoreTake(thresholdsMutex, portMAX_DELAY);
+        climate.setThresholds(thresholds);
+        xSemaphoreGive(thresholdsMutex);
 
-  return 0;
+        Serial.println("✓ Thresholds updated from server:");
+        Serial.printf("  Temperature: %.1f–%.1f°C (optimal %.1f°C)\n",
+                      thresholds.tempMin, thresholds.tempMax, thresholds.tempSetpoint);
+        Serial.printf("  Humidity: %.1f–%.1f%%\n", thresholds.humidityMin, thresholds.humidityMax);
+        Serial.printf("  VOC: %.0f\n", thresholds.vocThreshold);
+      }
+      else
+      {
+        Serial.println("⚠️  Failed to parse threshold data");
+      }
+    }
+  }
 }
 
-// Function to update OLED display
-void updateDisplay()
+// Print a sample and the system status to the Serial Monitor
+void printReadings(const SensorSample &sample)
 {
-  display.clearDisplay();
-  display.setTextSize(2);
-  display.setTextColor(SSD1306_WHITE);
-
-  // Title
-  display.setCursor(0, 0);
-  display.setTextSize(1);
-  display.println("Cold Storage Unit");
-  display.drawLine(0, 10, 128, 10, SSD1306_WHITE);
-
-  // Temperature
-  display.setTextSize(1);
-  display.setCursor(0, 14);
-  display.print("Temp     : ");
-  display.print(temperature, 1);
-  display.print(" C");
-  if (temperature > TEMP_MAX || temperature < TEMP_MIN)
+  const Thresholds &limits = climate.thresholds();
+  Serial.println("--- Sensor Readings ---");
+  Serial.print("Temperature: ");
+  Serial.print(sample.temperature, 1); // Show 1 decimal place
+  Serial.println(" °C");
+
+  Serial.print("Humidity: ");
+  Serial.print(sample.humidity, 1);
+  Serial.println(" %");
+
+  // Probe array: every probe, then the spread across the room
+  if (sample.probeCount > 1)
   {
-    display.print(" !");
+    Serial.print("Probes:");
+    for (uint8_t i = 0; i < sample.probeCount; i++)
+    {
+      if (sample.probeValid & (1 << i))
+        Serial.printf(" %.1f°C/%.1f%%", sample.probeTemperature[i] / 10.0, sample.probeHumidity[i] / 10.0);
+      else
+        Serial.print(" --");
+    }
+    Serial.println();
+    Serial.printf("Spread: %.1f–%.1f°C, %.1f–%.1f%%, gradient %+.2f°C/m\n", sample.temperatureMin,
+                  sample.temperatureMax, sample.humidityMin, sample.humidityMax, sample.temperatureGradient);
   }
 
-  // Humidity
-  display.setCursor(0, 26);
-  display.print("Humidity : ");
-  display.print(humidity, 1);
-  display.print(" %");
-  if (humidity > HUMIDITY_MAX || humidity < HUMIDITY_MIN)
+  if (acquisition.gasReady() && !isnan(sample.vocIndex))
   {
-    display.print(" !");
+    Serial.print("VOC Index: ");
+    Serial.print(sample.vocIndex, 0);
+    Serial.print(" (Threshold: ");
+    Serial.print(limits.vocThreshold, 0);
+    Serial.println(")");
+    Serial.print("NOx Index: ");
+    Serial.println(sample.noxIndex, 0);
   }
 
-  // VOC
-  display.setCursor(0, 38);
-  display.print("Ethyl/VOC: ");
-  display.print(vocRaw / 1000.0, 1);
-  display.print("ppm");
-
-  // Debug: print to serial
-  Serial.printf("VOC Check: vocRaw=%d, threshold=%.0f, show alert=%d\n",
-                vocRaw, VOC_THRESHOLD, (vocRaw > VOC_THRESHOLD));
+  // Display system status
+  Serial.print("Systems: Cooling=");
+  Serial.print(climate.coolingActive() ? "ON" : "OFF");
+  Serial.print(" | Pump=");
+  Serial.print(climate.pumpActive() ? "ON" : "OFF");
+  Serial.print(" | Humidifier+Scrubber=");
+  Serial.println(climate.humidifierScrubberActive() ? "ON" : "OFF");
 
-  if (vocRaw > VOC_THRESHOLD)
+  // Check if temperature is in target range
+  if (sample.temperature >= limits.tempMin && sample.temperature <= limits.tempMax)
   {
-    display.print("!");
+    Serial.println("Status: ✓ Temperature ON TARGET");
+  }
+  else if (sample.temperature < limits.tempMin)
+  {
+    Serial.println("Status: ⚠ Temperature BELOW TARGET");
   }
-
-  // System Status
-  display.setCursor(0, 50);
-  display.print("Status: ");
-  if (coolingActive)
-    display.print("C");
-  else
-    display.print("-");
-  if (pumpActive)
-    display.print("P");
-  else
-    display.print("-");
-  if (humidifierScrubberActive)
-    display.print("H");
   else
-    display.print("-");
+  {
+    Serial.println("Status: ⚠ Temperature ABOVE TARGET");
+  }
 
-  display.display();
+  Serial.println("----------------------\n");
 }
 
-// Function to control cooling system (4 Peltiers + Water Pump + Fans together)
-void controlCooling(float temp)
+// Print the stack high-water mark (minimum free bytes ever) of every task
+void reportStackUsage()
 {
-  if (temp > TEMP_MAX)
+  Serial.println("--- Task Stack High-Water Marks ---");
+  Serial.printf("sensor : %u / %u bytes free (max iteration %lu ms)\n",
+                uxTaskGetStackHighWaterMark(sensorTaskHandle), SENSOR_TASK_STACK, maxSensorIteration);
+  if (acquisition.gasIndexCostMax() > 0)
   {
-    if (!coolingActive)
-    {
-      // Activate all 4 cooling channels simultaneously
-      digitalWrite(PELTIER_1_PUMP_PIN, HIGH); // Peltier 1 + Water Pump (8A)
-      digitalWrite(PELTIER_2_FAN_PIN, HIGH);  // Peltier 2 + All Fans (6.5A)
-      digitalWrite(PELTIER_3_PIN, HIGH);      // Peltier 3 (6A)
-      digitalWrite(PELTIER_4_PIN, HIGH);      // Peltier 4 (6A)
-      coolingActive = true;
-      pumpActive = true;
-      Serial.println("❄️ Temperature HIGH! Cooling system ACTIVATED");
-      Serial.println("   → Peltier 1 + Pump ON (8A)");
-      Serial.println("   → Peltier 2 + Fans ON (6.5A)");
-      Serial.println("   → Peltier 3 ON (6A)");
-      Serial.println("   → Peltier 4 ON (6A)");
-    }
-  }
-  else if (temp < TEMP_MIN)
-  {
-    if (coolingActive)
-    {
-      // Deactivate entire cooling system
-      digitalWrite(PELTIER_1_PUMP_PIN, LOW);
-      digitalWrite(PELTIER_2_FAN_PIN, LOW);
-      digitalWrite(PELTIER_3_PIN, LOW);
-      digitalWrite(PELTIER_4_PIN, LOW);
-      coolingActive = false;
-      pumpActive = false;
-      Serial.println("✓ Temperature OK. Cooling system DEACTIVATED (all components off)");
-    }
+    Serial.printf("         Gas Index cost: avg %lu us, max %lu us per sample\n",
+                  (unsigned long)acquisition.gasIndexCostAverage(), (unsigned long)acquisition.gasIndexCostMax());
   }
+  Serial.printf("         %s x%u: %.1f reads/s, latency avg %lu us, max %lu us\n", CLIMATE_SENSOR_NAME,
+                acquisition.probeCount(), acquisition.climateReads() * 1000.0 / STACK_REPORT_INTERVAL,
+                (unsigned long)acquisition.climateReadLatencyAverage(),
+                (unsigned long)acquisition.climateReadLatencyMax());
+  const CoolingController &cooling = climate.cooling();
+  Serial.printf("control: %u / %u bytes free (relay cycles %u/%u/%u/%u)\n",
+                uxTaskGetStackHighWaterMark(controlTaskHandle), CONTROL_TASK_STACK,
+                cooling.stageCycles(0), cooling.stageCycles(1), cooling.stageCycles(2), cooling.stageCycles(3));
+  Serial.printf("uplink : %u / %u bytes free (ring %u/%u, %u dropped)\n",
+                uxTaskGetStackHighWaterMark(uplinkTaskHandle), UPLINK_TASK_STACK,
+                sampleRing.size(), sampleRing.capacity(), sampleRing.dropped());
+  const UplinkStats &http = uplink.stats();
+  Serial.printf("         HTTP: %u requests, %.0f%% reused, %u reconnects, %u failed, latency avg %u / max %u ms\n",
+                http.requests, uplink.reuseRatio() * 100, http.reconnects, http.failures,
+                uplink.averageLatency(), http.maxLatency);
+  const UplinkBatchStats &batches = uplinkBatcher.stats();
+  Serial.printf("         Batches: %u POSTs (%u split, %u samples dropped, %u refused), payload avg %u / max %u bytes\n",
+                batches.posts, batches.split, batches.dropped, batches.rejected,
+                batches.posts > 0 ? batches.payloadTotal / batches.posts : 0, batches.payloadMax);
+  static uint32_t lastReplayed = 0;
+  Serial.printf("         Spool: %u/%u pending (seq %u, acked %u), %u overwritten, replayed %u/min\n",
+                spool.pending(), spool.capacity(), spool.lastSeq(), spool.ackedSeq(), spool.overwritten(),
+                (replayedCount - lastReplayed) * 60000 / STACK_REPORT_INTERVAL);
+  lastReplayed = replayedCount;
+  Serial.printf("display: %u / %u bytes free\n",
+                uxTaskGetStackHighWaterMark(displayTaskHandle), DISPLAY_TASK_STACK);
+  Serial.println("-----------------------------------\n");
+  maxSensorIteration = 0;
+  acquisition.resetCost();
 }
 
-// Function to control humidifier + scrubber (combined on single relay)
-// Activates when EITHER humidity is low OR VOC is high
-void controlHumidifierScrubber(float hum, float vocLevel)
+// Persist the learned Gas Index baselines so a reboot doesn't restart learning
+void saveGasIndexState()
 {
-  bool shouldActivate = (hum < HUMIDITY_MIN) || (vocLevel > VOC_THRESHOLD);
+  fix16_t vocMean, vocStd, noxMean, noxStd;
+  vocAlgorithm.getStates(vocMean, vocStd);
+  noxAlgorithm.getStates(noxMean, noxStd);
+
+  gasIndexStore.putInt("vocMean", vocMean);
+  gasIndexStore.putInt("vocStd", vocStd);
+  gasIndexStore.putInt("noxMean", noxMean);
+  gasIndexStore.putInt("noxStd", noxStd);
+  gasIndexStore.putBool("valid", true);
+  Serial.println("✓ Gas Index baseline saved to NVS");
+}
 
-  if (shouldActivate)
-  {
-    if (!humidifierScrubberActive)
-    {
-      digitalWrite(HUMIDIFIER_SCRUBBER_PIN, HIGH);
-      humidifierScrubberActive = true;
-      if (hum < HUMIDITY_MIN && vocLevel > VOC_THRESHOLD)
-        Serial.println("⚠️ Humidity LOW & VOC HIGH! Humidifier+Scrubber ACTIVATED");
-      else if (hum < HUMIDITY_MIN)
-        Serial.println("💧 Humidity LOW! Humidifier+Scrubber ACTIVATED");
-      else
-        Serial.println("⚠️ VOC HIGH! Humidifier+Scrubber ACTIVATED");
-    }
-  }
-  else
+// Restore the Gas Index baselines saved by saveGasIndexState()
+void restoreGasIndexState()
+{
+  if (!gasIndexStore.getBool("valid", false))
   {
-    // Turn off only when both conditions are OK
-    if (humidifierScrubberActive && hum > HUMIDITY_MAX && vocLevel < (VOC_THRESHOLD * 0.8))
-    {
-      digitalWrite(HUMIDIFIER_SCRUBBER_PIN, LOW);
-      humidifierScrubberActive = false;
-      Serial.println("✓ Humidity & VOC OK. Humidifier+Scrubber DEACTIVATED");
-    }
+    Serial.println("No saved Gas Index baseline, learning from scratch (~12 h)");
+    return;
   }
+
+  vocAlgorithm.setStates(gasIndexStore.getInt("vocMean"), gasIndexStore.getInt("vocStd"));
+  noxAlgorithm.setStates(gasIndexStore.getInt("noxMean"), gasIndexStore.getInt("noxStd"));
+  Serial.println("✓ Gas Index baseline restored from NVS");
 }
 
-// Function to send data to backend API
-void sendDataToServer(float temp, float hum, float voc)
+// Publish a sample to the control and display tasks, and to the uplink task when due
+void publishSample(const SensorSample &sample, bool uplinkDue)
 {
-  if (WiFi.status() == WL_CONNECTED)
+  xQueueOverwrite(controlQueue, &sample);
+  xQueueOverwrite(displayQueue, &sample);
+
+  if (uplinkDue)
   {
-    HTTPClient http;
-    http.begin(serverUrl);
-    http.addHeader("Content-Type", "application/json");
+    sampleRing.push(sample);
+    xTaskNotifyGive(uplinkTaskHandle);
+  }
+}
 
-    // Create JSON payload
-    StaticJsonDocument<200> doc;
-    doc["temperature"]["value"] = temp;
-    doc["humidity"]["value"] = hum;
-    doc["vocs"]["value"] = voc; // VOC index value (also used for ethylene monitoring)
-    doc["timestamp"] = millis();
+#if CLIMATE_SENSOR == CLIMATE_SENSOR_DHT22 && DHT_USE_RMT
+// DHT22 frame decoded (sensor task context): say why a read failed; context is the probe index
+void dhtReadComplete(Dht22Status status, float temperature, float humidity, void *context)
+{
+  uintptr_t probe = (uintptr_t)context;
+  if (status == DHT22_TIMEOUT)
+    Serial.printf("⚠ DHT22 probe %u did not answer the start signal\n", probe + 1);
+  else if (status == DHT22_FRAME_ERROR)
+    Serial.printf("⚠ DHT22 probe %u frame incomplete\n", probe + 1);
+  else if (status == DHT22_CHECKSUM_ERROR)
+    Serial.printf("⚠ DHT22 probe %u checksum error (%u so far)\n", probe + 1,
+                  probeSensors[probe].driver().checksumErrorCount());
+}
+#endif
 
-    String jsonString;
-    serializeJson(doc, jsonString);
+// Sensor task: runs the climate probe + SGP41 acquisition schedule (APP core)
+void sensorTask(void *param)
+{
+  SensorSample sample;
+  TickType_t lastWake = xTaskGetTickCount();
 
-    // Send POST request
-    int httpResponseCode = http.POST(jsonString);
+  for (;;)
+  {
+    unsigned long iterationStart = millis();
+    uint8_t events = acquisition.poll(sample);
 
-    if (httpResponseCode > 0)
+    if (events & ACQ_CLIMATE_FAILED)
     {
-      Serial.print("✓ Data sent to server. Response: ");
-      Serial.println(httpResponseCode);
+      for (uint8_t i = 0; i < acquisition.probeCount(); i++)
+      {
+        if (acquisition.probeFailures(i) > 0)
+          Serial.printf("ERROR: Failed to read from %s probe %u! (Attempt %d)\n", CLIMATE_SENSOR_NAME, i + 1,
+                        acquisition.probeFailures(i));
+      }
     }
-    else
+    if (events & ACQ_SENSOR_FAULT)
     {
-      Serial.print("✗ Error sending data: ");
-      Serial.println(httpResponseCode);
+      Serial.println("⚠ Check sensor wiring and power supply!");
+      Serial.println("⚠ Ensure 10K pull-up resistor is connected\n");
     }
-
-    http.end();
-  }
-  else
-  {
-    Serial.println("✗ WiFi disconnected. Reconnecting...");
-    WiFi.reconnect();
+    else if (events & ACQ_PROBE_FAULT)
+    {
+      for (uint8_t i = 0; i < acquisition.probeCount(); i++)
+      {
+        if (acquisition.probeFailures(i) == acquisitionConfig.averaging)
+          Serial.printf("⚠ %s probe %u left the room average, check its wiring\n", CLIMATE_SENSOR_NAME, i + 1);
+      }
+    }
+    if (events & ACQ_GAS_COMMAND_FAILED)
+      Serial.println("⚠ VOC sensor command failed");
+    if (events & ACQ_GAS_READ_FAILED)
+      Serial.printf("⚠ VOC sensor reading failed (%s)\n",
+                    acquisition.gasStatus() == GAS_CRC_ERROR ? "CRC error" : "I2C error");
+    if (events & ACQ_SAVE_BASELINE)
+      saveGasIndexState();
+    if (events & ACQ_SAMPLE)
+      publishSample(sample, events & ACQ_UPLINK);
+
+    unsigned long iteration = millis() - iterationStart;
+    if (iteration > maxSensorIteration)
+      maxSensorIteration = iteration;
+
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_TICK));
   }
 }
 
-// Function to fetch updated thresholds from server
-void updateThresholds()
+// Control task: feeds new samples to the controllers and makes the relay
+// switching decision at a fixed tick, independent of the sensor cadence (APP core)
+void controlTask(void *param)
 {
-  if (WiFi.status() == WL_CONNECTED)
+  SensorSample sample;
+  TickType_t lastWake = xTaskGetTickCount();
+
+  for (;;)
   {
-    HTTPClient http;
-    http.begin(thresholdsUrl);
+    HumidifierEvent humidifier = HUMIDIFIER_UNCHANGED;
+    xSemaphoreTake(thresholdsMutex, portMAX_DELAY);
+    if (xQueueReceive(controlQueue, &sample, 0) == pdTRUE)
+      humidifier = climate.update(sample);
+    bool coolingChanged = climate.tick(millis());
+    xSemaphoreGive(thresholdsMutex);
+
+    reportHumidifierScrubber(humidifier);
+    if (coolingChanged)
+      reportCooling();
+
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(CONTROL_TICK));
+  }
+}
 
-    int httpResponseCode = http.GET();
+// Uplink task: HTTP traffic and WiFi supervision (PRO core)
+void uplinkTask(void *param)
+{
+  SensorSample sample;
+  unsigned long lastThresholdUpdate = millis() - THRESHOLD_UPDATE_INTERVAL;
+  unsigned long lastWifiCheck = millis();
 
-    if (httpResponseCode == 200)
+  for (;;)
+  {
+    // Update thresholds periodically, or right away when the server has new ones
+    if (thresholdsChanged || millis() - lastThresholdUpdate >= THRESHOLD_UPDATE_INTERVAL)
     {
-      String payload = http.getString();
-      StaticJsonDocument<256> doc;
-      DeserializationError error = deserializeJson(doc, payload);
+      updateThresholds();
+      thresholdsChanged = false;
+      lastThresholdUpdate = millis();
+    }
 
-      if (!error)
+    // Wait for the sensor task to push something (or the next replay slot while
+    // there is a backlog), then spool it and move it into the batch
+    bool backlog = spool.pending() > uplinkBatcher.size();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(backlog ? UPLINK_REPLAY_INTERVAL : WIFI_CHECK_INTERVAL));
+    while (!uplinkBatcher.full() && sampleRing.pop(sample))
+    {
+      if (spool.ready())
       {
-        // Update temperature thresholds
-        if (doc.containsKey("temperature"))
-        {
-          TEMP_MIN = doc["temperature"]["min"];
-          TEMP_MAX = doc["temperature"]["max"];
-        }
-
-        // Update humidity thresholds
-        if (doc.containsKey("humidity"))
-        {
-          HUMIDITY_MIN = doc["humidity"]["min"];
-          HUMIDITY_MAX = doc["humidity"]["max"];
-        }
-
-        // Update VOC threshold
-        if (doc.containsKey("voc"))
-        {
-          VOC_THRESHOLD = doc["voc"];
-        }
-
-        Serial.println("✓ Thresholds updated from server:");
-        Serial.printf("  Temperature: %.1f–%.1f°C\n", TEMP_MIN, TEMP_MAX);
-        Serial.printf("  Humidity: %.1f–%.1f%%\n", HUMIDITY_MIN, HUMIDITY_MAX);
-        Serial.printf("  VOC: %.0f\n", VOC_THRESHOLD);
+        sample.seq = spool.nextSeq();
+        if (!spool.append(sample.seq, &sample))
+          Serial.println("⚠️  Failed to spool sample");
       }
       else
       {
-        Serial.println("⚠️  Failed to parse threshold data");
+        sample.seq = ++uplinkSeq;
       }
+
+      printReadings(sample);
+      uplinkBatcher.add(sample, climate.alert(sample));
     }
 
-    http.end();
+    // Alerts at once, small batches while something is out of range, large ones when steady
+    if (uplinkBatcher.due(millis()))
+      sendBatchToServer();
+
+    replayBacklog();
+
+    // Keep WiFi alive without blocking
+    if (millis() - lastWifiCheck >= WIFI_CHECK_INTERVAL)
+    {
+      lastWifiCheck = millis();
+      if (WiFi.status() != WL_CONNECTED)
+      {
+        Serial.println("✗ WiFi disconnected. Reconnecting...");
+        uplink.disconnect();
+        WiFi.reconnect();
+      }
+    }
+  }
+}
+
+// Display task: redraws the OLED from the latest sample (PRO core)
+void displayTask(void *param)
+{
+  SensorSample sample;
+  TickType_t lastWake = xTaskGetTickCount();
+
+  for (;;)
+  {
+    xSemaphoreTake(i2cMutex, portMAX_DELAY);
+    if (acquisition.sensorFault())
+    {
+      statusDisplay.showSensorError(acquisition.failedReadings());
+    }
+    else if (xQueuePeek(displayQueue, &sample, 0) == pdTRUE)
+    {
+      const Thresholds &limits = climate.thresholds();
+      DisplayState state;
+      state.temperature = sample.temperature;
+      state.humidity = sample.humidity;
+      state.vocIndex = sample.vocIndex;
+      state.temperatureAlarm = sample.temperatureMax > limits.tempMax || sample.temperatureMin < limits.tempMin;
+      state.humidityAlarm = sample.humidityMax > limits.humidityMax || sample.humidityMin < limits.humidityMin;
+      state.vocAlarm = sample.vocIndex > limits.vocThreshold;
+      state.cooling = climate.coolingActive();
+      state.pump = climate.pumpActive();
+      state.humidifierScrubber = climate.humidifierScrubberActive();
+      statusDisplay.showReadings(state);
+    }
+    xSemaphoreGive(i2cMutex);
+
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(DISPLAY_INTERVAL));
   }
 }
 
@@ -467,18 +790,13 @@ void setup()
     Serial.println("Check SSID and password");
   }
 
-  // Initialize relay pins
-  pinMode(PELTIER_1_PUMP_PIN, OUTPUT);      // 4-CH Relay 1
-  pinMode(PELTIER_2_FAN_PIN, OUTPUT);       // 4-CH Relay 2
-  pinMode(PELTIER_3_PIN, OUTPUT);           // 4-CH Relay 3
-  pinMode(PELTIER_4_PIN, OUTPUT);           // 4-CH Relay 4
-  pinMode(HUMIDIFIER_SCRUBBER_PIN, OUTPUT); // Single Relay
+  // Wall-clock time for spooled samples (syncs in the background, also after a late WiFi connect)
+  configTime(0, 0, "pool.ntp.org");
 
-  digitalWrite(PELTIER_1_PUMP_PIN, LOW);      // Start with peltier 1 + pump off
-  digitalWrite(PELTIER_2_FAN_PIN, LOW);       // Start with peltier 2 + fans off
-  digitalWrite(PELTIER_3_PIN, LOW);           // Start with peltier 3 off
-  digitalWrite(PELTIER_4_PIN, LOW);           // Start with peltier 4 off
-  digitalWrite(HUMIDIFIER_SCRUBBER_PIN, LOW); // Start with humidifier+scrubber off
+  // Initialize relay pins, everything off
+  relays.begin();
+  climate.begin();
+  climate.setTarget(CONTROL_TARGET);
 
   Serial.println("\n=== RELAY CONFIGURATION (5 channels total) ===");
   Serial.println("Single Relay Module (1 channel):");
@@ -489,11 +807,13 @@ void setup()
   Serial.println("  • CH3 (GPIO 23): Peltier 3 (6A) ✓");
   Serial.println("  • CH4 (GPIO 25): Peltier 4 (6A) ✓");
   Serial.println("\nTotal cooling load: 26.5A (all channels under 10A) ✓");
+  Serial.println("Cooling stages switch on one at a time (CH1 -> CH4), never all at once");
   Serial.println("Note: Humidifier+Scrubber share single relay (activate together)");
   Serial.println("============================================\n");
 
-  // Initialize I2C for SGP41
+  // Initialize I2C for SGP41 (and the SHT4x/SHT3x); the bus lock exists before any driver uses it
   Wire.begin();
+  i2cMutex = xSemaphoreCreateMutexStatic(&i2cMutexBuffer);
   Serial.println("I2C bus initialized");
 
   // Scan I2C bus to find devices FIRST
@@ -523,7 +843,10 @@ void setup()
       else if (address == SGP41_ADDRESS)
       {
         Serial.println("  -> Detected SGP41 VOC Sensor");
-        sgpReady = true;
+      }
+      else if (address >= TCA9548A_DEFAULT_ADDRESS && address <= TCA9548A_DEFAULT_ADDRESS + 7)
+      {
+        Serial.println("  -> Detected TCA9548A I2C mux");
       }
     }
   }
@@ -543,7 +866,8 @@ void setup()
   Serial.print("Initializing OLED at 0x");
   Serial.println(oledAddress, HEX);
 
-  if (!display.begin(SSD1306_SWITCHCAPVCC, oledAddress))
+  statusDisplay.setAddress(oledAddress);
+  if (!statusDisplay.begin())
   {
     Serial.println("✗ OLED display initialization FAILED!");
     Serial.println("  Check wiring: VCC->3.3V, GND->GND, SCL->GPIO22, SDA->GPIO21");
@@ -566,125 +890,97 @@ void setup()
 
   // Continue with sensor initialization
 
-  // Initialize DHT sensor
-  dht.begin();
-  Serial.println("DHT22 sensor initialized");
+  // Initialize the temperature/humidity probes
+#if CLIMATE_SENSOR != CLIMATE_SENSOR_DHT22 && SHT_USE_MUX
+  if (!i2cMux.begin())
+    Serial.printf("⚠ TCA9548A I2C mux not responding at 0x%02X\n", MUX_ADDRESS);
+#endif
+  for (uint8_t i = 0; i < CLIMATE_PROBES; i++)
+  {
+    acquisition.addProbe(probeSensors[i], probeHeights[i]);
+#if CLIMATE_SENSOR != CLIMATE_SENSOR_DHT22
+    if (probeSensors[i].begin())
+      Serial.printf("%s probe %u initialized at %.1f m (serial %08X)\n", CLIMATE_SENSOR_NAME, i + 1, probeHeights[i],
+                    probeSensors[i].driver().serialNumber());
+    else
+      Serial.printf("⚠ %s probe %u not responding\n", CLIMATE_SENSOR_NAME, i + 1);
+#elif DHT_USE_RMT
+    probeSensors[i].driver().onComplete(dhtReadComplete, (void *)(uintptr_t)i);
+    if (probeSensors[i].begin())
+      Serial.printf("DHT22 probe %u initialized at %.1f m (RMT capture)\n", i + 1, probeHeights[i]);
+    else
+      Serial.printf("⚠ DHT22 probe %u RMT channel setup failed\n", i + 1);
+#else
+    probeSensors[i].begin();
+    Serial.printf("DHT22 probe %u initialized at %.1f m\n", i + 1, probeHeights[i]);
+#endif
+  }
+#if CLIMATE_SENSOR != CLIMATE_SENSOR_DHT22
+  Serial.printf("%s: %lu ms interval, %u-reading average + %lu ms low-pass\n", CLIMATE_SENSOR_NAME,
+                acquisitionConfig.climateInterval, acquisitionConfig.averaging, acquisitionConfig.filterTimeConstant);
+#endif
+  if (CLIMATE_PROBES > 1)
+    Serial.printf("%u probes read together, control on the %s\n", CLIMATE_PROBES,
+                  CONTROL_TARGET == CONTROL_TARGET_WORST ? "worst-case probe" : "room average");
   Serial.println("Waiting for sensors to stabilize...\n");
   delay(3000);
 
   // Perform initial reading to clear any errors
-  dht.readTemperature();
-  dht.readHumidity();
+  float t, h;
+  for (uint8_t i = 0; i < CLIMATE_PROBES; i++)
+    probeSensors[i].read(t, h);
   delay(2000);
-}
 
-void loop()
-{
-  // Update thresholds periodically
-  if (millis() - lastThresholdUpdate >= THRESHOLD_UPDATE_INTERVAL)
+  // Initialize SGP41 (reading the serial number also checks the CRC path)
+  bool sgpReady = gasSensor.begin();
+  if (sgpReady)
   {
-    updateThresholds();
-    lastThresholdUpdate = millis();
+    gasIndexStore.begin("gasindex", false);
+    restoreGasIndexState();
+    Serial.printf("SGP41 sensor initialized (serial %04X%08X)\n",
+                  (uint32_t)(gasSensor.serialNumber() >> 32), (uint32_t)gasSensor.serialNumber());
+    Serial.println("SGP41 conditioning for 10 seconds...\n");
   }
-
-  // Get averaged readings
-  if (getAveragedReadings(temperature, humidity))
+  else
   {
-    // Read VOC sensor if available
-    if (sgpReady)
-    {
-      vocRaw = readSGP41_VOC();
-
-      if (vocRaw > 0)
-      {
-        // Use raw value directly (typical clean air: 20000-30000)
-        vocIndex = (float)vocRaw;
-      }
-      else
-      {
-        Serial.println("⚠ VOC sensor reading failed");
-      }
-    }
-
-    // Control all systems
-    controlCooling(temperature);
-    controlHumidifierScrubber(humidity, vocIndex);
-
-    // Display readings on Serial Monitor
-    Serial.println("--- Sensor Readings ---");
-    Serial.print("Temperature: ");
-    Serial.print(temperature, 1); // Show 1 decimal place
-    Serial.println(" °C");
-
-    Serial.print("Humidity: ");
-    Serial.print(humidity, 1);
-    Serial.println(" %");
-
-    if (sgpReady && !isnan(vocIndex))
-    {
-      Serial.print("VOC Index: ");
-      Serial.print(vocIndex, 0);
-      Serial.print(" (Threshold: ");
-      Serial.print(VOC_THRESHOLD, 0);
-      Serial.println(")");
-    }
-
-    // Display system status
-    Serial.print("Systems: Cooling=");
-    Serial.print(coolingActive ? "ON" : "OFF");
-    Serial.print(" | Pump=");
-    Serial.print(pumpActive ? "ON" : "OFF");
-    Serial.print(" | Humidifier+Scrubber=");
-    Serial.println(humidifierScrubberActive ? "ON" : "OFF");
-
-    // Check if temperature is in target range
-    if (temperature >= TEMP_MIN && temperature <= TEMP_MAX)
-    {
-      Serial.println("Status: ✓ Temperature ON TARGET");
-    }
-    else if (temperature < TEMP_MIN)
-    {
-      Serial.println("Status: ⚠ Temperature BELOW TARGET");
-    }
-    else
-    {
-      Serial.println("Status: ⚠ Temperature ABOVE TARGET");
-    }
-
-    // Send data to web dashboard
-    sendDataToServer(temperature, humidity, sgpReady ? vocIndex : 0.0);
+    Serial.println("⚠ SGP41 not responding, VOC/NOx disabled\n");
+  }
 
-    // Update OLED display
-    updateDisplay();
+  // Conditioning starts now; the first climate sample is taken as soon as the sensor task starts
+  acquisition.begin(sgpReady);
 
-    Serial.println("----------------------\n");
+  // Offline telemetry spool (formats the partition on first use)
+  if (LittleFS.begin(true) && spool.begin())
+  {
+    Serial.printf("✓ Telemetry spool ready: %u samples pending, next seq %u\n", spool.pending(), spool.nextSeq());
   }
   else
   {
-    Serial.print("ERROR: Failed to read from DHT sensor! (Attempt ");
-    Serial.print(failedReadings);
-    Serial.println(")");
-
-    if (failedReadings >= 3)
-    {
-      Serial.println("⚠ Check sensor wiring and power supply!");
-      Serial.println("⚠ Ensure 10K pull-up resistor is connected\n");
-    }
-
-    // Update display with error message
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
-    display.setCursor(0, 0);
-    display.println("Cold Storage Unit");
-    display.setCursor(0, 20);
-    display.println("ERROR: Sensor fail!");
-    display.setCursor(0, 30);
-    display.print("Attempts: ");
-    display.println(failedReadings);
-    display.display();
+    uplinkStream = esp_random() | 1;
+    Serial.println("✗ Telemetry spool unavailable, samples are lost while offline");
   }
 
-  // Wait before next reading cycle
-  delay(10000); // 10 seconds between cycles
+  // Create queues, mutexes and tasks (all statically allocated)
+  controlQueue = xQueueCreateStatic(1, sizeof(SensorSample), controlQueueStorage, &controlQueueBuffer);
+  displayQueue = xQueueCreateStatic(1, sizeof(SensorSample), displayQueueStorage, &displayQueueBuffer);
+  thresholdsMutex = xSemaphoreCreateMutexStatic(&thresholdsMutexBuffer);
+
+  // Consumers first, so the sensor task never notifies a task that doesn't exist yet
+  uplinkTaskHandle = xTaskCreateStaticPinnedToCore(uplinkTask, "uplink", UPLINK_TASK_STACK, NULL,
+                                                   UPLINK_TASK_PRIORITY, uplinkTaskStack, &uplinkTaskBuffer, PRO_CPU_NUM);
+  displayTaskHandle = xTaskCreateStaticPinnedToCore(displayTask, "display", DISPLAY_TASK_STACK, NULL,
+                                                    DISPLAY_TASK_PRIORITY, displayTaskStack, &displayTaskBuffer, PRO_CPU_NUM);
+  controlTaskHandle = xTaskCreateStaticPinnedToCore(controlTask, "control", CONTROL_TASK_STACK, NULL,
+                                                    CONTROL_TASK_PRIORITY, controlTaskStack, &controlTaskBuffer, APP_CPU_NUM);
+  sensorTaskHandle = xTaskCreateStaticPinnedToCore(sensorTask, "sensor", SENSOR_TASK_STACK, NULL,
+                                                   SENSOR_TASK_PRIORITY, sensorTaskStack, &sensorTaskBuffer, APP_CPU_NUM);
+
+  Serial.println("✓ Tasks started (sensor+control on core 1, uplink+display on core 0)\n");
+}
+
+void loop()
+{
+  // All work happens in the FreeRTOS tasks; loop() only reports stack usage
+  reportStackUsage();
+  vTaskDelay(pdMS_TO_TICKS(STACK_REPORT_INTERVAL));
 }
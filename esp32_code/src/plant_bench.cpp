@@ -0,0 +1,357 @@
+/*
+ * Closed-loop benchmark of the climate control against the thermal plant (env:plant_bench)
+ *
+ * For each produce profile, loads the unit with warm produce and runs the
+ * firmware's Acquisition (climate sensor averaging) and ClimateControl (staged cooling,
+ * humidifier + scrubber) against ThermalPlant on a virtual clock, with the
+ * door opened on a fixed schedule. Reports, from the plant's true air
+ * temperature and humidity once the first pull-down is done:
+ *
+ *   - time in band (temperature and humidity within the produce's range,
+ *     on every shelf when the room is stratified)
+ *   - overshoot above the maximum / undershoot below the minimum
+ *   - relay switch-ons per day for each channel
+ *   - energy per day from the relays' on-time and rated power
+ *
+ * and the same for the all-four-on/all-four-off bang-bang cooling the staged
+ * controller replaced, to check it against.
+ *
+ *   pio run -e plant_bench
+ *   .pio/build/plant_bench/program [-d days] [-p profile] [-b dht|sht] [-a ambientC] [-o doorEveryH]
+ *                                  [-s doorOpenS] [-g stratificationC/m] [-t mean|worst] [-m staged|bangbang] [-c]
+ *
+ * -b picks the climate sensor backend as main.cpp configures it: DHT22 (2.5 s,
+ * 3-reading average) or SHT4x (10 Hz, 8-reading average + 5 s low-pass).
+ * -g makes the room warmer towards the top by that many °C per m around the
+ * plant's (mid-height) air temperature and fits probes on the floor, middle
+ * and top shelf; -t picks whether the control follows their mean or the
+ * worst-case probes (default, as in main.cpp).
+ * -m bangbang runs only the old cooling (all four stages on above the maximum,
+ * off below the minimum, on the mean temperature of each sample).
+ * -c prints one CSV line per profile for tracking the numbers across changes
+ * (staged cooling unless -m bangbang).
+ * Thresholds match web/produceDatabase.js, control settings are the
+ * firmware's (ControllerConfig.h).
+ * The gas sensor isn't simulated: the scrubber only follows humidity.
+ */
+
+#include "Acquisition.h"
+#include "ClimateControl.h"
+#include "ControllerConfig.h"
+#include "GasIndexAlgorithm.h"
+#include "SimHal.h"
+#include "ThermalPlant.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define SIM_TICK_MS 100 // Plant step and scheduler tick
+
+// Rated power per relay channel (RELAY_WIRING_5_CHANNEL.md), W
+const float relayPower[RELAY_CHANNELS] = {
+    96, // Peltier 1 + water pump
+    78, // Peltier 2 + fans
+    72, // Peltier 3
+    72, // Peltier 4
+    48, // Humidifier + scrubber
+};
+
+// Probe heights (m): one in the middle, or floor/middle/top shelf in a stratified room
+#define PLANT_NODE_HEIGHT 1.0 // Where ThermalPlant's air temperature applies
+const float stratifiedHeights[] = {0.2, 1.0, 1.8};
+#define STRATIFIED_PROBES (sizeof(stratifiedHeights) / sizeof(stratifiedHeights[0]))
+
+// A ~0.5 m³ unit with 60 kg of produce
+const PlantConfig basePlant = {
+    0.5,     // airVolume
+    15000,   // airHeatCapacity
+    2.5,     // wallConductance
+    0.0003,  // leakageFlow
+    0.05,    // doorFlow
+    60,      // produceMass
+    3600,    // produceHeatCapacity
+    15,      // produceCoupling
+    0.010,   // respiration (overridden per profile)
+    0.0003,  // transpiration
+    30,      // stageCooling
+    8,       // coldPlateOffset
+    0.001,   // coldPlateFlow
+    0.01,    // humidifierRate
+};
+
+struct ProduceProfile
+{
+  const char *name;
+  Thresholds thresholds;
+  float respiration; // W/kg at 5 °C
+};
+
+const ProduceProfile profiles[] = {
+    {"apples", {250, 0, 4, 2, 90, 95}, 0.010},
+    {"potatoes", {250, 7, 10, 8, 85, 90}, 0.012},
+    {"mixed", {220, 2, 8, 5, 85, 95}, 0.020},
+};
+const size_t profileCount = sizeof(profiles) / sizeof(profiles[0]);
+
+struct RunResult
+{
+  double pullDownH;   // Until the air first reaches the band
+  double inBand;      // Share of the time after pull-down, temperature
+  double humidityInBand;
+  float overshoot;    // Highest excursion above the maximum, °C
+  float undershoot;   // ... below the minimum
+  double meanError;   // Mean |air - setpoint| after pull-down
+  double switchOnsPerDay[RELAY_CHANNELS];
+  double energyWhPerDay[RELAY_CHANNELS];
+  double wallS;
+};
+
+struct RunOptions
+{
+  double days;
+  float ambient;
+  float ambientHumidity;
+  double doorEveryH; // 0 = never
+  uint32_t doorOpenS;
+  bool sht;          // SHT4x backend instead of the DHT22
+  float stratification; // °C per m of height, 0 = well-mixed room with a single probe
+  bool worst;        // Control on the worst-case probe instead of the mean
+  bool bangBang;     // All-four-on/all-four-off cooling instead of the staged controller
+};
+
+RunResult run(const ProduceProfile &profile, const RunOptions &options)
+{
+  PlantConfig plantConfig = basePlant;
+  plantConfig.respiration = profile.respiration;
+  ThermalPlant plant(plantConfig);
+  plant.setAmbient(options.ambient, options.ambientHumidity);
+  plant.reset(options.ambient, options.ambientHumidity);
+
+  SimClock clock;
+  uint8_t probes = options.stratification > 0 ? STRATIFIED_PROBES : 1;
+  SimClimateSensor probeSensors[STRATIFIED_PROBES];
+  float probeHeights[STRATIFIED_PROBES];
+  for (uint8_t i = 0; i < probes; i++)
+  {
+    probeSensors[i] = SimClimateSensor(i + 1);
+    probeHeights[i] = probes > 1 ? stratifiedHeights[i] : PLANT_NODE_HEIGHT;
+    if (options.sht)
+    {
+      probeSensors[i].setNoise(0.04, 0.08); // SHT4x high repeatability
+      probeSensors[i].setResolution(0.01);
+    }
+    else
+    {
+      probeSensors[i].setNoise(0.1, 0.5);
+    }
+  }
+  SimGasSensor gasSensor(clock);
+  SimRelays relays(clock);
+  GasIndexAlgorithm vocAlgorithm(GAS_INDEX_VOC);
+  GasIndexAlgorithm noxAlgorithm(GAS_INDEX_NOX);
+  ClimateControl climate(coolingConfig, relays, profile.thresholds);
+  Acquisition acquisition(options.sht ? shtAcquisitionConfig : dhtAcquisitionConfig, clock, gasSensor, vocAlgorithm, noxAlgorithm);
+  for (uint8_t i = 0; i < probes; i++)
+    acquisition.addProbe(probeSensors[i], probeHeights[i]);
+
+  climate.begin();
+  climate.setTarget(options.worst ? CONTROL_TARGET_WORST : CONTROL_TARGET_MEAN);
+  acquisition.begin(false);
+
+  const Thresholds &limits = profile.thresholds;
+  const uint64_t simulatedMs = (uint64_t)(options.days * 86400000.0);
+  const uint64_t doorEveryMs = (uint64_t)(options.doorEveryH * 3600000.0);
+  unsigned long lastControl = 0;
+
+  RunResult result = {};
+  bool pulledDown = false;
+  uint64_t pullDownMs = 0, settledTicks = 0, inBandTicks = 0, humidityTicks = 0;
+  double errorSum = 0;
+
+  auto started = std::chrono::steady_clock::now();
+  for (uint64_t elapsed = 0; elapsed < simulatedMs; elapsed += SIM_TICK_MS)
+  {
+    clock.advance(SIM_TICK_MS);
+    unsigned long now = clock.millis();
+
+    uint8_t stages = 0;
+    for (uint8_t i = 0; i < COOLING_STAGES; i++)
+      stages += relays.isOn(RELAY_COOLING_FIRST + i);
+    plant.setDoorOpen(doorEveryMs > 0 && elapsed >= doorEveryMs && elapsed % doorEveryMs < options.doorOpenS * 1000ULL);
+    plant.step(SIM_TICK_MS / 1000.0f, stages, relays.isOn(RELAY_HUMIDIFIER_SCRUBBER));
+    for (uint8_t i = 0; i < probes; i++)
+      probeSensors[i].set(plant.airTemperature() + options.stratification * (probeHeights[i] - PLANT_NODE_HEIGHT),
+                          plant.humidity());
+
+    // Sensor task, then the control task at its period
+    SensorSample sample;
+    if (acquisition.poll(sample) & ACQ_SAMPLE)
+    {
+      climate.update(sample);
+      if (options.bangBang && (sample.temperature > limits.tempMax || sample.temperature < limits.tempMin))
+      {
+        for (uint8_t i = 0; i < COOLING_STAGES; i++)
+          relays.set(RELAY_COOLING_FIRST + i, sample.temperature > limits.tempMax);
+      }
+    }
+    if (!options.bangBang && now - lastControl >= CONTROL_TICK)
+    {
+      lastControl = now;
+      climate.tick(now);
+    }
+
+    // Warmest and coldest shelf (the plant's air temperature in a well-mixed room)
+    float t = plant.airTemperature();
+    float top = t + options.stratification * (probeHeights[probes - 1] - PLANT_NODE_HEIGHT);
+    float bottom = t + options.stratification * (probeHeights[0] - PLANT_NODE_HEIGHT);
+    float h = plant.humidity();
+    if (!pulledDown)
+    {
+      if (top > limits.tempMax)
+        continue;
+      pulledDown = true;
+      pullDownMs = elapsed;
+    }
+
+    settledTicks++;
+    if (bottom >= limits.tempMin && top <= limits.tempMax)
+      inBandTicks++;
+    if (h >= limits.humidityMin && h <= limits.humidityMax)
+      humidityTicks++;
+    if (top - limits.tempMax > result.overshoot)
+      result.overshoot = top - limits.tempMax;
+    if (limits.tempMin - bottom > result.undershoot)
+      result.undershoot = limits.tempMin - bottom;
+    errorSum += t > limits.tempSetpoint ? t - limits.tempSetpoint : limits.tempSetpoint - t;
+  }
+  result.wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  double days = simulatedMs / 86400000.0;
+  result.pullDownH = pulledDown ? pullDownMs / 3600000.0 : -1;
+  result.inBand = settledTicks > 0 ? 100.0 * inBandTicks / settledTicks : 0;
+  result.humidityInBand = settledTicks > 0 ? 100.0 * humidityTicks / settledTicks : 0;
+  result.meanError = settledTicks > 0 ? errorSum / settledTicks : 0;
+  for (uint8_t channel = 0; channel < RELAY_CHANNELS; channel++)
+  {
+    result.switchOnsPerDay[channel] = relays.switchOns(channel) / days;
+    result.energyWhPerDay[channel] = relayPower[channel] * relays.onTimeMs(channel) / 3600000.0 / days;
+  }
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  RunOptions options = {7, 25, 60, 4, 60, false, 0, true, false};
+  bool compare = true; // Also run bang-bang and print it next to the staged controller
+  const char *only = NULL;
+  bool csv = false;
+
+  for (int arg = 1; arg < argc; arg++)
+  {
+    if (strcmp(argv[arg], "-c") == 0)
+    {
+      csv = true;
+      continue;
+    }
+    if (argv[arg][0] != '-' || arg + 1 >= argc)
+    {
+      fprintf(stderr, "usage: %s [-d days] [-p profile] [-b dht|sht] [-a ambientC] [-o doorEveryH] [-s doorOpenS]\n"
+                      "          [-g stratificationC/m] [-t mean|worst] [-m staged|bangbang] [-c]\n",
+              argv[0]);
+      return 2;
+    }
+    const char *value = argv[++arg];
+    switch (argv[arg - 1][1])
+    {
+    case 'd': options.days = atof(value); break;
+    case 'p': only = value; break;
+    case 'b': options.sht = strcmp(value, "sht") == 0; break;
+    case 'a': options.ambient = atof(value); break;
+    case 'o': options.doorEveryH = atof(value); break;
+    case 's': options.doorOpenS = (uint32_t)atoi(value); break;
+    case 'g': options.stratification = atof(value); break;
+    case 't': options.worst = strcmp(value, "mean") != 0; break;
+    case 'm':
+      options.bangBang = strcmp(value, "bangbang") == 0;
+      compare = false;
+      break;
+    default:
+      fprintf(stderr, "Unknown option %s\n", argv[arg - 1]);
+      return 2;
+    }
+  }
+
+  if (csv)
+    printf("profile,days,pulldown_h,in_band_pct,humidity_in_band_pct,overshoot_c,undershoot_c,mean_error_c,"
+           "cooling_switch_ons_per_day,humidifier_switch_ons_per_day,cooling_wh_per_day,humidifier_wh_per_day,"
+           "speedup\n");
+
+  bool ran = false;
+  for (size_t i = 0; i < profileCount; i++)
+  {
+    const ProduceProfile &profile = profiles[i];
+    if (only != NULL && strcmp(only, profile.name) != 0)
+      continue;
+    ran = true;
+
+    RunResult result = run(profile, options);
+    double speedup = options.days * 86400.0 / result.wallS;
+
+    double coolingSwitchOns = 0, coolingEnergy = 0;
+    for (uint8_t stage = 0; stage < COOLING_STAGES; stage++)
+    {
+      coolingSwitchOns += result.switchOnsPerDay[RELAY_COOLING_FIRST + stage];
+      coolingEnergy += result.energyWhPerDay[RELAY_COOLING_FIRST + stage];
+    }
+
+    if (csv)
+    {
+      printf("%s,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f,%.1f,%.1f,%.0f,%.0f,%.0f\n",
+             profile.name, options.days, result.pullDownH, result.inBand, result.humidityInBand,
+             result.overshoot, result.undershoot, result.meanError, coolingSwitchOns,
+             result.switchOnsPerDay[RELAY_HUMIDIFIER_SCRUBBER], coolingEnergy,
+             result.energyWhPerDay[RELAY_HUMIDIFIER_SCRUBBER], speedup);
+      continue;
+    }
+
+    const Thresholds &limits = profile.thresholds;
+    printf("%s (%.0f-%.0f °C, setpoint %.0f °C, %.0f-%.0f %%RH, %s cooling): %.1f days in %.2f s wall, "
+           "%.0fx real time\n",
+           profile.name, limits.tempMin, limits.tempMax, limits.tempSetpoint, limits.humidityMin,
+           limits.humidityMax, options.bangBang ? "bang-bang" : "staged", options.days, result.wallS, speedup);
+    printf("  pull-down %.2f h, then temperature in band %.1f%%, humidity in band %.1f%%\n",
+           result.pullDownH, result.inBand, result.humidityInBand);
+    printf("  overshoot +%.2f °C above max, -%.2f °C below min, mean |error| %.2f °C\n",
+           result.overshoot, result.undershoot, result.meanError);
+    for (uint8_t channel = 0; channel < RELAY_CHANNELS; channel++)
+      printf("  relay %u: %6.1f switch-ons/day, %6.0f Wh/day\n", channel, result.switchOnsPerDay[channel],
+             result.energyWhPerDay[channel]);
+    printf("  total %.2f kWh/day\n", (coolingEnergy + result.energyWhPerDay[RELAY_HUMIDIFIER_SCRUBBER]) / 1000.0);
+
+    if (!compare)
+      continue;
+    RunOptions bangBangOptions = options;
+    bangBangOptions.bangBang = true;
+    RunResult old = run(profile, bangBangOptions);
+    double oldSwitchOns = 0, oldEnergy = 0;
+    for (uint8_t stage = 0; stage < COOLING_STAGES; stage++)
+    {
+      oldSwitchOns += old.switchOnsPerDay[RELAY_COOLING_FIRST + stage];
+      oldEnergy += old.energyWhPerDay[RELAY_COOLING_FIRST + stage];
+    }
+    printf("  cooling vs bang-bang: in band %.1f%% / %.1f%%, overshoot +%.2f / +%.2f °C,\n"
+           "    undershoot -%.2f / -%.2f °C, mean |error| %.2f / %.2f °C,\n"
+           "    %.1f / %.1f relay switch-ons/day, %.0f / %.0f Wh/day\n",
+           result.inBand, old.inBand, result.overshoot, old.overshoot, result.undershoot, old.undershoot,
+           result.meanError, old.meanError, coolingSwitchOns, oldSwitchOns, coolingEnergy, oldEnergy);
+  }
+
+  if (!ran)
+  {
+    fprintf(stderr, "Unknown profile %s (apples, potatoes, mixed)\n", only);
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * Host checks and throughput benchmark for SampleRing (env:ring_bench)
+ *
+ * First runs single-threaded checks of the ring's contract (empty/full,
+ * FIFO order across the index wrap-around, drop-oldest and decimate
+ * overflow), then has a producer and a consumer thread move SensorSamples
+ * through a firmware-sized ring as fast as they can. Every sample carries
+ * its sequence number in each word, so a torn copy or a reordering shows:
+ *
+ *   pio run -e ring_bench && .pio/build/ring_bench/program [-n samples] [-p oldest|decimate]
+ *
+ * Exits non-zero if a check fails.
+ */
+
+#include "ControllerConfig.h"
+#include "SampleRing.h"
+#include "Telemetry.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what)
+{
+  if (!condition)
+  {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+// Sample whose every word holds seq
+static SensorSample stamped(uint32_t seq)
+{
+  SensorSample sample;
+  uint32_t *words = (uint32_t *)&sample;
+  for (size_t i = 0; i < sizeof(sample) / sizeof(uint32_t); i++)
+    words[i] = seq;
+  return sample;
+}
+
+static bool intact(const SensorSample &sample)
+{
+  const uint32_t *words = (const uint32_t *)&sample;
+  for (size_t i = 1; i < sizeof(sample) / sizeof(uint32_t); i++)
+  {
+    if (words[i] != words[0])
+      return false;
+  }
+  return true;
+}
+
+static void checkEmptyAndFull()
+{
+  SampleRing<uint32_t, 8> ring(RING_DROP_OLDEST);
+  uint32_t value = 0;
+  check(ring.empty() && ring.size() == 0, "new ring is empty");
+  check(!ring.pop(value), "pop from an empty ring fails");
+
+  for (uint32_t i = 0; i < 8; i++)
+    check(ring.push(i), "push into a ring with room");
+  check(ring.size() == 8 && ring.dropped() == 0, "ring holds its capacity without dropping");
+
+  for (uint32_t i = 0; i < 8; i++)
+    check(ring.pop(value) && value == i, "full ring pops in FIFO order");
+  check(ring.empty() && !ring.pop(value), "drained ring is empty");
+}
+
+static void checkWrapAround()
+{
+  // Odd-sized bursts walk the head and tail over the slot array edge many times
+  SampleRing<uint32_t, 8> ring(RING_DROP_OLDEST);
+  uint32_t next = 0, expected = 0, value = 0;
+  bool ordered = true;
+  for (int round = 0; round < 1000; round++)
+  {
+    for (int i = 0; i < 5; i++)
+      ring.push(next++);
+    for (int i = 0; i < 5; i++)
+      ordered = ordered && ring.pop(value) && value == expected++;
+  }
+  check(ordered, "FIFO order across the wrap-around");
+  check(ring.empty() && ring.dropped() == 0, "no drops below capacity");
+}
+
+static void checkDropOldest()
+{
+  SampleRing<uint32_t, 8> ring(RING_DROP_OLDEST);
+  for (uint32_t i = 0; i < 11; i++)
+    check(ring.push(i), "drop-oldest always takes the new sample");
+  check(ring.size() == 8 && ring.dropped() == 3, "drop-oldest discards the overflow");
+
+  uint32_t value = 0;
+  bool newest = true;
+  for (uint32_t i = 3; i < 11; i++)
+    newest = newest && ring.pop(value) && value == i;
+  check(newest, "drop-oldest keeps the newest samples in order");
+  check(ring.empty(), "drop-oldest ring drains");
+}
+
+static void checkDecimate()
+{
+  SampleRing<uint32_t, 16> ring(RING_DECIMATE);
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < 100; i++)
+    kept += ring.push(i);
+  check(ring.size() == 16, "decimate fills the ring");
+  check(kept == 16 && ring.dropped() == 84, "decimate drops new samples once full");
+
+  // Below half full every sample is kept, then every 2nd, then every 4th
+  const uint32_t expected[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, 28};
+  uint32_t value = 0;
+  bool thinned = true;
+  for (uint32_t i = 0; i < 16; i++)
+    thinned = thinned && ring.pop(value) && value == expected[i];
+  check(thinned, "decimate thins the stream as the ring fills");
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t count = 20000000;
+  RingOverflowPolicy policy = RING_DROP_OLDEST;
+
+  for (int arg = 1; arg < argc; arg += 2)
+  {
+    if (argv[arg][0] != '-' || arg + 1 >= argc)
+    {
+      fprintf(stderr, "usage: %s [-n samples] [-p oldest|decimate]\n", argv[0]);
+      return 2;
+    }
+    switch (argv[arg][1])
+    {
+    case 'n': count = (uint32_t)strtoul(argv[arg + 1], NULL, 10); break;
+    case 'p': policy = strcmp(argv[arg + 1], "decimate") == 0 ? RING_DECIMATE : RING_DROP_OLDEST; break;
+    default:
+      fprintf(stderr, "Unknown option %s\n", argv[arg]);
+      return 2;
+    }
+  }
+
+  checkEmptyAndFull();
+  checkWrapAround();
+  checkDropOldest();
+  checkDecimate();
+  printf("Checks: %s\n", failures == 0 ? "all passed" : "FAILED");
+
+  // SPSC with the firmware's sample type and capacity: first a lossless transfer
+  // (the producer waits for room) for the throughput, then the producer runs
+  // flat out so the overflow policy fights the consumer for the oldest slot
+  static SampleRing<SensorSample, SAMPLE_RING_CAPACITY> ring(policy);
+  const char *policyName = policy == RING_DECIMATE ? "decimate" : "drop-oldest";
+  for (int pass = 0; pass < 2; pass++)
+  {
+    bool lossless = pass == 0;
+    uint32_t droppedBefore = ring.dropped();
+    std::atomic<bool> done(false);
+    uint32_t received = 0, torn = 0, reordered = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    std::thread consumer([&]() {
+      SensorSample sample;
+      uint32_t last = 0;
+      for (;;)
+      {
+        bool finished = done.load(std::memory_order_acquire);
+        if (!ring.pop(sample))
+        {
+          if (finished)
+            break;
+          std::this_thread::yield();
+          continue;
+        }
+        received++;
+        if (!intact(sample))
+          torn++;
+        else if (received > 1 && sample.seq <= last)
+          reordered++;
+        last = sample.seq;
+      }
+    });
+
+    // Room: the slot a pop() is still copying is only free once the copy is
+    // done, and decimate starts thinning at half full
+    size_t room = policy == RING_DECIMATE ? SAMPLE_RING_CAPACITY / 2 : SAMPLE_RING_CAPACITY - 1;
+    for (uint32_t seq = 1; seq <= count; seq++)
+    {
+      while (lossless && ring.size() >= room)
+        std::this_thread::yield(); // Also lets the consumer run on a single-core host
+      ring.push(stamped(seq));
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    uint32_t dropped = ring.dropped() - droppedBefore;
+
+    printf("SPSC %s (%s, %u x %zu bytes): %u pushed, %u popped, %u dropped in %.3f s\n",
+           lossless ? "transfer" : "overflow", policyName, SAMPLE_RING_CAPACITY, sizeof(SensorSample), count,
+           received, dropped, wallS);
+    printf("  %.1f M samples/s popped, %.1f ns per sample\n", received / wallS / 1e6,
+           received > 0 ? wallS * 1e9 / received : 0.0);
+    check(torn == 0, "no torn samples under contention");
+    check(reordered == 0, "samples arrive in order under contention");
+    check(received + dropped == count, "every sample is either popped or counted as dropped");
+    if (lossless)
+      check(dropped == 0, "no drops while the producer waits for room");
+  }
+
+  if (failures > 0)
+  {
+    printf("%d check(s) FAILED\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * Host benchmark of the telemetry encoding (env:telemetry_bench)
+ *
+ * Encodes the same samples as JSON and as MessagePack, one per POST (an
+ * alert) and UPLINK_BATCH_MAX per POST (steady), from a
+ * single probe and from CLIMATE_PROBES_MAX probes, and reports the bytes on
+ * the wire and the encode time of each:
+ *
+ *   pio run -e telemetry_bench && .pio/build/telemetry_bench/program [-r repeat]
+ *
+ * Samples follow a cold room at ~3 °C / ~89 % with sensor noise, so the
+ * float fields have realistic digits. Every payload is decoded again and
+ * must give back its samples. Last, a full batch with every field at its
+ * widest (10-digit counters, negative floats, exponent notation, -32768
+ * per probe) must fit UPLINK_PAYLOAD_SIZE in both encodings. Exits non-zero
+ * if a check fails.
+ */
+
+#include "Telemetry.h"
+#include "UplinkBatcher.h"
+
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+struct BenchCase
+{
+  uint8_t probes;
+  uint8_t count; // Samples per POST
+};
+
+static uint32_t noiseState = 1;
+
+static float noise(float amplitude)
+{
+  noiseState ^= noiseState << 13;
+  noiseState ^= noiseState >> 17;
+  noiseState ^= noiseState << 5;
+  return amplitude * ((noiseState >> 8) / 8388608.0f - 1.0f);
+}
+
+// A steady-state sample every UPLINK_INTERVAL (10 s) with `probes` probes from floor to ceiling
+static SensorSample makeSample(uint32_t index, uint8_t probes)
+{
+  SensorSample sample = {};
+  sample.seq = 1000 + index;
+  sample.time = 1760000000 + 10 * index;
+  sample.timestamp = 600000 + 10000 * index;
+  sample.probeCount = probes;
+  sample.probeValid = (uint8_t)((1u << probes) - 1);
+
+  float temperatureSum = 0, humiditySum = 0;
+  sample.temperatureMin = sample.humidityMin = 1000;
+  sample.temperatureMax = sample.humidityMax = -1000;
+  for (uint8_t p = 0; p < probes; p++)
+  {
+    float height = probes > 1 ? 0.2f + 2.0f * p / (probes - 1) : 1.0f;
+    float temperature = 3.0f + 1.5f * (height - 1.0f) + noise(0.1f);
+    float humidity = 89.0f + noise(0.5f);
+    sample.probeTemperature[p] = (int16_t)(temperature * 10);
+    sample.probeHumidity[p] = (int16_t)(humidity * 10);
+    temperatureSum += temperature;
+    humiditySum += humidity;
+    sample.temperatureMin = temperature < sample.temperatureMin ? temperature : sample.temperatureMin;
+    sample.temperatureMax = temperature > sample.temperatureMax ? temperature : sample.temperatureMax;
+    sample.humidityMin = humidity < sample.humidityMin ? humidity : sample.humidityMin;
+    sample.humidityMax = humidity > sample.humidityMax ? humidity : sample.humidityMax;
+  }
+  sample.temperature = temperatureSum / probes;
+  sample.humidity = humiditySum / probes;
+  sample.temperatureGradient = probes > 1 ? 1.5f + noise(0.05f) : 0;
+  sample.vocRaw = (uint16_t)(30000 + noise(200));
+  sample.vocIndex = (float)(int)(100 + noise(20)); // The Gas Index algorithm gives whole numbers
+  sample.noxRaw = (uint16_t)(16000 + noise(50));
+  sample.noxIndex = 1;
+  return sample;
+}
+
+// Longest text and MessagePack form of every field
+static SensorSample widestSample(uint32_t index)
+{
+  SensorSample sample = {};
+  sample.seq = 4000000000u + index;
+  sample.time = 4000000000u;
+  sample.timestamp = 4000000000u;
+  sample.temperature = sample.temperatureMin = sample.temperatureMax = -123.45678f;
+  sample.humidity = sample.humidityMin = sample.humidityMax = -123.45678f;
+  sample.temperatureGradient = -1.2345678e-12f;
+  sample.probeCount = CLIMATE_PROBES_MAX;
+  sample.probeValid = 0xFF;
+  for (uint8_t p = 0; p < CLIMATE_PROBES_MAX; p++)
+    sample.probeTemperature[p] = sample.probeHumidity[p] = -32768;
+  sample.vocRaw = sample.noxRaw = 65535;
+  sample.vocIndex = sample.noxIndex = -1.2345678e-12f;
+  return sample;
+}
+
+static bool decodesBack(const uint8_t *payload, size_t length, bool msgpack, uint8_t count)
+{
+  DynamicJsonDocument doc(length * 16 + 1024); // Probe arrays: 1-byte MessagePack ints take a whole slot each
+  DeserializationError error = msgpack ? deserializeMsgPack(doc, (const char *)payload, length)
+                                       : deserializeJson(doc, (const char *)payload, length);
+  return !error && doc["samples"].size() == count && doc["samples"][0]["seq"] == 1000;
+}
+
+int main(int argc, char **argv)
+{
+  int repeat = 2000;
+  for (int arg = 1; arg < argc; arg += 2)
+  {
+    if (argv[arg][0] != '-' || argv[arg][1] != 'r' || arg + 1 >= argc)
+    {
+      fprintf(stderr, "usage: %s [-r repeat]\n", argv[0]);
+      return 2;
+    }
+    repeat = atoi(argv[arg + 1]) > 0 ? atoi(argv[arg + 1]) : 1;
+  }
+
+  const BenchCase cases[] = {
+      {1, 1},
+      {1, UPLINK_BATCH_MAX},
+      {CLIMATE_PROBES_MAX, 1},
+      {CLIMATE_PROBES_MAX, UPLINK_BATCH_MAX},
+  };
+  static SensorSample samples[UPLINK_BATCH_MAX];
+  static uint8_t payload[UPLINK_PAYLOAD_SIZE];
+  const BatchHeader header = {900000, 0x5eed1234, 1000, false, 30, 0, 0};
+  int failures = 0;
+
+  printf("%-8s %6s %8s %10s %12s %10s %10s\n", "encoding", "probes", "samples", "bytes", "bytes/sample",
+         "us/POST", "us/sample");
+  for (const BenchCase &bench : cases)
+  {
+    noiseState = 1;
+    for (uint8_t i = 0; i < bench.count; i++)
+      samples[i] = makeSample(i, bench.probes);
+
+    size_t lengths[2] = {0, 0};
+    for (int msgpack = 0; msgpack < 2; msgpack++)
+    {
+      size_t length = encodeBatch(header, samples, bench.count, msgpack, payload, sizeof(payload));
+      if (length == 0 || !decodesBack(payload, length, msgpack, bench.count))
+      {
+        printf("FAIL: %s, %u probe(s), %u sample(s) doesn't encode and decode back\n",
+               msgpack ? "msgpack" : "json", bench.probes, bench.count);
+        failures++;
+        continue;
+      }
+      lengths[msgpack] = length;
+
+      volatile size_t sink = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int pass = 0; pass < repeat; pass++)
+        sink = sink + encodeBatch(header, samples, bench.count, msgpack, payload, sizeof(payload));
+      double us =
+          std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeat;
+
+      printf("%-8s %6u %8u %10zu %12.1f %10.2f %10.3f\n", msgpack ? "msgpack" : "json", bench.probes, bench.count,
+             length, (double)length / bench.count, us, us / bench.count);
+    }
+    if (lengths[0] > 0 && lengths[1] > 0)
+      printf("  MessagePack is %.0f%% of the JSON size\n", 100.0 * lengths[1] / lengths[0]);
+  }
+
+  // The largest batch the firmware can build must never need a split
+  static uint8_t unbounded[4 * UPLINK_PAYLOAD_SIZE];
+  const BatchHeader widestHeader = {4000000000u, 4000000000u, 4000000000u, false, 4000000000u, 4000000000u,
+                                    4000000000u};
+  for (uint8_t i = 0; i < UPLINK_BATCH_MAX; i++)
+    samples[i] = widestSample(i);
+  for (int msgpack = 0; msgpack < 2; msgpack++)
+  {
+    size_t length = encodeBatch(widestHeader, samples, UPLINK_BATCH_MAX, msgpack, unbounded, sizeof(unbounded));
+    printf("Widest %s batch (%u probes, %u samples): %zu of %u bytes\n", msgpack ? "msgpack" : "json",
+           CLIMATE_PROBES_MAX, UPLINK_BATCH_MAX, length, UPLINK_PAYLOAD_SIZE);
+    if (length == 0 || length >= UPLINK_PAYLOAD_SIZE)
+    {
+      printf("FAIL: a full %s batch doesn't fit UPLINK_PAYLOAD_SIZE\n", msgpack ? "msgpack" : "json");
+      failures++;
+    }
+  }
+
+  if (failures > 0)
+  {
+    printf("FAILED\n");
+    return 1;
+  }
+  return 0;
+}
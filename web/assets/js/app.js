@@ -17,7 +17,7 @@
   const targets = {
     temp: { min: 2, max: 4 },
     humidity: { min: 85, max: 95 },
-    ethylene: { max: 30 }, // VOCs threshold: 30 ppm (30000 raw / 1000)
+    ethylene: { max: 250 }, // VOC Index threshold (0-500, 100 = typical air)
   };
   const MAX_POINTS = 50;
   let currentTimeRange = "24h"; // Default time range
@@ -45,7 +45,7 @@
       const result = {
         temp: Number(data?.temperature?.value),
         humidity: Number(data?.humidity?.value),
-        ethylene: Number(data?.vocs?.value) / 1000.0, // VOCs converted to ppm for display
+        ethylene: Number(data?.vocs?.value), // Sensirion VOC Index computed on the ESP32
         produce: data.produce,
       };
       console.log("📈 Parsed metrics:", result);
@@ -96,7 +96,7 @@
     const tempMin = 0;
     const tempMax = 35; // Temperature °C
     const ethMin = 0;
-    const ethMax = 50; // VOCs/Ethylene ppm (0-50 range to show typical 20-40 values)
+    const ethMax = 500; // VOC Index (full 0-500 range)
     const humMin = 0;
     const humMax = 100; // Humidity %
     const tempRange = tempMax - tempMin || 1;
@@ -201,7 +201,7 @@
     canvasCtx.fillText("Temp (°C)", PAD + 6, PAD - 8);
     // Left axis title (Ethylene) - orange, offset
     canvasCtx.fillStyle = "#f59e0b";
-    canvasCtx.fillText("Ethylene (ppm)", PAD + 90, PAD - 8);
+    canvasCtx.fillText("VOC Index", PAD + 90, PAD - 8);
     // Right axis title (Humidity) - blue
     canvasCtx.fillStyle = "#0ea5e9";
     const rightTitle = "Humidity (%)";
@@ -310,9 +310,9 @@
         <div><span style="color:#0ea5e9">●</span> Humidity: <strong>${fmt(
           item.humidity
         )} %</strong></div>
-        <div><span style="color:#f59e0b">●</span> Ethylene/VOCs: <strong>${fmtPrecise(
+        <div><span style="color:#f59e0b">●</span> Ethylene/VOCs: <strong>${fmt(
           item.ethylene
-        )} ppm</strong></div>
+        )}</strong></div>
       `;
       // Position relative to canvas, not viewport
       tooltip.style.left = `${x + 15}px`;
@@ -346,7 +346,7 @@
     } else {
       temp = 3 + Math.random() * 3.5;
       humidity = 85 + Math.random() * 8;
-      ethylene = 0.01 + Math.random() * 0.14;
+      ethylene = 80 + Math.random() * 60;
       tstamp = Date.now();
       console.log("⚠️ Using mock data (fetch failed):", {
         temp,
@@ -357,7 +357,7 @@
 
     el("temp-value").textContent = fmt(temp);
     el("humidity-value").textContent = fmt(humidity);
-    el("ethylene-value").textContent = fmtPrecise(ethylene);
+    el("ethylene-value").textContent = fmt(ethylene);
     console.log("📝 Updated DOM elements");
 
     // Update indicator bars
@@ -369,8 +369,8 @@
     const humidityPercent = Math.max(0, Math.min(100, humidity));
     el("humidity-bar").style.width = humidityPercent + "%";
 
-    // Ethylene: 0-0.2 ppm range (display range)
-    const ethylenePercent = Math.max(0, Math.min(100, (ethylene / 0.2) * 100));
+    // Ethylene: VOC Index 0-500
+    const ethylenePercent = Math.max(0, Math.min(100, (ethylene / 500) * 100));
     el("ethylene-bar").style.width = ethylenePercent + "%";
 
     // push data
@@ -1166,7 +1166,7 @@
           )}–${Math.round(targets.humidity.max)}%`;
         }
         if (ethyleneTarget) {
-          ethyleneTarget.textContent = `Threshold: ${targets.ethylene.max} ppm`;
+          ethyleneTarget.textContent = `Threshold: ${targets.ethylene.max} index`;
         }
 
         // Show confirmation
@@ -1178,9 +1178,9 @@
             0
           )}-${targets.temp.max.toFixed(0)}°C, Humidity ${Math.round(
             targets.humidity.min
-          )}-${Math.round(targets.humidity.max)}%, Ethylene ${
+          )}-${Math.round(targets.humidity.max)}%, VOC Index ${
             targets.ethylene.max
-          }ppm`;
+          }`;
           alertList.prepend(li);
           setTimeout(() => li.remove(), 5000);
         }
@@ -1284,7 +1284,7 @@
         humidEl.textContent = `${produce.thresholds.humidity.min}–${produce.thresholds.humidity.max}%`;
       }
       if (vocEl) {
-        vocEl.textContent = `${(produce.thresholds.voc / 1000).toFixed(0)} ppm`;
+        vocEl.textContent = `${produce.thresholds.voc.toFixed(0)} index`;
       }
 
       // Update target displays in metric cards
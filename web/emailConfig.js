@@ -112,13 +112,21 @@ async function sendAlert(alertType, data) {
  * @param {string} produceType - Current produce type
  */
 function checkAndAlert(metrics, thresholds, produceType) {
+  // Rooms with several probes also report the coldest/warmest and driest/wettest one.
+  // A reading the sample doesn't carry is undefined and never raises an alert.
+  const temperatureMin = metrics.temperature?.min ?? metrics.temperature?.value;
+  const temperatureMax = metrics.temperature?.max ?? metrics.temperature?.value;
+  const humidityMin = metrics.humidity?.min ?? metrics.humidity?.value;
+  const humidityMax = metrics.humidity?.max ?? metrics.humidity?.value;
+
   // Check temperature
   if (
-    metrics.temperature.value < thresholds.temperature.min ||
-    metrics.temperature.value > thresholds.temperature.max
+    temperatureMin < thresholds.temperature.min ||
+    temperatureMax > thresholds.temperature.max
   ) {
     sendAlert("temperature", {
-      current: metrics.temperature.value,
+      current:
+        temperatureMax > thresholds.temperature.max ? temperatureMax : temperatureMin,
       min: thresholds.temperature.min,
       max: thresholds.temperature.max,
       produceType: produceType,
@@ -127,11 +135,11 @@ function checkAndAlert(metrics, thresholds, produceType) {
 
   // Check humidity
   if (
-    metrics.humidity.value < thresholds.humidity.min ||
-    metrics.humidity.value > thresholds.humidity.max
+    humidityMin < thresholds.humidity.min ||
+    humidityMax > thresholds.humidity.max
   ) {
     sendAlert("humidity", {
-      current: metrics.humidity.value,
+      current: humidityMax > thresholds.humidity.max ? humidityMax : humidityMin,
       min: thresholds.humidity.min,
       max: thresholds.humidity.max,
       produceType: produceType,
@@ -139,7 +147,7 @@ function checkAndAlert(metrics, thresholds, produceType) {
   }
 
   // Check VOC
-  if (metrics.vocs.value > thresholds.voc) {
+  if (metrics.vocs?.value > thresholds.voc) {
     sendAlert("voc", {
       current: metrics.vocs.value,
       max: thresholds.voc,
@@ -0,0 +1,239 @@
+/**
+ * Minimal MessagePack codec for the ESP32 telemetry uplink
+ * Covers everything ArduinoJson's MsgPack serializer emits (nil, bool, ints,
+ * float32/64, str, bin, array, map) - no extension types
+ */
+
+const MSGPACK_CONTENT_TYPE = "application/msgpack";
+
+// Bytes that follow the type byte before any variable-length data
+const FIXED_SIZES = {
+  0xc4: 1, // bin 8 length
+  0xc5: 2, // bin 16 length
+  0xc6: 4, // bin 32 length
+  0xca: 4, // float 32
+  0xcb: 8, // float 64
+  0xcc: 1, // uint 8
+  0xcd: 2, // uint 16
+  0xce: 4, // uint 32
+  0xcf: 8, // uint 64
+  0xd0: 1, // int 8
+  0xd1: 2, // int 16
+  0xd2: 4, // int 32
+  0xd3: 8, // int 64
+  0xd9: 1, // str 8 length
+  0xda: 2, // str 16 length
+  0xdb: 4, // str 32 length
+  0xdc: 2, // array 16 length
+  0xdd: 4, // array 32 length
+  0xde: 2, // map 16 length
+  0xdf: 4, // map 32 length
+};
+
+// Decode a Buffer holding one MessagePack value; throws on truncated or malformed data
+function decode(buffer) {
+  let offset = 0;
+
+  // Every read checks it stays inside the buffer: a cut-off payload must not decode
+  const need = (size) => {
+    if (offset + size > buffer.length) {
+      throw new Error("MessagePack: unexpected end of data");
+    }
+  };
+
+  const readString = (length) => {
+    need(length);
+    const value = buffer.toString("utf8", offset, offset + length);
+    offset += length;
+    return value;
+  };
+
+  const readArray = (length) => {
+    const value = new Array(length);
+    for (let i = 0; i < length; i++) value[i] = readValue();
+    return value;
+  };
+
+  const readMap = (length) => {
+    const value = {};
+    for (let i = 0; i < length; i++) {
+      const key = readValue();
+      // Would replace the object's prototype instead of adding a field
+      if (key === "__proto__") {
+        throw new Error("MessagePack: invalid map key __proto__");
+      }
+      value[key] = readValue();
+    }
+    return value;
+  };
+
+  const readValue = () => {
+    if (offset >= buffer.length) {
+      throw new Error("MessagePack: unexpected end of data");
+    }
+    const type = buffer[offset++];
+    const size = FIXED_SIZES[type];
+    if (size !== undefined) need(size);
+    let value;
+
+    if (type <= 0x7f) return type; // positive fixint
+    if (type >= 0xe0) return type - 0x100; // negative fixint
+    if ((type & 0xf0) === 0x80) return readMap(type & 0x0f);
+    if ((type & 0xf0) === 0x90) return readArray(type & 0x0f);
+    if ((type & 0xe0) === 0xa0) return readString(type & 0x1f);
+
+    switch (type) {
+      case 0xc0:
+        return null;
+      case 0xc2:
+        return false;
+      case 0xc3:
+        return true;
+      case 0xc4:
+      case 0xc5:
+      case 0xc6: {
+        const length = buffer.readUIntBE(offset, size);
+        offset += size;
+        need(length);
+        value = buffer.subarray(offset, offset + length);
+        offset += length;
+        return value;
+      }
+      case 0xca:
+        value = buffer.readFloatBE(offset);
+        offset += 4;
+        return value;
+      case 0xcb:
+        value = buffer.readDoubleBE(offset);
+        offset += 8;
+        return value;
+      case 0xcc:
+        return buffer[offset++];
+      case 0xcd:
+        value = buffer.readUInt16BE(offset);
+        offset += 2;
+        return value;
+      case 0xce:
+        value = buffer.readUInt32BE(offset);
+        offset += 4;
+        return value;
+      case 0xcf:
+        value = Number(buffer.readBigUInt64BE(offset));
+        offset += 8;
+        return value;
+      case 0xd0:
+        return buffer.readInt8(offset++);
+      case 0xd1:
+        value = buffer.readInt16BE(offset);
+        offset += 2;
+        return value;
+      case 0xd2:
+        value = buffer.readInt32BE(offset);
+        offset += 4;
+        return value;
+      case 0xd3:
+        value = Number(buffer.readBigInt64BE(offset));
+        offset += 8;
+        return value;
+      case 0xd9:
+        return readString(buffer[offset++]);
+      case 0xda:
+        offset += 2;
+        return readString(buffer.readUInt16BE(offset - 2));
+      case 0xdb:
+        offset += 4;
+        return readString(buffer.readUInt32BE(offset - 4));
+      case 0xdc:
+        offset += 2;
+        return readArray(buffer.readUInt16BE(offset - 2));
+      case 0xdd:
+        offset += 4;
+        return readArray(buffer.readUInt32BE(offset - 4));
+      case 0xde:
+        offset += 2;
+        return readMap(buffer.readUInt16BE(offset - 2));
+      case 0xdf:
+        offset += 4;
+        return readMap(buffer.readUInt32BE(offset - 4));
+      default:
+        throw new Error(`MessagePack: unsupported type 0x${type.toString(16)}`);
+    }
+  };
+
+  return readValue();
+}
+
+// Encode a plain JS value (objects, arrays, strings, numbers, booleans, null)
+function encode(value) {
+  const chunks = [];
+
+  const header = (bytes) => chunks.push(Buffer.from(bytes));
+
+  const writeLength = (length, fix, fixMax, codes) => {
+    if (fix !== null && length <= fixMax) return header([fix | length]);
+    if (codes[0] !== null && length <= 0xff) return header([codes[0], length]);
+    if (length <= 0xffff) return header([codes[1], length >> 8, length & 0xff]);
+    const b = Buffer.alloc(5);
+    b[0] = codes[2];
+    b.writeUInt32BE(length, 1);
+    chunks.push(b);
+  };
+
+  const writeValue = (v) => {
+    if (v === null || v === undefined) return header([0xc0]);
+    if (v === true) return header([0xc3]);
+    if (v === false) return header([0xc2]);
+
+    if (typeof v === "number") {
+      if (Number.isInteger(v) && v >= -0x80000000 && v <= 0xffffffff) {
+        if (v >= 0 && v <= 0x7f) return header([v]);
+        if (v < 0 && v >= -32) return header([v & 0xff]);
+        const b = Buffer.alloc(5);
+        if (v < 0) {
+          b[0] = 0xd2;
+          b.writeInt32BE(v, 1);
+        } else {
+          b[0] = 0xce;
+          b.writeUInt32BE(v, 1);
+        }
+        return chunks.push(b);
+      }
+      const b = Buffer.alloc(9);
+      b[0] = 0xcb;
+      b.writeDoubleBE(v, 1);
+      return chunks.push(b);
+    }
+
+    if (typeof v === "string") {
+      const bytes = Buffer.from(v, "utf8");
+      writeLength(bytes.length, 0xa0, 31, [0xd9, 0xda, 0xdb]);
+      return chunks.push(bytes);
+    }
+
+    if (Buffer.isBuffer(v)) {
+      writeLength(v.length, null, 0, [0xc4, 0xc5, 0xc6]);
+      return chunks.push(v);
+    }
+
+    if (Array.isArray(v)) {
+      writeLength(v.length, 0x90, 15, [null, 0xdc, 0xdd]);
+      return v.forEach(writeValue);
+    }
+
+    const keys = Object.keys(v).filter((key) => v[key] !== undefined);
+    writeLength(keys.length, 0x80, 15, [null, 0xde, 0xdf]);
+    keys.forEach((key) => {
+      writeValue(key);
+      writeValue(v[key]);
+    });
+  };
+
+  writeValue(value);
+  return Buffer.concat(chunks);
+}
+
+module.exports = {
+  MSGPACK_CONTENT_TYPE,
+  decode,
+  encode,
+};
@@ -0,0 +1,54 @@
+/**
+ * Round-trip and malformed-input checks of the MessagePack codec
+ * Run with: npm test
+ */
+
+const test = require("node:test");
+const assert = require("node:assert");
+const msgpack = require("./msgpack");
+
+// A batch shaped like the ESP32's, with every integer and string width the encoder picks
+const batch = {
+  device: 0x5eed1234,
+  base: 1000,
+  spool: { pending: 0, dropped: 70000, oldest: 4000000000 },
+  samples: [
+    {
+      seq: 1000,
+      time: 1760000000,
+      temperature: { value: 3.25, min: -1.5, max: 4.75 },
+      humidity: { value: 89.5, min: 88, max: 91 },
+      vocs: { value: 100, raw: 30000 },
+      probes: { t: [30, -5, -40, 127, -128, 300, -300, -32768], h: [890, 0, 1, 255] },
+    },
+  ],
+  note: "x".repeat(40),
+  long: "y".repeat(300),
+  flags: [true, false, null],
+  blob: Buffer.from([1, 2, 3]),
+};
+
+test("decode(encode(value)) gives the value back", () => {
+  assert.deepStrictEqual(msgpack.decode(msgpack.encode(batch)), batch);
+});
+
+test("every truncation of a payload throws", () => {
+  const payload = msgpack.encode(batch);
+  for (let length = 0; length < payload.length; length++) {
+    assert.throws(() => msgpack.decode(payload.subarray(0, length)), /unexpected end of data/, `length ${length}`);
+  }
+});
+
+test("a string longer than the data left throws", () => {
+  const payload = Buffer.from([0x81, 0xa3, 0x61, 0x62, 0x63, 0xa5, 0x78]);
+  assert.throws(() => msgpack.decode(payload), /unexpected end of data/);
+});
+
+test("a bin longer than the data left throws", () => {
+  assert.throws(() => msgpack.decode(Buffer.from([0xc4, 0x05, 0x01, 0x02])), /unexpected end of data/);
+});
+
+test("a __proto__ key is refused", () => {
+  const payload = Buffer.concat([Buffer.from([0x81, 0xa9]), Buffer.from("__proto__"), Buffer.from([0x80])]);
+  assert.throws(() => msgpack.decode(payload), /__proto__/);
+});
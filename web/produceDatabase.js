@@ -15,7 +15,7 @@ const produceDatabase = {
       optimal: 92,
     },
     vocs: {
-      threshold: 30000, // Apples produce moderate ethylene
+      threshold: 250, // VOC Index (100 = typical air); apples produce moderate ethylene
       sensitivity: "medium",
     },
     description: "Apples produce ethylene and require cold storage",
@@ -36,7 +36,7 @@ const produceDatabase = {
       optimal: 87,
     },
     vocs: {
-      threshold: 30000, // Moderately sensitive to ethylene
+      threshold: 250, // VOC Index; moderately sensitive to ethylene
       sensitivity: "medium",
     },
     description: "Potatoes require cool, dark storage with good ventilation",
@@ -57,7 +57,7 @@ const produceDatabase = {
       optimal: 90,
     },
     vocs: {
-      threshold: 28000,
+      threshold: 220, // VOC Index
       sensitivity: "medium",
     },
     description: "Balanced settings for multiple produce types",
@@ -66,4 +66,19 @@ const produceDatabase = {
   },
 };
 
+// Get the controller thresholds for a produce type (null if unknown)
+function getProduceSettings(produceType) {
+  const produce = produceDatabase[produceType];
+  if (!produce) {
+    return null;
+  }
+
+  return {
+    temp: { ...produce.temperature }, // min, max and the optimal setpoint
+    humidity: { min: produce.humidity.min, max: produce.humidity.max },
+    voc: produce.vocs.threshold,
+  };
+}
+
 module.exports = produceDatabase;
+module.exports.getProduceSettings = getProduceSettings;
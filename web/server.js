@@ -6,6 +6,7 @@ const axios = require("axios");
 const FormData = require("form-data");
 const fs = require("fs");
 const { getProduceSettings } = require("./produceDatabase");
+const msgpack = require("./msgpack");
 const {
   checkAndAlert,
   verifyEmailConfig,
@@ -30,9 +31,188 @@ const upload = multer({
   limits: { fileSize: 5 * 1024 * 1024 }, // 5MB limit
 });
 
+// Routine ESP32-CAM frames are sized for the model; a full-resolution
+// inspection frame is only asked for when the best detection is borderline
+// or someone requested one (POST /api/camera/inspect)
+const INSPECTION_CONFIDENCE = { min: 0.3, max: 0.6 };
+let inspectionRequested = false;
+
+// The camera sends a heartbeat instead of the image when the scene is unchanged
+let cameraState = {
+  deviceId: null,
+  address: null, // Learned from the camera's uploads, used for capture triggers
+  lastImageAt: null,
+  lastHeartbeatAt: null,
+  lastTriggerAt: null,
+  skipped: 0, // Heartbeats since the last image
+};
+
+// Sensor events (VOC above threshold, temperature above max) ask the camera
+// for an immediate picture, at most once per cooldown
+const CAMERA_TRIGGER_COOLDOWN_MS = 5 * 60 * 1000;
+
+function rememberCameraAddress(req) {
+  const address = (req.socket.remoteAddress || "").replace(/^::ffff:/, "");
+  if (address) cameraState.address = address;
+}
+
+// Ask the ESP32-CAM's trigger endpoint for a capture right now; the image
+// arrives through /api/upload-image like any other
+async function triggerCamera(reason, params = {}, force = false) {
+  if (!cameraState.address) {
+    console.log(`⚠️  Camera trigger (${reason}) skipped: camera address not known yet`);
+    return { success: false, error: "Camera address not known yet" };
+  }
+  const now = Date.now();
+  if (
+    !force &&
+    cameraState.lastTriggerAt &&
+    now - cameraState.lastTriggerAt < CAMERA_TRIGGER_COOLDOWN_MS
+  ) {
+    return { success: false, error: "Trigger cooldown" };
+  }
+  cameraState.lastTriggerAt = now;
+
+  try {
+    const response = await axios.get(`http://${cameraState.address}/capture`, {
+      params,
+      timeout: 3000,
+    });
+    console.log(`⚡ Camera capture triggered (${reason})`);
+    return { success: true, ...response.data };
+  } catch (error) {
+    console.error(`⚠️  Camera trigger failed (${reason}):`, error.message);
+    return { success: false, error: error.message };
+  }
+}
+
+// Uploads are acknowledged with a job id once the image is saved; YOLO runs
+// afterwards, one image at a time. The camera sees the outcome on its next
+// contact ("result", and "inspect" for a borderline detection), the
+// controller through the thresholds version in its /api/metrics answers.
+const INFERENCE_JOB_HISTORY = 50;
+const inferenceJobs = new Map(); // id -> { id, mode, status, capturedAt, ... }
+let nextInferenceJobId = 1;
+let inferenceQueue = Promise.resolve();
+
+// Bumped whenever the thresholds change, so the controller refetches them now
+// instead of at its next periodic update
+let thresholdsVersion = 1;
+
+function createInferenceJob(mode, capturedAt) {
+  const job = {
+    id: nextInferenceJobId++,
+    mode,
+    status: "pending", // pending -> done | failed
+    capturedAt: capturedAt.toISOString(),
+    receivedAt: new Date().toISOString(),
+  };
+  inferenceJobs.set(job.id, job);
+  if (inferenceJobs.size > INFERENCE_JOB_HISTORY) {
+    inferenceJobs.delete(inferenceJobs.keys().next().value);
+  }
+  return job;
+}
+
+// Newest finished job, in the short form handed back to the camera
+function latestInferenceResult() {
+  const finished = [...inferenceJobs.values()].filter((job) => job.status !== "pending");
+  if (finished.length === 0) return null;
+  const { id, status, detected, confidence } = finished[finished.length - 1];
+  return { job: id, status, detected, confidence };
+}
+
+// Run YOLO on an uploaded image (a buffer for raw uploads, else the saved
+// snapshot) and apply the result; never throws
+async function runInference(job, image, inspection) {
+  const inferenceStart = Date.now();
+  try {
+    let yoloResponse;
+    if (Buffer.isBuffer(image)) {
+      yoloResponse = await axios.post("http://localhost:5000/detect", image, {
+        headers: { "Content-Type": "image/jpeg" },
+        timeout: 10000, // 10 second timeout
+      });
+    } else {
+      const formData = new FormData();
+      formData.append("image", fs.createReadStream(image));
+
+      yoloResponse = await axios.post(
+        "http://localhost:5000/detect",
+        formData,
+        {
+          headers: formData.getHeaders(),
+          timeout: 10000, // 10 second timeout
+        }
+      );
+    }
+
+    const { detected, confidence, all_detections } = yoloResponse.data;
+
+    console.log(
+      `🤖 Job ${job.id}: YOLO detected ${detected || "nothing"} (confidence: ${(
+        (confidence || 0) * 100
+      ).toFixed(1)}%) in ${Date.now() - inferenceStart} ms, ` +
+        `${Date.now() - Date.parse(job.capturedAt)} ms after capture`
+    );
+
+    // Only update if produce was detected with good confidence and no manual override
+    if (detected && confidence > 0.5 && !currentProduce.manualOverride) {
+      const settings = getProduceSettings(detected);
+      if (settings) {
+        const changed = currentProduce.type !== detected;
+        currentProduce = {
+          type: detected,
+          detectedAt: new Date().toISOString(),
+          manualOverride: false,
+          confidence: confidence,
+          thresholds: {
+            temperature: settings.temp,
+            humidity: settings.humidity,
+            voc: settings.voc,
+          },
+        };
+        if (changed) thresholdsVersion++;
+
+        console.log(
+          `📊 Auto-adjusted thresholds for ${detected}:`,
+          currentProduce.thresholds
+        );
+      }
+    }
+
+    // Borderline detection on a routine frame: ask the camera for a full-resolution one
+    const best = (all_detections || []).reduce(
+      (max, detection) => Math.max(max, detection.confidence),
+      confidence || 0
+    );
+    const borderline =
+      best >= INSPECTION_CONFIDENCE.min && best < INSPECTION_CONFIDENCE.max;
+    if (!inspection && borderline) {
+      inspectionRequested = true;
+      console.log(
+        `🔍 Requesting inspection frame (borderline confidence ${(best * 100).toFixed(1)}%)`
+      );
+    }
+
+    Object.assign(job, {
+      status: "done",
+      detected: detected || null,
+      confidence: confidence || 0,
+      borderline,
+    });
+  } catch (error) {
+    console.error(`⚠️  Job ${job.id}: YOLO API error:`, error.message);
+    Object.assign(job, { status: "failed", error: "YOLO service unavailable" });
+  }
+  job.finishedAt = new Date().toISOString();
+  job.inferenceMs = Date.now() - inferenceStart;
+}
+
 // Middleware
 app.use(cors());
 app.use(express.json());
+app.use(express.raw({ type: msgpack.MSGPACK_CONTENT_TYPE, limit: "256kb" }));
 app.use(express.static(__dirname));
 app.use("/snapshots", express.static(snapshotsDir));
 
@@ -41,35 +221,188 @@ let latestMetrics = {
   temperature: { value: 0 },
   humidity: { value: 0 },
   vocs: { value: 0 },
+  nox: { value: 0 },
   timestamp: new Date().toISOString(),
 };
 
+// Store-and-forward tracking for the ESP32 telemetry spool: highest contiguous
+// sequence number received ("ack") plus the ones received out of order above it
+let uplinkState = {
+  stream: null,
+  contiguous: 0,
+  received: new Set(),
+  spool: null, // Queue depth / replay counters reported by the controller
+};
+
+// Every accepted sample is appended here as one JSON line (compliance record)
+const telemetryLogPath = path.join(__dirname, "telemetry.jsonl");
+
 // Store current produce and thresholds
 let currentProduce = {
   type: null, // null, 'apples', 'potatoes'
   detectedAt: null,
   manualOverride: false,
   thresholds: {
-    temperature: { min: 0, max: 4 },
+    temperature: { min: 0, max: 4, optimal: 2 },
     humidity: { min: 90, max: 95 },
-    voc: 30000,
+    voc: 250, // VOC Index (0-500, 100 = typical air)
   },
 };
 
+// Turn an ESP32 payload into a list of samples with wall-clock timestamps.
+// Accepts a single sample object or a batch: { now, samples: [...] }, where
+// "now" and each sample's "timestamp" are the controller's millis(). Samples
+// with a synced clock carry their own Unix "time", which wins. Readings a
+// sample doesn't carry (e.g. no SGP41 fitted) are simply left out, so every
+// consumer below reads them with optional chaining.
+function normalizeMetrics(body) {
+  const receivedAt = Date.now();
+
+  if (!body || typeof body !== "object") {
+    return [];
+  }
+  if (!Array.isArray(body.samples)) {
+    return [{ ...body, timestamp: new Date(receivedAt).toISOString() }];
+  }
+
+  const isObject = (sample) => sample !== null && typeof sample === "object";
+  return body.samples.filter(isObject).map((sample) => {
+    if (typeof sample.time === "number" && sample.time > 0) {
+      return { ...sample, timestamp: new Date(sample.time * 1000).toISOString() };
+    }
+    const age =
+      typeof body.now === "number" && typeof sample.timestamp === "number"
+        ? Math.max(0, body.now - sample.timestamp)
+        : 0;
+    return { ...sample, timestamp: new Date(receivedAt - age).toISOString() };
+  });
+}
+
+// Move the ack over any out-of-order samples that are now contiguous
+function advanceContiguous() {
+  while (uplinkState.received.has(uplinkState.contiguous + 1)) {
+    uplinkState.contiguous++;
+    uplinkState.received.delete(uplinkState.contiguous);
+  }
+}
+
+// Record a sequence number; returns false for duplicates (replays of samples we already have)
+function acceptSequence(seq) {
+  if (seq <= uplinkState.contiguous || uplinkState.received.has(seq)) {
+    return false;
+  }
+
+  uplinkState.received.add(seq);
+  advanceContiguous();
+  return true;
+}
+
+// Sync the sequence tracking with the batch's stream and oldest spooled sample
+function syncUplinkState(body) {
+  if (body.stream !== undefined && body.stream !== uplinkState.stream) {
+    // New spool on the controller (first contact, flash wiped, layout change)
+    uplinkState = {
+      stream: body.stream,
+      contiguous: 0,
+      received: new Set(),
+      spool: null,
+    };
+  }
+
+  // Nothing older than "base" will ever arrive (acked, or lost to a full spool)
+  if (typeof body.base === "number" && body.base - 1 > uplinkState.contiguous) {
+    uplinkState.contiguous = body.base - 1;
+    uplinkState.received.forEach((seq) => {
+      if (seq <= uplinkState.contiguous) uplinkState.received.delete(seq);
+    });
+    advanceContiguous();
+  }
+
+  if (body.spool) {
+    uplinkState.spool = body.spool;
+  }
+}
+
 // API endpoint to receive data from ESP32
 app.post("/api/metrics", (req, res) => {
-  console.log("📥 Received data from ESP32:", req.body);
+  let body = req.body;
 
-  // Update stored metrics
-  latestMetrics = {
-    ...req.body,
-    timestamp: new Date().toISOString(),
-  };
+  // ESP32 sends MessagePack by default, JSON as a fallback
+  if (req.is(msgpack.MSGPACK_CONTENT_TYPE)) {
+    try {
+      body = msgpack.decode(req.body);
+    } catch (error) {
+      return res.status(400).json({ success: false, error: error.message });
+    }
+  } else if (!req.is("application/json")) {
+    return res.status(415).json({
+      success: false,
+      error: "Use application/json or application/msgpack",
+    });
+  }
+
+  const samples = normalizeMetrics(body);
+  if (samples.length === 0) {
+    return res.status(400).json({ success: false, error: "No samples" });
+  }
+
+  // Drop samples we already have (a replay whose ack got lost)
+  syncUplinkState(body);
+  const fresh = samples.filter(
+    (sample) => typeof sample.seq !== "number" || acceptSequence(sample.seq)
+  );
+  console.log(
+    `📥 Received ${samples.length} ${body.replay ? "spooled" : "live"} sample(s) from ESP32` +
+      (fresh.length < samples.length
+        ? ` (${samples.length - fresh.length} duplicate)`
+        : "")
+  );
+
+  if (fresh.length > 0) {
+    fs.appendFile(
+      telemetryLogPath,
+      fresh.map((sample) => JSON.stringify(sample)).join("\n") + "\n",
+      (error) => {
+        if (error) console.error("❌ Failed to write telemetry log:", error.message);
+      }
+    );
+  }
 
-  // Check thresholds and send alerts if needed
-  checkAndAlert(latestMetrics, currentProduce.thresholds, currentProduce.type);
+  // Replayed samples are history: log them, but don't alert or show them as current
+  if (!body.replay) {
+    // Check thresholds for every sample (alert cooldown keeps this from spamming)
+    fresh.forEach((sample) =>
+      checkAndAlert(sample, currentProduce.thresholds, currentProduce.type)
+    );
+
+    // VOC spike or warm-up: get a picture of the room now instead of at the next scheduled capture
+    // (warmest probe when the room has several)
+    const thresholds = currentProduce.thresholds;
+    const warmest = (sample) => sample.temperature?.max ?? sample.temperature?.value;
+    const event = fresh.find(
+      (sample) =>
+        sample.vocs?.value > thresholds.voc ||
+        warmest(sample) > thresholds.temperature.max
+    );
+    if (event) {
+      triggerCamera(
+        event.vocs?.value > thresholds.voc
+          ? `VOC index ${event.vocs.value}`
+          : `temperature ${warmest(event)}°C`
+      );
+    }
 
-  res.json({ success: true, message: "Data received" });
+    // Update stored metrics with the newest sample
+    latestMetrics = samples[samples.length - 1];
+  }
+
+  res.json({
+    success: true,
+    message: "Data received",
+    count: fresh.length,
+    ack: uplinkState.contiguous,
+    thresholds: thresholdsVersion,
+  });
 });
 
 // API endpoint for web dashboard to fetch data
@@ -78,6 +411,11 @@ app.get("/api/metrics", (req, res) => {
   res.json({
     ...latestMetrics,
     produce: currentProduce,
+    uplink: {
+      ack: uplinkState.contiguous,
+      outOfOrder: uplinkState.received.size,
+      spool: uplinkState.spool,
+    },
   });
 });
 
@@ -115,6 +453,7 @@ app.post("/api/produce/set", (req, res) => {
       voc: settings.voc,
     },
   };
+  thresholdsVersion++;
 
   console.log(`🍎 Produce manually set to: ${produceType}`);
   console.log(`📊 New thresholds:`, currentProduce.thresholds);
@@ -143,6 +482,7 @@ app.get("/api/latest-snapshot", (req, res) => {
         success: true,
         snapshot: `/snapshots/${files[0].name}`,
         timestamp: files[0].time,
+        camera: cameraState,
       });
     } else {
       res.json({
@@ -180,90 +520,76 @@ app.get("/api/snapshots", (req, res) => {
 });
 
 // API endpoint to upload image from ESP32-CAM
-app.post("/api/upload-image", upload.single("image"), async (req, res) => {
+// Accepts either a raw image/jpeg body (metadata in X-Device-Id,
+// X-Capture-Age-Ms and X-Frame-Size headers), which stays in memory and goes
+// straight to inference, or the older multipart/form-data upload via multer.
+// Answers 202 with a job id as soon as the image is on disk; YOLO runs
+// afterwards (GET /api/inference/:id) so the camera can go back to sleep.
+const rawJpeg = express.raw({ type: "image/jpeg", limit: "5mb" });
+
+app.post("/api/upload-image", rawJpeg, upload.single("image"), async (req, res) => {
   try {
-    if (!req.file) {
+    const image = req.is("image/jpeg") && Buffer.isBuffer(req.body) ? req.body : null;
+    if (!req.file && (!image || image.length === 0)) {
       return res.status(400).json({
         success: false,
         error: "No image file provided",
       });
     }
 
-    console.log("📸 Image received from ESP32-CAM:", req.file.originalname);
-
-    // Save image to snapshots folder
-    const timestamp = new Date().toISOString().replace(/[:.]/g, "-");
-    const savedImagePath = path.join(snapshotsDir, `snapshot_${timestamp}.jpg`);
-    fs.copyFileSync(req.file.path, savedImagePath);
-    console.log(`💾 Image saved to: ${savedImagePath}`);
+    const receivedAt = Date.now();
+    const captureAge = parseInt(req.get("X-Capture-Age-Ms"), 10);
+    const capturedAt = new Date(receivedAt - (captureAge >= 0 ? captureAge : 0));
+    const size = image ? image.length : req.file.size;
+
+    const inspection = req.query.mode === "inspect";
+    const triggered = req.query.mode === "trigger";
+    console.log(
+      `📸 ${inspection ? "Inspection" : triggered ? "Triggered" : "Routine"} image received from ESP32-CAM: ` +
+        `${image ? `raw ${req.get("X-Frame-Size") || ""}` : req.file.originalname} (${(size / 1024).toFixed(0)} KB)`
+    );
+    rememberCameraAddress(req);
+    if (req.get("X-Device-Id")) {
+      cameraState.deviceId = req.get("X-Device-Id");
+    }
+    if (inspection) {
+      inspectionRequested = false;
+    }
+    cameraState.lastImageAt = new Date().toISOString();
+    cameraState.skipped = 0;
 
-    // Call Python YOLO inference API
+    // Save image to snapshots folder (named after the capture time)
+    const timestamp = capturedAt.toISOString().replace(/[:.]/g, "-");
+    const prefix = inspection ? "inspect" : triggered ? "trigger" : "snapshot";
+    const savedImagePath = path.join(snapshotsDir, `${prefix}_${timestamp}.jpg`);
     try {
-      const formData = new FormData();
-      formData.append("image", fs.createReadStream(req.file.path));
-
-      const yoloResponse = await axios.post(
-        "http://localhost:5000/detect",
-        formData,
-        {
-          headers: formData.getHeaders(),
-          timeout: 10000, // 10 second timeout
-        }
-      );
-
-      const { detected, confidence } = yoloResponse.data;
-
-      console.log(
-        `🤖 YOLO detected: ${detected || "nothing"} (confidence: ${(
-          confidence * 100
-        ).toFixed(1)}%)`
-      );
-
-      // Only update if produce was detected with good confidence and no manual override
-      if (detected && confidence > 0.5 && !currentProduce.manualOverride) {
-        const settings = getProduceSettings(detected);
-        if (settings) {
-          currentProduce = {
-            type: detected,
-            detectedAt: new Date().toISOString(),
-            manualOverride: false,
-            confidence: confidence,
-            thresholds: {
-              temperature: settings.temp,
-              humidity: settings.humidity,
-              voc: settings.voc,
-            },
-          };
-
-          console.log(
-            `📊 Auto-adjusted thresholds for ${detected}:`,
-            currentProduce.thresholds
-          );
-        }
+      if (image) {
+        await fs.promises.writeFile(savedImagePath, image);
+      } else {
+        await fs.promises.copyFile(req.file.path, savedImagePath);
       }
-
-      res.json({
-        success: true,
-        detected: detected,
-        confidence: confidence,
-        produce: currentProduce,
-      });
-    } catch (yoloError) {
-      console.error("⚠️  YOLO API error:", yoloError.message);
-
-      // Fallback: continue without detection
-      res.json({
-        success: true,
-        detected: null,
-        error: "YOLO service unavailable",
-        produce: currentProduce,
-      });
+      console.log(`💾 Image saved to: ${savedImagePath}`);
     } finally {
-      // Clean up uploaded file
-      fs.unlink(req.file.path, (err) => {
-        if (err) console.error("Error deleting temp file:", err);
-      });
+      // Clean up uploaded file (multipart only; raw uploads never touch uploads/)
+      if (req.file) {
+        fs.unlink(req.file.path, (err) => {
+          if (err) console.error("Error deleting temp file:", err);
+        });
+      }
     }
+
+    // The image is safe: let the camera go, inference follows in the background
+    const job = createInferenceJob(req.query.mode || "routine", capturedAt);
+    inferenceQueue = inferenceQueue.then(() =>
+      runInference(job, image || savedImagePath, inspection)
+    );
+
+    res.status(202).json({
+      success: true,
+      job: job.id,
+      inspect: !inspection && inspectionRequested,
+      result: latestInferenceResult(),
+    });
   } catch (error) {
     console.error("❌ Error processing image:", error);
     res.status(500).json({
@@ -273,13 +599,76 @@ app.post("/api/upload-image", upload.single("image"), async (req, res) => {
   }
 });
 
+// Inference result of an uploaded image (pending until YOLO has answered)
+app.get("/api/inference/:id", (req, res) => {
+  const job = inferenceJobs.get(Number(req.params.id));
+  if (!job) {
+    return res.status(404).json({ success: false, error: "Unknown job" });
+  }
+  res.json({ success: true, ...job });
+});
+
+// ESP32-CAM heartbeat: the scene matches the last uploaded image, so no new
+// image (and no YOLO run) - the latest snapshot is still current
+app.post("/api/camera/heartbeat", (req, res) => {
+  const { frame, change, skipped } = req.body || {};
+  rememberCameraAddress(req);
+  cameraState.lastHeartbeatAt = new Date().toISOString();
+  cameraState.skipped = Number(skipped) || cameraState.skipped + 1;
+
+  console.log(
+    `💤 ESP32-CAM frame ${frame}: scene unchanged (mean change ${change}, ${cameraState.skipped} skipped)`
+  );
+
+  res.json({
+    success: true,
+    inspect: inspectionRequested,
+    result: latestInferenceResult(),
+  });
+});
+
+// Ask the ESP32-CAM for a full-resolution inspection frame; it is taken right
+// after the next routine upload
+app.post("/api/camera/inspect", (req, res) => {
+  inspectionRequested = true;
+  console.log("🔍 Inspection frame requested");
+  res.json({
+    success: true,
+    message: "Inspection frame will be captured after the next routine upload",
+  });
+});
+
+// Capture a picture now, e.g. from the dashboard. Optional body:
+// { size: "vga" | "svga" | "xga" | "uxga", quality: 4-63, flash: true/false }
+app.post("/api/camera/trigger", async (req, res) => {
+  const { size, quality, flash } = req.body || {};
+  const params = {};
+  if (size) params.size = size;
+  if (quality) params.quality = quality;
+  if (flash !== undefined) params.flash = flash ? 1 : 0;
+
+  const result = await triggerCamera("manual", params, true);
+  res.status(result.success ? 202 : 503).json(result);
+});
+
 // API endpoint to get thresholds for ESP32
 app.get("/api/thresholds", (req, res) => {
-  res.json({
-    temperature: currentProduce.thresholds.temperature,
+  const thresholds = {
+    temperature: currentProduce.thresholds.temperature, // min, max, optimal setpoint
     humidity: currentProduce.thresholds.humidity,
     voc: currentProduce.thresholds.voc,
-  });
+    version: thresholdsVersion,
+  };
+
+  // Answer in MessagePack only when the client asks for it
+  const preferred = req.accepts([
+    "application/json",
+    msgpack.MSGPACK_CONTENT_TYPE,
+  ]);
+  if (preferred === msgpack.MSGPACK_CONTENT_TYPE) {
+    return res.type(msgpack.MSGPACK_CONTENT_TYPE).send(msgpack.encode(thresholds));
+  }
+  res.json(thresholds);
 });
 
 // Test email endpoint
@@ -336,8 +725,8 @@ app.post("/api/test-alert", async (req, res) => {
       produceType: currentProduce.type || "Test",
     },
     voc: {
-      current: 50000,
-      max: 30000,
+      current: 400,
+      max: 250,
       produceType: currentProduce.type || "Test",
     },
   };
@@ -451,7 +840,7 @@ app.get("/", (req, res) => {
   res.sendFile(path.join(__dirname, "index.html"));
 });
 
-app.listen(PORT, "0.0.0.0", async () => {
+const server = app.listen(PORT, "0.0.0.0", async () => {
   console.log("╔═══════════════════════════════════════╗");
   console.log("║  Cold Storage Backend Server         ║");
   console.log("╚═══════════════════════════════════════╝");
@@ -484,3 +873,8 @@ app.listen(PORT, "0.0.0.0", async () => {
   console.log(`🚀 Opening login page: ${dashboardUrl}\n`);
   open(dashboardUrl);
 });
+
+// Keep idle connections open longer than the ESP32 uplink interval so the
+// controller can reuse one keep-alive socket instead of reconnecting per sample
+server.keepAliveTimeout = 65000;
+server.headersTimeout = 66000;
@@ -48,29 +48,38 @@ def health_check():
 def detect_produce():
     """
     Detect produce type from uploaded image
-    Expected: multipart/form-data with 'image' file
+    Expected: raw image/jpeg body (decoded in memory, nothing written to disk)
+              or multipart/form-data with 'image' file
     Returns: JSON with detected produce type and confidence
     """
     try:
-        # Check if image was uploaded
-        if 'image' not in request.files:
-            return jsonify({
-                'success': False,
-                'error': 'No image file provided'
-            }), 400
-        
-        image_file = request.files['image']
-        
-        # Save uploaded image
-        timestamp = datetime.now().strftime('%Y%m%d_%H%M%S')
-        filename = f"produce_{timestamp}.jpg"
-        filepath = os.path.join(UPLOAD_FOLDER, filename)
-        image_file.save(filepath)
-        
-        print(f"📸 Processing image: {filename}")
+        filepath = None
+        if request.mimetype == 'image/jpeg':
+            # Raw upload passed through by server.js
+            data = np.frombuffer(request.get_data(), dtype=np.uint8)
+            print(f"📸 Processing raw image ({len(data)} bytes)")
+            img = cv2.imdecode(data, cv2.IMREAD_COLOR) if len(data) > 0 else None
+        else:
+            # Check if image was uploaded
+            if 'image' not in request.files:
+                return jsonify({
+                    'success': False,
+                    'error': 'No image file provided'
+                }), 400
+            
+            image_file = request.files['image']
+            
+            # Save uploaded image
+            timestamp = datetime.now().strftime('%Y%m%d_%H%M%S')
+            filename = f"produce_{timestamp}.jpg"
+            filepath = os.path.join(UPLOAD_FOLDER, filename)
+            image_file.save(filepath)
+            
+            print(f"📸 Processing image: {filename}")
+            
+            # Read image with OpenCV
+            img = cv2.imread(filepath)
         
-        # Read image with OpenCV
-        img = cv2.imread(filepath)
         if img is None:
             return jsonify({
                 'success': False,